@@ -38,6 +38,7 @@
 
 struct _lv_libssh2_agent {
     LIBSSH2_AGENT* inner;
+    lv_libssh2_session_t* session;
 };
 
 #endif
@@ -37,6 +37,7 @@
 #include "libssh2.h"
 
 #include "lv-libssh2.h"
+#include "lv-libssh2-profile-private.h"
 #include "lv-libssh2-status-private.h"
 #include "lv-libssh2-session-private.h"
 #include "lv-libssh2-agent-identity-private.h"
@@ -61,6 +62,7 @@ lv_libssh2_agent_create(
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
     agent->inner = inner;
+    agent->session = session;
     *handle = agent;
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -126,11 +128,16 @@ lv_libssh2_agent_authenticate(
     if (identity == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_agent_userauth(
         handle->inner,
         username,
         identity->inner
     );
+    lv_libssh2_session_unlock(handle->session);
+    if (result == 0) {
+        lv_libssh2_profile_authenticated(handle->session, username, "publickey");
+    }
     return lv_libssh2_status_from_result(result);
 }
 
@@ -0,0 +1,670 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/obj_mac.h>
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-status-private.h"
+#include "lv-libssh2-session-private.h"
+#include "lv-libssh2-thread-private.h"
+#include "lv-libssh2-time-private.h"
+
+#define DEFAULT_DURATION_MS 20
+#define PACKET_SIZE 32768
+#define KEY_SIZE 64
+#define IV_SIZE 16
+#define PREF_COUNT 3
+
+typedef enum _lv_libssh2_benchmark_kinds {
+    LV_LIBSSH2_BENCHMARK_KIND_CIPHER,
+    LV_LIBSSH2_BENCHMARK_KIND_AEAD,
+    LV_LIBSSH2_BENCHMARK_KIND_MAC,
+    LV_LIBSSH2_BENCHMARK_KIND_X25519,
+    LV_LIBSSH2_BENCHMARK_KIND_ECDH,
+    LV_LIBSSH2_BENCHMARK_KIND_DH
+} lv_libssh2_benchmark_kinds_t;
+
+/**
+ * An SSH method and the OpenSSL primitive that dominates its cost. The
+ * parameter is the curve for ECDH and the prime size for DH. Legacy methods
+ * are not ranked by speed, since some of them are the fastest.
+ */
+typedef struct _lv_libssh2_benchmark_method {
+    const char* name;
+    lv_libssh2_benchmark_kinds_t kind;
+    const char* algorithm;
+    int parameter;
+    bool legacy;
+} lv_libssh2_benchmark_method_t;
+
+static const lv_libssh2_benchmark_method_t METHODS[] = {
+    { "chacha20-poly1305@openssh.com", LV_LIBSSH2_BENCHMARK_KIND_AEAD, "chacha20-poly1305", 0, false },
+    { "aes256-gcm@openssh.com", LV_LIBSSH2_BENCHMARK_KIND_AEAD, "aes-256-gcm", 0, false },
+    { "aes128-gcm@openssh.com", LV_LIBSSH2_BENCHMARK_KIND_AEAD, "aes-128-gcm", 0, false },
+    { "aes256-ctr", LV_LIBSSH2_BENCHMARK_KIND_CIPHER, "aes-256-ctr", 0, false },
+    { "aes192-ctr", LV_LIBSSH2_BENCHMARK_KIND_CIPHER, "aes-192-ctr", 0, false },
+    { "aes128-ctr", LV_LIBSSH2_BENCHMARK_KIND_CIPHER, "aes-128-ctr", 0, false },
+    { "aes256-cbc", LV_LIBSSH2_BENCHMARK_KIND_CIPHER, "aes-256-cbc", 0, true },
+    { "rijndael-cbc@lysator.liu.se", LV_LIBSSH2_BENCHMARK_KIND_CIPHER, "aes-256-cbc", 0, true },
+    { "aes192-cbc", LV_LIBSSH2_BENCHMARK_KIND_CIPHER, "aes-192-cbc", 0, true },
+    { "aes128-cbc", LV_LIBSSH2_BENCHMARK_KIND_CIPHER, "aes-128-cbc", 0, true },
+    { "blowfish-cbc", LV_LIBSSH2_BENCHMARK_KIND_CIPHER, "bf-cbc", 0, true },
+    { "arcfour128", LV_LIBSSH2_BENCHMARK_KIND_CIPHER, "rc4", 0, true },
+    { "arcfour", LV_LIBSSH2_BENCHMARK_KIND_CIPHER, "rc4", 0, true },
+    { "cast128-cbc", LV_LIBSSH2_BENCHMARK_KIND_CIPHER, "cast5-cbc", 0, true },
+    { "3des-cbc", LV_LIBSSH2_BENCHMARK_KIND_CIPHER, "des-ede3-cbc", 0, true },
+    { "hmac-sha2-256-etm@openssh.com", LV_LIBSSH2_BENCHMARK_KIND_MAC, "sha256", 0, false },
+    { "hmac-sha2-512-etm@openssh.com", LV_LIBSSH2_BENCHMARK_KIND_MAC, "sha512", 0, false },
+    { "hmac-sha1-etm@openssh.com", LV_LIBSSH2_BENCHMARK_KIND_MAC, "sha1", 0, false },
+    { "hmac-sha2-256", LV_LIBSSH2_BENCHMARK_KIND_MAC, "sha256", 0, false },
+    { "hmac-sha2-512", LV_LIBSSH2_BENCHMARK_KIND_MAC, "sha512", 0, false },
+    { "hmac-sha1", LV_LIBSSH2_BENCHMARK_KIND_MAC, "sha1", 0, false },
+    { "hmac-ripemd160", LV_LIBSSH2_BENCHMARK_KIND_MAC, "ripemd160", 0, false },
+    { "hmac-ripemd160@openssh.com", LV_LIBSSH2_BENCHMARK_KIND_MAC, "ripemd160", 0, false },
+    { "hmac-sha1-96", LV_LIBSSH2_BENCHMARK_KIND_MAC, "sha1", 0, true },
+    { "hmac-md5", LV_LIBSSH2_BENCHMARK_KIND_MAC, "md5", 0, true },
+    { "hmac-md5-96", LV_LIBSSH2_BENCHMARK_KIND_MAC, "md5", 0, true },
+    { "curve25519-sha256", LV_LIBSSH2_BENCHMARK_KIND_X25519, NULL, 0, false },
+    { "curve25519-sha256@libssh.org", LV_LIBSSH2_BENCHMARK_KIND_X25519, NULL, 0, false },
+    { "ecdh-sha2-nistp256", LV_LIBSSH2_BENCHMARK_KIND_ECDH, NULL, NID_X9_62_prime256v1, false },
+    { "ecdh-sha2-nistp384", LV_LIBSSH2_BENCHMARK_KIND_ECDH, NULL, NID_secp384r1, false },
+    { "ecdh-sha2-nistp521", LV_LIBSSH2_BENCHMARK_KIND_ECDH, NULL, NID_secp521r1, false },
+    // The server picks the group for a group exchange, commonly 3072 bits or
+    // more, and the exchange takes an extra round trip.
+    { "diffie-hellman-group-exchange-sha256", LV_LIBSSH2_BENCHMARK_KIND_DH, NULL, 3072, false },
+    { "diffie-hellman-group14-sha256", LV_LIBSSH2_BENCHMARK_KIND_DH, NULL, 2048, false },
+    { "diffie-hellman-group16-sha512", LV_LIBSSH2_BENCHMARK_KIND_DH, NULL, 4096, false },
+    { "diffie-hellman-group18-sha512", LV_LIBSSH2_BENCHMARK_KIND_DH, NULL, 8192, false },
+    { "diffie-hellman-group14-sha1", LV_LIBSSH2_BENCHMARK_KIND_DH, NULL, 2048, true },
+    { "diffie-hellman-group-exchange-sha1", LV_LIBSSH2_BENCHMARK_KIND_DH, NULL, 3072, true },
+    { "diffie-hellman-group1-sha1", LV_LIBSSH2_BENCHMARK_KIND_DH, NULL, 1024, true },
+};
+
+#define METHOD_COUNT (sizeof(METHODS) / sizeof(METHODS[0]))
+
+static const int PREF_METHODS[PREF_COUNT] = {
+    LIBSSH2_METHOD_KEX,
+    LIBSSH2_METHOD_CRYPT_CS,
+    LIBSSH2_METHOD_MAC_CS
+};
+
+static lv_libssh2_mutex_t benchmark_mutex = LV_LIBSSH2_MUTEX_INITIALIZER;
+static char* benchmark_prefs[PREF_COUNT] = { NULL, NULL, NULL };
+
+/**
+ * The cost of each method in microseconds per packet or per key exchange,
+ * zero if not measured yet, and negative if the primitive is unavailable.
+ */
+typedef struct _lv_libssh2_benchmark_run {
+    double costs[METHOD_COUNT];
+    uint64_t duration_us;
+} lv_libssh2_benchmark_run_t;
+
+static double
+lv_libssh2_benchmark_cipher(
+    const lv_libssh2_benchmark_method_t* method,
+    const uint64_t duration_us,
+    unsigned char* packet
+) {
+    const EVP_CIPHER* cipher = EVP_get_cipherbyname(method->algorithm);
+    if (cipher == NULL) {
+        return -1.0;
+    }
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (ctx == NULL) {
+        return -1.0;
+    }
+    unsigned char key[KEY_SIZE] = { 1 };
+    unsigned char iv[IV_SIZE] = { 2 };
+    unsigned char tag[16];
+    double cost = -1.0;
+    if (EVP_EncryptInit_ex(ctx, cipher, NULL, key, iv) == 1) {
+        bool aead = method->kind == LV_LIBSSH2_BENCHMARK_KIND_AEAD;
+        uint64_t start = lv_libssh2_time_now_us();
+        uint64_t elapsed = 0;
+        uint64_t iterations = 0;
+        bool ok = true;
+        do {
+            int len = 0;
+            // Authenticated ciphers start over with a new nonce for every
+            // packet and produce a tag, which is part of their cost.
+            if (aead) {
+                iv[IV_SIZE - 1] = (unsigned char)iterations;
+                ok = EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, iv) == 1;
+            }
+            ok = ok && EVP_EncryptUpdate(ctx, packet, &len, packet, PACKET_SIZE) == 1;
+            if (aead) {
+                ok = ok
+                    && EVP_EncryptFinal_ex(ctx, packet + len, &len) == 1
+                    && EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, sizeof(tag), tag) == 1;
+            }
+            iterations++;
+            elapsed = lv_libssh2_time_now_us() - start;
+        } while (ok && elapsed < duration_us);
+        if (ok) {
+            cost = (double)elapsed / (double)iterations;
+        }
+    }
+    EVP_CIPHER_CTX_free(ctx);
+    return cost;
+}
+
+static double
+lv_libssh2_benchmark_mac(
+    const lv_libssh2_benchmark_method_t* method,
+    const uint64_t duration_us,
+    unsigned char* packet
+) {
+    const EVP_MD* md = EVP_get_digestbyname(method->algorithm);
+    if (md == NULL) {
+        return -1.0;
+    }
+    unsigned char key[KEY_SIZE] = { 3 };
+    EVP_PKEY* pkey = EVP_PKEY_new_raw_private_key(EVP_PKEY_HMAC, NULL, key, sizeof(key));
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    double cost = -1.0;
+    if (pkey != NULL && ctx != NULL) {
+        unsigned char mac[EVP_MAX_MD_SIZE];
+        uint64_t start = lv_libssh2_time_now_us();
+        uint64_t elapsed = 0;
+        uint64_t iterations = 0;
+        bool ok = true;
+        do {
+            size_t mac_len = sizeof(mac);
+            ok = EVP_DigestSignInit(ctx, NULL, md, NULL, pkey) == 1
+                && EVP_DigestSignUpdate(ctx, packet, PACKET_SIZE) == 1
+                && EVP_DigestSignFinal(ctx, mac, &mac_len) == 1;
+            iterations++;
+            elapsed = lv_libssh2_time_now_us() - start;
+        } while (ok && elapsed < duration_us);
+        if (ok) {
+            cost = (double)elapsed / (double)iterations;
+        }
+    }
+    EVP_MD_CTX_free(ctx);
+    EVP_PKEY_free(pkey);
+    return cost;
+}
+
+static EVP_PKEY*
+lv_libssh2_benchmark_keygen(
+    const lv_libssh2_benchmark_method_t* method
+) {
+    int id = method->kind == LV_LIBSSH2_BENCHMARK_KIND_X25519 ? EVP_PKEY_X25519 : EVP_PKEY_EC;
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(id, NULL);
+    if (ctx == NULL) {
+        return NULL;
+    }
+    EVP_PKEY* key = NULL;
+    if (EVP_PKEY_keygen_init(ctx) != 1
+        || (id == EVP_PKEY_EC && EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, method->parameter) != 1)
+        || EVP_PKEY_keygen(ctx, &key) != 1) {
+        key = NULL;
+    }
+    EVP_PKEY_CTX_free(ctx);
+    return key;
+}
+
+/**
+ * Measures the client side of an elliptic curve key exchange, which is
+ * generating an ephemeral key and deriving the shared secret.
+ */
+static double
+lv_libssh2_benchmark_ecdh(
+    const lv_libssh2_benchmark_method_t* method,
+    const uint64_t duration_us
+) {
+    EVP_PKEY* peer = lv_libssh2_benchmark_keygen(method);
+    if (peer == NULL) {
+        return -1.0;
+    }
+    unsigned char secret[128];
+    uint64_t start = lv_libssh2_time_now_us();
+    uint64_t elapsed = 0;
+    uint64_t iterations = 0;
+    bool ok = true;
+    do {
+        EVP_PKEY* key = lv_libssh2_benchmark_keygen(method);
+        EVP_PKEY_CTX* ctx = key == NULL ? NULL : EVP_PKEY_CTX_new(key, NULL);
+        size_t secret_len = sizeof(secret);
+        ok = ctx != NULL
+            && EVP_PKEY_derive_init(ctx) == 1
+            && EVP_PKEY_derive_set_peer(ctx, peer) == 1
+            && EVP_PKEY_derive(ctx, secret, &secret_len) == 1;
+        EVP_PKEY_CTX_free(ctx);
+        EVP_PKEY_free(key);
+        iterations++;
+        elapsed = lv_libssh2_time_now_us() - start;
+    } while (ok && elapsed < duration_us);
+    EVP_PKEY_free(peer);
+    return ok ? (double)elapsed / (double)iterations : -1.0;
+}
+
+static BIGNUM*
+lv_libssh2_benchmark_prime(
+    const int bits
+) {
+    switch (bits) {
+        case 1024: return BN_get_rfc2409_prime_1024(NULL);
+        case 2048: return BN_get_rfc3526_prime_2048(NULL);
+        case 3072: return BN_get_rfc3526_prime_3072(NULL);
+        case 4096: return BN_get_rfc3526_prime_4096(NULL);
+        case 8192: return BN_get_rfc3526_prime_8192(NULL);
+        default: return NULL;
+    }
+}
+
+/**
+ * Measures the client side of a finite field Diffie-Hellman exchange, which
+ * is two modular exponentiations with an exponent as large as the prime, as
+ * libssh2 uses.
+ */
+static double
+lv_libssh2_benchmark_dh(
+    const lv_libssh2_benchmark_method_t* method,
+    const uint64_t duration_us
+) {
+    BIGNUM* p = lv_libssh2_benchmark_prime(method->parameter);
+    BIGNUM* g = BN_new();
+    BIGNUM* x = BN_new();
+    BIGNUM* e = BN_new();
+    BIGNUM* f = BN_new();
+    BIGNUM* k = BN_new();
+    BN_CTX* ctx = BN_CTX_new();
+    double cost = -1.0;
+    if (p != NULL && g != NULL && x != NULL && e != NULL && f != NULL && k != NULL && ctx != NULL
+        && BN_set_word(g, 2) == 1
+        && BN_rand(x, method->parameter - 1, BN_RAND_TOP_ANY, BN_RAND_BOTTOM_ANY) == 1
+        && BN_mod_exp(f, g, x, p, ctx) == 1) {
+        uint64_t start = lv_libssh2_time_now_us();
+        uint64_t elapsed = 0;
+        uint64_t iterations = 0;
+        bool ok = true;
+        do {
+            ok = BN_mod_exp(e, g, x, p, ctx) == 1 && BN_mod_exp(k, f, x, p, ctx) == 1;
+            iterations++;
+            elapsed = lv_libssh2_time_now_us() - start;
+        } while (ok && elapsed < duration_us);
+        if (ok) {
+            cost = (double)elapsed / (double)iterations;
+        }
+    }
+    BN_CTX_free(ctx);
+    BN_free(k);
+    BN_free(f);
+    BN_free(e);
+    BN_free(x);
+    BN_free(g);
+    BN_free(p);
+    return cost;
+}
+
+/**
+ * Gets the cost of a method, reusing the measurement of an earlier method
+ * with the same primitive.
+ */
+static double
+lv_libssh2_benchmark_cost(
+    lv_libssh2_benchmark_run_t* run,
+    const size_t index,
+    unsigned char* packet
+) {
+    if (run->costs[index] != 0.0) {
+        return run->costs[index];
+    }
+    const lv_libssh2_benchmark_method_t* method = &METHODS[index];
+    for (size_t i = 0; i < index; i++) {
+        const lv_libssh2_benchmark_method_t* other = &METHODS[i];
+        if (run->costs[i] != 0.0
+            && other->kind == method->kind
+            && other->parameter == method->parameter
+            && (other->algorithm == method->algorithm
+                || (other->algorithm != NULL && method->algorithm != NULL && strcmp(other->algorithm, method->algorithm) == 0))) {
+            run->costs[index] = run->costs[i];
+            return run->costs[index];
+        }
+    }
+    double cost = -1.0;
+    switch (method->kind) {
+        case LV_LIBSSH2_BENCHMARK_KIND_CIPHER:
+        case LV_LIBSSH2_BENCHMARK_KIND_AEAD:
+            cost = lv_libssh2_benchmark_cipher(method, run->duration_us, packet);
+            break;
+        case LV_LIBSSH2_BENCHMARK_KIND_MAC:
+            cost = lv_libssh2_benchmark_mac(method, run->duration_us, packet);
+            break;
+        case LV_LIBSSH2_BENCHMARK_KIND_X25519:
+        case LV_LIBSSH2_BENCHMARK_KIND_ECDH:
+            cost = lv_libssh2_benchmark_ecdh(method, run->duration_us);
+            break;
+        case LV_LIBSSH2_BENCHMARK_KIND_DH:
+            cost = lv_libssh2_benchmark_dh(method, run->duration_us);
+            break;
+    }
+    run->costs[index] = cost;
+    return cost;
+}
+
+static int
+lv_libssh2_benchmark_find(
+    const char* name
+) {
+    for (size_t i = 0; i < METHOD_COUNT; i++) {
+        if (strcmp(METHODS[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Builds the preference string for one method type from the methods that
+ * libssh2 supports. Methods that were measured are sorted by cost, cheapest
+ * first, and everything else follows in the order of libssh2, so the string
+ * still lists every supported method. The cost of a cipher without built-in
+ * authentication includes the cheapest MAC.
+ */
+static lv_libssh2_status_t
+lv_libssh2_benchmark_rank(
+    LIBSSH2_SESSION* session,
+    lv_libssh2_benchmark_run_t* run,
+    const int method_type,
+    const double mac_cost,
+    unsigned char* packet,
+    char** pref
+) {
+    *pref = NULL;
+    const char** algs = NULL;
+    int count = libssh2_session_supported_algs(session, method_type, &algs);
+    if (count < 0) {
+        return lv_libssh2_status_from_result(count);
+    }
+    size_t* order = malloc(sizeof(size_t) * (count == 0 ? 1 : (size_t)count));
+    double* costs = malloc(sizeof(double) * (count == 0 ? 1 : (size_t)count));
+    if (order == NULL || costs == NULL) {
+        free(order);
+        free(costs);
+        if (algs != NULL) {
+            libssh2_free(session, algs);
+        }
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    size_t ranked = 0;
+    size_t len = 0;
+    for (int i = 0; i < count; i++) {
+        len += strlen(algs[i]) + 1;
+        int index = lv_libssh2_benchmark_find(algs[i]);
+        if (index < 0 || METHODS[index].legacy) {
+            continue;
+        }
+        double cost = lv_libssh2_benchmark_cost(run, (size_t)index, packet);
+        if (cost < 0.0) {
+            continue;
+        }
+        if (METHODS[index].kind == LV_LIBSSH2_BENCHMARK_KIND_CIPHER && mac_cost > 0.0) {
+            cost += mac_cost;
+        }
+        // Insertion sort keeps the libssh2 order between equal costs, such
+        // as the encrypt-then-MAC and plain variants of the same MAC.
+        size_t position = ranked;
+        while (position > 0 && costs[position - 1] > cost) {
+            order[position] = order[position - 1];
+            costs[position] = costs[position - 1];
+            position--;
+        }
+        order[position] = (size_t)i;
+        costs[position] = cost;
+        ranked++;
+    }
+    char* result = malloc(len + 1);
+    if (result == NULL) {
+        free(order);
+        free(costs);
+        libssh2_free(session, algs);
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    result[0] = '\0';
+    for (size_t i = 0; i < ranked; i++) {
+        if (result[0] != '\0') {
+            strcat(result, ",");
+        }
+        strcat(result, algs[order[i]]);
+    }
+    for (int i = 0; i < count; i++) {
+        bool listed = false;
+        for (size_t j = 0; j < ranked; j++) {
+            listed = listed || order[j] == (size_t)i;
+        }
+        if (!listed) {
+            if (result[0] != '\0') {
+                strcat(result, ",");
+            }
+            strcat(result, algs[i]);
+        }
+    }
+    free(order);
+    free(costs);
+    if (algs != NULL) {
+        libssh2_free(session, algs);
+    }
+    *pref = result;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+/**
+ * Gets the cheapest MAC that is not legacy, or zero if none could be
+ * measured.
+ */
+static double
+lv_libssh2_benchmark_best_mac(
+    LIBSSH2_SESSION* session,
+    lv_libssh2_benchmark_run_t* run,
+    unsigned char* packet
+) {
+    const char** algs = NULL;
+    int count = libssh2_session_supported_algs(session, LIBSSH2_METHOD_MAC_CS, &algs);
+    double best = 0.0;
+    for (int i = 0; i < count; i++) {
+        int index = lv_libssh2_benchmark_find(algs[i]);
+        if (index < 0 || METHODS[index].legacy) {
+            continue;
+        }
+        double cost = lv_libssh2_benchmark_cost(run, (size_t)index, packet);
+        if (cost > 0.0 && (best == 0.0 || cost < best)) {
+            best = cost;
+        }
+    }
+    if (algs != NULL) {
+        libssh2_free(session, algs);
+    }
+    return best;
+}
+
+static lv_libssh2_status_t
+lv_libssh2_benchmark_run_locked(
+    const uint32_t duration_ms
+) {
+    lv_libssh2_benchmark_run_t run;
+    memset(&run, 0, sizeof(run));
+    run.duration_us = (uint64_t)(duration_ms == 0 ? DEFAULT_DURATION_MS : duration_ms) * 1000;
+    unsigned char* packet = calloc(PACKET_SIZE + IV_SIZE, 1);
+    if (packet == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    LIBSSH2_SESSION* session = libssh2_session_init();
+    if (session == NULL) {
+        free(packet);
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    double mac_cost = lv_libssh2_benchmark_best_mac(session, &run, packet);
+    char* prefs[PREF_COUNT] = { NULL, NULL, NULL };
+    lv_libssh2_status_t status = LV_LIBSSH2_STATUS_OK;
+    for (size_t i = 0; i < PREF_COUNT && status == LV_LIBSSH2_STATUS_OK; i++) {
+        status = lv_libssh2_benchmark_rank(session, &run, PREF_METHODS[i], mac_cost, packet, &prefs[i]);
+    }
+    libssh2_session_free(session);
+    free(packet);
+    for (size_t i = 0; i < PREF_COUNT; i++) {
+        if (status == LV_LIBSSH2_STATUS_OK) {
+            free(benchmark_prefs[i]);
+            benchmark_prefs[i] = prefs[i];
+        } else {
+            free(prefs[i]);
+        }
+    }
+    return status;
+}
+
+/**
+ * Gets the index of the stored preference string for a method type, running
+ * the benchmark with the default duration if it has not run yet. The
+ * benchmark lock must be held.
+ */
+static lv_libssh2_status_t
+lv_libssh2_benchmark_pref_index(
+    const lv_libssh2_methods_t method,
+    size_t* index
+) {
+    switch (method) {
+        case LV_LIBSSH2_METHOD_KEX: *index = 0; break;
+        case LV_LIBSSH2_METHOD_CRYPT_CS:
+        case LV_LIBSSH2_METHOD_CRYPT_SC: *index = 1; break;
+        case LV_LIBSSH2_METHOD_MAC_CS:
+        case LV_LIBSSH2_METHOD_MAC_SC: *index = 2; break;
+        default: return LV_LIBSSH2_STATUS_ERROR_METHOD_NOT_SUPPORTED;
+    }
+    if (benchmark_prefs[*index] == NULL) {
+        return lv_libssh2_benchmark_run_locked(0);
+    }
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_benchmark_clear()
+{
+    lv_libssh2_mutex_lock(&benchmark_mutex);
+    for (size_t i = 0; i < PREF_COUNT; i++) {
+        free(benchmark_prefs[i]);
+        benchmark_prefs[i] = NULL;
+    }
+    lv_libssh2_mutex_unlock(&benchmark_mutex);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_benchmark_run(
+    const uint32_t duration_ms
+) {
+    lv_libssh2_mutex_lock(&benchmark_mutex);
+    lv_libssh2_status_t status = lv_libssh2_benchmark_run_locked(duration_ms);
+    lv_libssh2_mutex_unlock(&benchmark_mutex);
+    return status;
+}
+
+lv_libssh2_status_t
+lv_libssh2_benchmark_method_pref_len(
+    const lv_libssh2_methods_t method,
+    size_t* len
+) {
+    if (len == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    size_t index = 0;
+    lv_libssh2_mutex_lock(&benchmark_mutex);
+    lv_libssh2_status_t status = lv_libssh2_benchmark_pref_index(method, &index);
+    if (status == LV_LIBSSH2_STATUS_OK) {
+        *len = strlen(benchmark_prefs[index]);
+    }
+    lv_libssh2_mutex_unlock(&benchmark_mutex);
+    return status;
+}
+
+lv_libssh2_status_t
+lv_libssh2_benchmark_method_pref(
+    const lv_libssh2_methods_t method,
+    uint8_t* buffer
+) {
+    if (buffer == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    size_t index = 0;
+    lv_libssh2_mutex_lock(&benchmark_mutex);
+    lv_libssh2_status_t status = lv_libssh2_benchmark_pref_index(method, &index);
+    if (status == LV_LIBSSH2_STATUS_OK) {
+        memcpy(buffer, benchmark_prefs[index], strlen(benchmark_prefs[index]));
+    }
+    lv_libssh2_mutex_unlock(&benchmark_mutex);
+    return status;
+}
+
+lv_libssh2_status_t
+lv_libssh2_benchmark_apply(
+    lv_libssh2_session_t* session
+) {
+    if (session == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    static const lv_libssh2_methods_t methods[] = {
+        LV_LIBSSH2_METHOD_KEX,
+        LV_LIBSSH2_METHOD_CRYPT_CS,
+        LV_LIBSSH2_METHOD_CRYPT_SC,
+        LV_LIBSSH2_METHOD_MAC_CS,
+        LV_LIBSSH2_METHOD_MAC_SC
+    };
+    lv_libssh2_status_t status = LV_LIBSSH2_STATUS_OK;
+    lv_libssh2_mutex_lock(&benchmark_mutex);
+    for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]) && status == LV_LIBSSH2_STATUS_OK; i++) {
+        size_t index = 0;
+        status = lv_libssh2_benchmark_pref_index(methods[i], &index);
+        if (status == LV_LIBSSH2_STATUS_OK) {
+            lv_libssh2_session_lock(session);
+            int result = libssh2_session_method_pref(session->inner, methods[i], benchmark_prefs[index]);
+            lv_libssh2_session_unlock(session);
+            if (result == 0) {
+                session->method_prefs |= 1u << methods[i];
+            }
+            status = lv_libssh2_status_from_result(result);
+        }
+    }
+    lv_libssh2_mutex_unlock(&benchmark_mutex);
+    return status;
+}
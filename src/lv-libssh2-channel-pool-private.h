@@ -0,0 +1,63 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#ifndef LV_LIBSSH2_CHANNEL_POOL_PRIVATE_H
+#define LV_LIBSSH2_CHANNEL_POOL_PRIVATE_H
+
+#include "lv-libssh2.h"
+
+struct _lv_libssh2_channel_pool {
+    lv_libssh2_session_t* session;
+    lv_libssh2_channel_t** channels;
+    size_t capacity;
+    size_t count;
+    lv_libssh2_status_t status;
+};
+
+/**
+ * Completes the open that a pool has in progress on the session, if any, and
+ * adds the channel to that pool. libssh2 keeps the state of a channel open in
+ * the session and resumes it on the next open of any kind, so every other
+ * channel open on the session calls this first, with the session lock held,
+ * or it would get the channel of the pool. This runs in the current mode, so
+ * it returns LIBSSH2_ERROR_EAGAIN if the server has not answered yet in
+ * non-blocking mode, and otherwise zero. A failed pool open does not fail the
+ * caller and is reported by the next call on the pool.
+ */
+int
+lv_libssh2_channel_pool_settle(
+    lv_libssh2_session_t* session
+);
+
+#endif
+
@@ -0,0 +1,276 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-status-private.h"
+#include "lv-libssh2-session-private.h"
+#include "lv-libssh2-channel-private.h"
+#include "lv-libssh2-channel-pool-private.h"
+#include "lv-libssh2-time-private.h"
+
+/**
+ * Wraps a channel the pool has opened and adds it to the pool. The pool has
+ * room for at least one channel even with a capacity of zero, for the channel
+ * that lv_libssh2_channel_pool_acquire() opens when the pool is empty.
+ */
+static void
+lv_libssh2_channel_pool_add(
+    lv_libssh2_channel_pool_t* handle,
+    LIBSSH2_CHANNEL* inner
+) {
+    lv_libssh2_channel_t* channel = lv_libssh2_channel_alloc(handle->session, inner);
+    if (channel == NULL) {
+        libssh2_channel_free(inner);
+        handle->status = LV_LIBSSH2_STATUS_ERROR_MALLOC;
+        return;
+    }
+    handle->channels[handle->count++] = channel;
+}
+
+/**
+ * Sends or resumes the open request of the pool in the current mode, which is
+ * called with the session lock held. While the open is in progress, the
+ * session points to the pool, so other opens on the session complete it first.
+ * A failed open is kept as the status of the pool for its next call.
+ */
+static int
+lv_libssh2_channel_pool_open(
+    lv_libssh2_channel_pool_t* handle
+) {
+    lv_libssh2_session_t* session = handle->session;
+    LIBSSH2_CHANNEL* inner = libssh2_channel_open_ex(
+        session->inner,
+        "session",
+        sizeof("session") - 1,
+        session->window_size,
+        session->packet_size,
+        NULL,
+        0
+    );
+    int result = inner == NULL ? libssh2_session_last_errno(session->inner) : 0;
+    if (result == LIBSSH2_ERROR_EAGAIN) {
+        session->opening_pool = handle;
+        return result;
+    }
+    session->opening_pool = NULL;
+    if (inner == NULL) {
+        handle->status = lv_libssh2_status_from_result(result);
+        return result;
+    }
+    lv_libssh2_channel_pool_add(handle, inner);
+    return 0;
+}
+
+/**
+ * Gets and clears the status of the pool.
+ */
+static lv_libssh2_status_t
+lv_libssh2_channel_pool_take_status(
+    lv_libssh2_channel_pool_t* handle
+) {
+    lv_libssh2_status_t status = handle->status;
+    handle->status = LV_LIBSSH2_STATUS_OK;
+    return status;
+}
+
+int
+lv_libssh2_channel_pool_settle(
+    lv_libssh2_session_t* session
+) {
+    if (session->opening_pool == NULL) {
+        return 0;
+    }
+    if (lv_libssh2_channel_pool_open(session->opening_pool) == LIBSSH2_ERROR_EAGAIN) {
+        return LIBSSH2_ERROR_EAGAIN;
+    }
+    return 0;
+}
+
+/**
+ * Opens channels without blocking until the pool is full or an open has to
+ * wait for the server, in which case the request has been sent and the open
+ * is resumed by the next call.
+ *
+ * libssh2 allows one channel open in progress per session, so at most one
+ * request is outstanding, but its round trip overlaps whatever the caller does
+ * between pool calls.
+ */
+static lv_libssh2_status_t
+lv_libssh2_channel_pool_advance(
+    lv_libssh2_channel_pool_t* handle
+) {
+    lv_libssh2_session_t* session = handle->session;
+    lv_libssh2_session_lock(session);
+    int blocking = lv_libssh2_session_begin_nonblocking(session);
+    int result = lv_libssh2_channel_pool_settle(session);
+    while (result == 0 && handle->count < handle->capacity && handle->status == LV_LIBSSH2_STATUS_OK) {
+        result = lv_libssh2_channel_pool_open(handle);
+    }
+    lv_libssh2_session_end_nonblocking(session, blocking);
+    lv_libssh2_session_unlock(session);
+    return lv_libssh2_channel_pool_take_status(handle);
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_pool_create(
+    lv_libssh2_session_t* session,
+    const size_t capacity,
+    lv_libssh2_channel_pool_t** handle
+) {
+    *handle = NULL;
+    if (session == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_channel_pool_t* pool = malloc(sizeof(lv_libssh2_channel_pool_t));
+    if (pool == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    pool->channels = malloc(sizeof(lv_libssh2_channel_t*) * (capacity == 0 ? 1 : capacity));
+    if (pool->channels == NULL) {
+        free(pool);
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    pool->session = session;
+    pool->capacity = capacity;
+    pool->count = 0;
+    pool->status = LV_LIBSSH2_STATUS_OK;
+    lv_libssh2_status_t status = lv_libssh2_channel_pool_advance(pool);
+    if (lv_libssh2_status_is_err(status)) {
+        lv_libssh2_channel_pool_destroy(pool);
+        return status;
+    }
+    *handle = pool;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_pool_destroy(
+    lv_libssh2_channel_pool_t* handle
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_session_t* session = handle->session;
+    lv_libssh2_session_lock(session);
+    bool opening = session->opening_pool == handle;
+    lv_libssh2_session_unlock(session);
+    if (opening) {
+        // libssh2 cannot cancel an open, so it is completed to leave the
+        // session ready for the next one.
+        long timeout_ms = libssh2_session_get_timeout(session->inner);
+        uint64_t deadline = timeout_ms > 0
+            ? lv_libssh2_time_deadline_us((int32_t)timeout_ms)
+            : LV_LIBSSH2_TIME_NO_DEADLINE;
+        lv_libssh2_session_lock(session);
+        int blocking = lv_libssh2_session_begin_nonblocking(session);
+        lv_libssh2_session_unlock(session);
+        for (;;) {
+            lv_libssh2_session_lock(session);
+            int result = session->opening_pool == handle ? lv_libssh2_channel_pool_open(handle) : 0;
+            lv_libssh2_session_unlock(session);
+            if (result != LIBSSH2_ERROR_EAGAIN) {
+                break;
+            }
+            if (lv_libssh2_status_is_err(lv_libssh2_session_wait_socket(session, deadline))) {
+                break;
+            }
+        }
+        lv_libssh2_session_lock(session);
+        lv_libssh2_session_end_nonblocking(session, blocking);
+        if (session->opening_pool == handle) {
+            session->opening_pool = NULL;
+        }
+        lv_libssh2_session_unlock(session);
+    }
+    for (size_t i = 0; i < handle->count; i++) {
+        lv_libssh2_channel_destroy(handle->channels[i]);
+    }
+    free(handle->channels);
+    handle->channels = NULL;
+    free(handle);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_pool_acquire(
+    lv_libssh2_channel_pool_t* handle,
+    lv_libssh2_channel_t** channel
+) {
+    if (channel == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *channel = NULL;
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_status_t status = lv_libssh2_channel_pool_advance(handle);
+    if (handle->count == 0 && !lv_libssh2_status_is_err(status)) {
+        // The pool is empty, so a channel is opened in the mode of the caller.
+        lv_libssh2_session_lock(handle->session);
+        int result = lv_libssh2_channel_pool_settle(handle->session);
+        if (result == 0 && handle->count == 0) {
+            result = lv_libssh2_channel_pool_open(handle);
+        }
+        lv_libssh2_session_unlock(handle->session);
+        status = result == LIBSSH2_ERROR_EAGAIN
+            ? lv_libssh2_status_from_result(result)
+            : lv_libssh2_channel_pool_take_status(handle);
+    }
+    if (handle->count == 0) {
+        return status;
+    }
+    *channel = handle->channels[--handle->count];
+    lv_libssh2_channel_pool_advance(handle);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_pool_refill(
+    lv_libssh2_channel_pool_t* handle,
+    size_t* available
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (available == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_status_t status = lv_libssh2_channel_pool_advance(handle);
+    *available = handle->count;
+    return status;
+}
@@ -34,11 +34,63 @@
 #ifndef LV_LIBSSH2_CHANNEL_PRIVATE_H
 #define LV_LIBSSH2_CHANNEL_PRIVATE_H
 
+#include <stdbool.h>
+
 #include "lv-libssh2.h"
+#include "lv-libssh2-thread-private.h"
 
 struct _lv_libssh2_channel {
     LIBSSH2_CHANNEL* inner;
+    lv_libssh2_session_t* session;
+    uint32_t window_size;
+    uint32_t packet_size;
+    lv_libssh2_channel_window_modes_t window_mode;
+    uint32_t window_max;
+    uint32_t window_target;
+    uint64_t rtt_us;
+    uint64_t rate;
+    uint64_t sample_start_us;
+    uint64_t sample_bytes;
+    char* gather_buffer;
+    uint8_t* message_buffer;
+    size_t message_buffer_len;
+    size_t message_buffer_capacity;
+    size_t message_sent;
+    char* output;
+    size_t output_len;
+    size_t output_capacity;
+    char* stderr_output;
+    size_t stderr_output_len;
+    size_t stderr_output_capacity;
+    lv_libssh2_terminal_t* terminal;
+    char* coalesce_buffer;
+    size_t coalesce_len;
+    size_t coalesce_threshold;
+    uint64_t coalesce_delay_us;
+    uint64_t coalesce_start_us;
+    lv_libssh2_mutex_t coalesce_lock;
+    bool flush_scheduled;
 };
 
+/**
+ * Checks whether the remote end has sent end of file on the channel.
+ */
+bool
+lv_libssh2_channel_at_eof(
+    lv_libssh2_channel_t* handle
+);
+
+/**
+ * Allocates the wrapper for a libssh2 channel that has already been opened.
+ *
+ * Returns NULL if memory could not be allocated, in which case the caller
+ * still owns the inner channel.
+ */
+lv_libssh2_channel_t*
+lv_libssh2_channel_alloc(
+    lv_libssh2_session_t* session,
+    LIBSSH2_CHANNEL* inner
+);
+
 #endif
 
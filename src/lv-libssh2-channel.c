@@ -33,6 +33,7 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "libssh2.h"
 
@@ -41,34 +42,318 @@
 #include "lv-libssh2-session-private.h"
 #include "lv-libssh2-listener-private.h"
 #include "lv-libssh2-channel-private.h"
+#include "lv-libssh2-channel-pool-private.h"
+#include "lv-libssh2-keepalive-private.h"
+#include "lv-libssh2-memory-private.h"
+#include "lv-libssh2-profile-private.h"
+#include "lv-libssh2-time-private.h"
+
+#define ADAPTIVE_SAMPLE_INTERVAL_US 100000
+#define MICROSECONDS_PER_SECOND 1000000
+#define READ_CHUNK_SIZE 16384
+
+lv_libssh2_channel_t*
+lv_libssh2_channel_alloc(
+    lv_libssh2_session_t* session,
+    LIBSSH2_CHANNEL* inner
+) {
+    lv_libssh2_channel_t* channel = lv_libssh2_memory_session_alloc(session, sizeof(lv_libssh2_channel_t));
+    if (channel == NULL) {
+        return NULL;
+    }
+    channel->inner = inner;
+    channel->session = session;
+    channel->window_size = session->window_size;
+    channel->packet_size = session->packet_size;
+    channel->window_mode = LV_LIBSSH2_CHANNEL_WINDOW_MODE_FIXED;
+    channel->window_max = session->window_size;
+    channel->window_target = session->window_size;
+    channel->rtt_us = 0;
+    channel->rate = 0;
+    channel->sample_start_us = 0;
+    channel->sample_bytes = 0;
+    channel->gather_buffer = NULL;
+    channel->message_buffer = NULL;
+    channel->message_buffer_len = 0;
+    channel->message_buffer_capacity = 0;
+    channel->message_sent = 0;
+    channel->output = NULL;
+    channel->output_len = 0;
+    channel->output_capacity = 0;
+    channel->stderr_output = NULL;
+    channel->stderr_output_len = 0;
+    channel->stderr_output_capacity = 0;
+    channel->terminal = NULL;
+    channel->coalesce_buffer = NULL;
+    channel->coalesce_len = 0;
+    channel->coalesce_threshold = 0;
+    channel->coalesce_delay_us = 0;
+    channel->coalesce_start_us = 0;
+    channel->flush_scheduled = false;
+    return channel;
+}
+
+/**
+ * Sends the writes held back by coalescing. The coalescing lock must be held.
+ */
+static lv_libssh2_status_t
+lv_libssh2_channel_send_held(
+    lv_libssh2_channel_t* handle
+) {
+    size_t sent = 0;
+    int result = 0;
+    uint64_t deadline = 0;
+    while (sent < handle->coalesce_len) {
+        uint64_t start = lv_libssh2_time_now_us();
+        ssize_t written = 0;
+        do {
+            lv_libssh2_session_lock_io(handle->session);
+            written = libssh2_channel_write_ex(
+                handle->inner,
+                0,
+                handle->coalesce_buffer + sent,
+                handle->coalesce_len - sent
+            );
+            if (written > 0) {
+                lv_libssh2_profile_record(handle->session, handle->coalesce_buffer + sent, (size_t)written, start);
+            }
+        } while (lv_libssh2_session_unlock_io(handle->session, &written, &deadline));
+        if (written < 0) {
+            result = (int)written;
+            break;
+        }
+        sent += written;
+    }
+    memmove(handle->coalesce_buffer, handle->coalesce_buffer + sent, handle->coalesce_len - sent);
+    handle->coalesce_len -= sent;
+    return lv_libssh2_status_from_result(result);
+}
+
+/**
+ * Adds a small write to the held writes and sends them once the threshold is
+ * reached or the delay has passed, or otherwise has the scheduler thread send
+ * them when the delay passes. The coalescing lock must be held.
+ */
+static lv_libssh2_status_t
+lv_libssh2_channel_hold(
+    lv_libssh2_channel_t* handle,
+    const char* buffer,
+    const size_t buffer_len,
+    size_t* byte_count
+) {
+    uint64_t now = lv_libssh2_time_now_us();
+    size_t held = handle->coalesce_len;
+    if (held == 0) {
+        handle->coalesce_start_us = now;
+    }
+    memcpy(handle->coalesce_buffer + held, buffer, buffer_len);
+    handle->coalesce_len += buffer_len;
+    *byte_count = buffer_len;
+    lv_libssh2_status_t status = LV_LIBSSH2_STATUS_OK;
+    if (handle->coalesce_len >= handle->coalesce_threshold
+        || now - handle->coalesce_start_us >= handle->coalesce_delay_us) {
+        status = lv_libssh2_channel_send_held(handle);
+        if (status == LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN) {
+            status = LV_LIBSSH2_STATUS_OK;
+        } else if (lv_libssh2_status_is_err(status)) {
+            // The earlier writes were already reported as written, so only
+            // the part of this one that went out is, and the rest is dropped.
+            size_t sent = held + buffer_len - handle->coalesce_len;
+            size_t written = sent > held ? sent - held : 0;
+            handle->coalesce_len -= buffer_len - written;
+            *byte_count = written;
+            return status;
+        }
+    }
+    if (handle->coalesce_len > 0 && !handle->flush_scheduled) {
+        status = lv_libssh2_keepalive_schedule_flush(
+            handle,
+            handle->coalesce_start_us + handle->coalesce_delay_us
+        );
+    }
+    return status;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_flush_writes(
+    lv_libssh2_channel_t* handle
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (handle->coalesce_buffer == NULL) {
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    lv_libssh2_mutex_lock(&handle->coalesce_lock);
+    lv_libssh2_status_t status = lv_libssh2_channel_send_held(handle);
+    lv_libssh2_mutex_unlock(&handle->coalesce_lock);
+    return status;
+}
+
+bool
+lv_libssh2_channel_at_eof(
+    lv_libssh2_channel_t* handle
+) {
+    lv_libssh2_session_lock(handle->session);
+    int eof = libssh2_channel_eof(handle->inner);
+    lv_libssh2_session_unlock(handle->session);
+    return eof == 1;
+}
+
+/**
+ * Switches the session to non-blocking mode for the duration of a looping
+ * operation, so that waits on the socket can honor a deadline, and returns
+ * the previous mode to restore with lv_libssh2_channel_end_loop().
+ */
+static int
+lv_libssh2_channel_begin_loop(
+    lv_libssh2_channel_t* handle
+) {
+    lv_libssh2_session_lock(handle->session);
+    int blocking = lv_libssh2_session_begin_nonblocking(handle->session);
+    lv_libssh2_session_unlock(handle->session);
+    return blocking;
+}
+
+static void
+lv_libssh2_channel_end_loop(
+    lv_libssh2_channel_t* handle,
+    const int blocking
+) {
+    lv_libssh2_session_lock(handle->session);
+    lv_libssh2_session_end_nonblocking(handle->session, blocking);
+    lv_libssh2_session_unlock(handle->session);
+}
+
+/**
+ * Tops up the receive window for a channel in the adaptive window mode.
+ *
+ * The target window is doubled whenever the remote end has (nearly) run out of
+ * window, which means the window, not the link, was limiting throughput. When a
+ * round trip time is known, the target is also kept at twice the measured
+ * bandwidth-delay product. libssh2 only refills the window to the size used to
+ * open the channel, so the difference is granted here before each read.
+ */
+static void
+lv_libssh2_channel_adapt_window(
+    lv_libssh2_channel_t* handle,
+    const size_t byte_count
+) {
+    if (handle->window_mode != LV_LIBSSH2_CHANNEL_WINDOW_MODE_ADAPTIVE) {
+        return;
+    }
+    uint64_t now = lv_libssh2_time_now_us();
+    if (handle->sample_start_us == 0) {
+        handle->sample_start_us = now;
+    }
+    handle->sample_bytes += byte_count;
+    uint64_t elapsed = now - handle->sample_start_us;
+    if (elapsed >= ADAPTIVE_SAMPLE_INTERVAL_US) {
+        uint64_t rate = handle->sample_bytes * MICROSECONDS_PER_SECOND / elapsed;
+        handle->rate = handle->rate == 0 ? rate : (handle->rate * 3 + rate) / 4;
+        handle->sample_start_us = now;
+        handle->sample_bytes = 0;
+    }
+    lv_libssh2_session_lock(handle->session);
+    unsigned long remaining = libssh2_channel_window_read(handle->inner);
+    lv_libssh2_session_unlock(handle->session);
+    uint64_t target = handle->window_target;
+    if (remaining < handle->packet_size) {
+        target *= 2;
+    }
+    if (handle->rtt_us > 0) {
+        uint64_t bdp = handle->rate * handle->rtt_us / MICROSECONDS_PER_SECOND;
+        if (bdp * 2 > target) {
+            target = bdp * 2;
+        }
+    }
+    if (target > handle->window_max) {
+        target = handle->window_max;
+    }
+    if (target < handle->window_size) {
+        target = handle->window_size;
+    }
+    handle->window_target = (uint32_t)target;
+    if (remaining < target / 2) {
+        lv_libssh2_session_lock(handle->session);
+        libssh2_channel_receive_window_adjust2(
+            handle->inner,
+            (unsigned long)(target - remaining),
+            0,
+            NULL
+        );
+        lv_libssh2_session_unlock(handle->session);
+    }
+}
 
 lv_libssh2_status_t
 lv_libssh2_channel_create(
     lv_libssh2_session_t* session,
     lv_libssh2_channel_t** handle
+) {
+    return lv_libssh2_channel_create_ex(session, 0, 0, handle);
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_create_ex(
+    lv_libssh2_session_t* session,
+    const uint32_t window_size,
+    const uint32_t packet_size,
+    lv_libssh2_channel_t** handle
 ) {
     *handle = NULL;
     if (session == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
-    LIBSSH2_CHANNEL* inner = libssh2_channel_open_ex(
-        session->inner,
-        "session",
-        sizeof("session") - 1,
-        LIBSSH2_CHANNEL_WINDOW_DEFAULT,
-        LIBSSH2_CHANNEL_PACKET_DEFAULT,
-        NULL,
-        0
-    );
+    if (packet_size > LIBSSH2_CHANNEL_PACKET_DEFAULT) {
+        return LV_LIBSSH2_STATUS_ERROR_INVALID_PACKET_SIZE;
+    }
+    uint32_t actual_window_size = window_size == 0 ? session->window_size : window_size;
+    uint32_t actual_packet_size = packet_size == 0 ? session->packet_size : packet_size;
+    if (window_size != 0 && window_size < actual_packet_size) {
+        return LV_LIBSSH2_STATUS_ERROR_INVALID_WINDOW_SIZE;
+    }
+    uint64_t rtt_us = 0;
+    lv_libssh2_session_lock(session);
+    LIBSSH2_CHANNEL* inner = NULL;
+    int error_code = lv_libssh2_channel_pool_settle(session);
+    if (error_code == 0) {
+        // Only the open itself is timed, so neither waiting for the lock nor
+        // finishing the open of a pool inflates the round trip time.
+        uint64_t start = lv_libssh2_time_now_us();
+        inner = libssh2_channel_open_ex(
+            session->inner,
+            "session",
+            sizeof("session") - 1,
+            actual_window_size,
+            actual_packet_size,
+            NULL,
+            0
+        );
+        error_code = inner == NULL ? libssh2_session_last_errno(session->inner) : 0;
+        // The open is a single round trip only if it did not have to be
+        // resumed after a LIBSSH2_ERROR_EAGAIN, which cannot happen in
+        // blocking mode.
+        if (inner != NULL && libssh2_session_get_blocking(session->inner)) {
+            rtt_us = lv_libssh2_time_now_us() - start;
+        }
+    }
+    lv_libssh2_session_unlock(session);
     if (inner == NULL) {
-        return lv_libssh2_status_from_result(libssh2_session_last_errno(session->inner));
+        return lv_libssh2_status_from_result(error_code);
     }
-    lv_libssh2_channel_t* channel = malloc(sizeof(lv_libssh2_channel_t));
+    lv_libssh2_channel_t* channel = lv_libssh2_channel_alloc(session, inner);
     if (channel == NULL) {
+        lv_libssh2_session_lock(session);
         libssh2_channel_free(inner);
+        lv_libssh2_session_unlock(session);
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
-    channel->inner = inner;
+    channel->window_size = actual_window_size;
+    channel->packet_size = actual_packet_size;
+    channel->window_max = actual_window_size;
+    channel->window_target = actual_window_size;
+    channel->rtt_us = rtt_us;
     *handle = channel;
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -80,9 +365,29 @@ lv_libssh2_channel_destroy(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    if (handle->coalesce_buffer != NULL) {
+        lv_libssh2_channel_flush_writes(handle);
+        lv_libssh2_keepalive_cancel_flush(handle);
+    }
+    lv_libssh2_session_lock(handle->session);
     libssh2_channel_free(handle->inner);
+    lv_libssh2_session_unlock(handle->session);
     handle->inner = NULL;
-    free(handle);
+    lv_libssh2_session_t* session = handle->session;
+    lv_libssh2_memory_session_free(session, handle->gather_buffer);
+    handle->gather_buffer = NULL;
+    lv_libssh2_memory_session_free(session, handle->message_buffer);
+    handle->message_buffer = NULL;
+    free(handle->output);
+    handle->output = NULL;
+    free(handle->stderr_output);
+    handle->stderr_output = NULL;
+    if (handle->coalesce_buffer != NULL) {
+        lv_libssh2_mutex_destroy(&handle->coalesce_lock);
+    }
+    lv_libssh2_memory_session_free(session, handle->coalesce_buffer);
+    handle->coalesce_buffer = NULL;
+    lv_libssh2_memory_session_free(session, handle);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -93,7 +398,13 @@ lv_libssh2_channel_close(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_status_t status = lv_libssh2_channel_flush_writes(handle);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_channel_close(handle->inner);
+    lv_libssh2_session_unlock(handle->session);
     return lv_libssh2_status_from_result(result);
 }
 
@@ -107,10 +418,30 @@ lv_libssh2_channel_read(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
-    ssize_t result = libssh2_channel_read_ex(handle->inner, 0, buffer, buffer_len);
+    if (handle->coalesce_buffer != NULL) {
+        lv_libssh2_status_t status = lv_libssh2_channel_flush_writes(handle);
+        if (lv_libssh2_status_is_err(status) && status != LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN) {
+            return status;
+        }
+    }
+    lv_libssh2_channel_adapt_window(handle, 0);
+    uint64_t start = lv_libssh2_time_now_us();
+    uint64_t deadline = 0;
+    ssize_t result = 0;
+    do {
+        lv_libssh2_session_lock_io(handle->session);
+        result = libssh2_channel_read_ex(handle->inner, 0, buffer, buffer_len);
+        if (result > 0) {
+            lv_libssh2_profile_record(handle->session, buffer, (size_t)result, start);
+        }
+    } while (lv_libssh2_session_unlock_io(handle->session, &result, &deadline));
     if (result < 0) {
         return lv_libssh2_status_from_result((int)result);
     }
+    lv_libssh2_channel_adapt_window(handle, (size_t)result);
+    if (handle->terminal != NULL) {
+        lv_libssh2_terminal_feed(handle->terminal, (const uint8_t*)buffer, (size_t)result);
+    }
     *byte_count = result;
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -131,14 +462,253 @@ lv_libssh2_channel_read_stderr(
     if (byte_count == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
-    size_t result = libssh2_channel_read_ex(handle->inner, SSH_EXTENDED_DATA_STDERR, buffer, buffer_len);
+    if (handle->coalesce_buffer != NULL) {
+        lv_libssh2_status_t status = lv_libssh2_channel_flush_writes(handle);
+        if (lv_libssh2_status_is_err(status) && status != LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN) {
+            return status;
+        }
+    }
+    lv_libssh2_channel_adapt_window(handle, 0);
+    uint64_t start = lv_libssh2_time_now_us();
+    uint64_t deadline = 0;
+    ssize_t result = 0;
+    do {
+        lv_libssh2_session_lock_io(handle->session);
+        result = libssh2_channel_read_ex(handle->inner, SSH_EXTENDED_DATA_STDERR, buffer, buffer_len);
+        if (result > 0) {
+            lv_libssh2_profile_record(handle->session, buffer, (size_t)result, start);
+        }
+    } while (lv_libssh2_session_unlock_io(handle->session, &result, &deadline));
     if (result < 0) {
         return lv_libssh2_status_from_result((int)result);
     }
+    lv_libssh2_channel_adapt_window(handle, (size_t)result);
     *byte_count = result;
     return LV_LIBSSH2_STATUS_OK;
 }
 
+lv_libssh2_status_t
+lv_libssh2_channel_read_exact(
+    lv_libssh2_channel_t* handle,
+    char* buffer,
+    const size_t buffer_len,
+    const int32_t timeout_ms,
+    size_t* byte_count
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (buffer == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (byte_count == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *byte_count = 0;
+    uint64_t deadline = lv_libssh2_time_deadline_us(timeout_ms);
+    int blocking = lv_libssh2_channel_begin_loop(handle);
+    lv_libssh2_status_t status = LV_LIBSSH2_STATUS_OK;
+    while (*byte_count < buffer_len) {
+        size_t count = 0;
+        status = lv_libssh2_channel_read(handle, buffer + *byte_count, buffer_len - *byte_count, &count);
+        if (status == LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN) {
+            status = lv_libssh2_session_wait_socket(handle->session, deadline);
+            if (lv_libssh2_status_is_err(status)) {
+                break;
+            }
+            continue;
+        }
+        if (lv_libssh2_status_is_err(status)) {
+            break;
+        }
+        if (count == 0 && lv_libssh2_channel_at_eof(handle)) {
+            status = LV_LIBSSH2_STATUS_ERROR_CHANNEL_CLOSED;
+            break;
+        }
+        *byte_count += count;
+    }
+    lv_libssh2_channel_end_loop(handle, blocking);
+    return status;
+}
+
+/**
+ * Reads what is available from one stream into one of the output buffers of
+ * the channel, growing it as needed. Nothing being available is not an error
+ * and reads zero bytes.
+ */
+static lv_libssh2_status_t
+lv_libssh2_channel_read_output(
+    lv_libssh2_channel_t* handle,
+    const int stream_id,
+    char** output,
+    size_t* output_len,
+    size_t* output_capacity,
+    const size_t max_len,
+    size_t* count
+) {
+    if (*output_capacity - *output_len < READ_CHUNK_SIZE) {
+        size_t capacity = *output_capacity == 0 ? READ_CHUNK_SIZE : *output_capacity * 2;
+        char* buffer = realloc(*output, capacity);
+        if (buffer == NULL) {
+            return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+        }
+        *output = buffer;
+        *output_capacity = capacity;
+    }
+    lv_libssh2_status_t status;
+    if (stream_id == SSH_EXTENDED_DATA_STDERR) {
+        status = lv_libssh2_channel_read_stderr(handle, *output + *output_len, *output_capacity - *output_len, count);
+    } else {
+        status = lv_libssh2_channel_read(handle, *output + *output_len, *output_capacity - *output_len, count);
+    }
+    if (status == LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN) {
+        *count = 0;
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    *output_len += *count;
+    if (max_len > 0 && *output_len > max_len) {
+        *output_len = max_len;
+        return LV_LIBSSH2_STATUS_ERROR_OUTPUT_LIMIT_EXCEEDED;
+    }
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_read_to_end(
+    lv_libssh2_channel_t* handle,
+    const size_t max_len,
+    const int32_t timeout_ms,
+    size_t* len
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (len == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    handle->output_len = 0;
+    handle->stderr_output_len = 0;
+    uint64_t deadline = lv_libssh2_time_deadline_us(timeout_ms);
+    int blocking = lv_libssh2_channel_begin_loop(handle);
+    lv_libssh2_status_t status = LV_LIBSSH2_STATUS_OK;
+    for (;;) {
+        // Stderr is drained along with stdout, because a command blocked on a
+        // full stderr pipe never sends EOF.
+        size_t count = 0;
+        status = lv_libssh2_channel_read_output(
+            handle,
+            0,
+            &handle->output,
+            &handle->output_len,
+            &handle->output_capacity,
+            max_len,
+            &count
+        );
+        if (lv_libssh2_status_is_err(status)) {
+            break;
+        }
+        size_t stderr_count = 0;
+        status = lv_libssh2_channel_read_output(
+            handle,
+            SSH_EXTENDED_DATA_STDERR,
+            &handle->stderr_output,
+            &handle->stderr_output_len,
+            &handle->stderr_output_capacity,
+            max_len,
+            &stderr_count
+        );
+        if (lv_libssh2_status_is_err(status)) {
+            break;
+        }
+        if (count == 0 && stderr_count == 0) {
+            if (lv_libssh2_channel_at_eof(handle)) {
+                break;
+            }
+            status = lv_libssh2_session_wait_socket(handle->session, deadline);
+            if (lv_libssh2_status_is_err(status)) {
+                break;
+            }
+        }
+    }
+    lv_libssh2_channel_end_loop(handle, blocking);
+    *len = handle->output_len;
+    return status;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_output_len(
+    lv_libssh2_channel_t* handle,
+    size_t* len
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (len == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *len = handle->output_len;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_output(
+    lv_libssh2_channel_t* handle,
+    uint8_t* buffer,
+    const size_t buffer_len
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (buffer == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (buffer_len < handle->output_len) {
+        return LV_LIBSSH2_STATUS_ERROR_BUFFER_TOO_SMALL;
+    }
+    if (handle->output_len > 0) {
+        memcpy(buffer, handle->output, handle->output_len);
+    }
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_stderr_output_len(
+    lv_libssh2_channel_t* handle,
+    size_t* len
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (len == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *len = handle->stderr_output_len;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_stderr_output(
+    lv_libssh2_channel_t* handle,
+    uint8_t* buffer,
+    const size_t buffer_len
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (buffer == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (buffer_len < handle->stderr_output_len) {
+        return LV_LIBSSH2_STATUS_ERROR_BUFFER_TOO_SMALL;
+    }
+    if (handle->stderr_output_len > 0) {
+        memcpy(buffer, handle->stderr_output, handle->stderr_output_len);
+    }
+    return LV_LIBSSH2_STATUS_OK;
+}
 
 lv_libssh2_status_t
 lv_libssh2_channel_direct_tcpip(
@@ -159,16 +729,24 @@ lv_libssh2_channel_direct_tcpip(
     if (server_host == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
-    LIBSSH2_CHANNEL* inner = libssh2_channel_direct_tcpip_ex(session->inner, host, port, server_host, server_port);
+    lv_libssh2_session_lock(session);
+    LIBSSH2_CHANNEL* inner = NULL;
+    int error_code = lv_libssh2_channel_pool_settle(session);
+    if (error_code == 0) {
+        inner = libssh2_channel_direct_tcpip_ex(session->inner, host, port, server_host, server_port);
+        error_code = inner == NULL ? libssh2_session_last_errno(session->inner) : 0;
+    }
+    lv_libssh2_session_unlock(session);
     if (inner == NULL) {
-        return lv_libssh2_status_from_result(libssh2_session_last_errno(session->inner));
+        return lv_libssh2_status_from_result(error_code);
     }
-    lv_libssh2_channel_t* channel = malloc(sizeof(lv_libssh2_channel_t));
+    lv_libssh2_channel_t* channel = lv_libssh2_channel_alloc(session, inner);
     if (channel == NULL) {
+        lv_libssh2_session_lock(session);
         libssh2_channel_free(inner);
+        lv_libssh2_session_unlock(session);
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
-    channel->inner = inner;
     *handle = channel;
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -181,7 +759,9 @@ lv_libssh2_channel_eof(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_channel_eof(handle->inner);
+    lv_libssh2_session_unlock(handle->session);
     if (result < 0) {
         return lv_libssh2_status_from_result(result);
     }
@@ -196,7 +776,13 @@ lv_libssh2_channel_flush(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_status_t status = lv_libssh2_channel_flush_writes(handle);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_channel_flush_ex(handle->inner, 0);
+    lv_libssh2_session_unlock(handle->session);
     return lv_libssh2_status_from_result(result);
 }
 
@@ -213,16 +799,20 @@ lv_libssh2_channel_forward_accept(
     if (listener == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(session);
     LIBSSH2_CHANNEL* inner = libssh2_channel_forward_accept(listener->inner);
+    int error_code = inner == NULL ? libssh2_session_last_errno(session->inner) : 0;
+    lv_libssh2_session_unlock(session);
     if (inner == NULL) {
-        return lv_libssh2_status_from_result(libssh2_session_last_errno(session->inner));
+        return lv_libssh2_status_from_result(error_code);
     }
-    lv_libssh2_channel_t* channel = malloc(sizeof(lv_libssh2_channel_t));
+    lv_libssh2_channel_t* channel = lv_libssh2_channel_alloc(session, inner);
     if (channel == NULL) {
+        lv_libssh2_session_lock(session);
         libssh2_channel_free(inner);
+        lv_libssh2_session_unlock(session);
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
-    channel->inner = inner;
     *handle = channel;
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -234,7 +824,9 @@ lv_libssh2_channel_forward_cancel(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_channel_forward_cancel(handle->inner);
+    lv_libssh2_session_unlock(handle->session);
     if (result < 0) {
         return lv_libssh2_status_from_result(result);
     }
@@ -253,16 +845,22 @@ lv_libssh2_channel_forward_listen(
     if (session == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(session);
     LIBSSH2_LISTENER* inner = libssh2_channel_forward_listen_ex(session->inner, NULL, port, NULL, 16);
+    int error_code = inner == NULL ? libssh2_session_last_errno(session->inner) : 0;
+    lv_libssh2_session_unlock(session);
     if (inner == NULL) {
-        return lv_libssh2_status_from_result(libssh2_session_last_errno(session->inner));
+        return lv_libssh2_status_from_result(error_code);
     }
     lv_libssh2_listener_t* listener = malloc(sizeof(lv_libssh2_listener_t));
     if (listener == NULL) {
+        lv_libssh2_session_lock(session);
         libssh2_channel_forward_cancel(inner);
+        lv_libssh2_session_unlock(session);
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
     listener->inner = inner;
+    listener->session = session;
     *handle = listener;
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -274,7 +872,9 @@ lv_libssh2_channel_exit_status(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_channel_get_exit_status(handle->inner);
+    lv_libssh2_session_unlock(handle->session);
     return lv_libssh2_status_from_result(result);
 }
 
@@ -291,7 +891,9 @@ lv_libssh2_channel_set_ignore_mode(
         case LV_LIBSSH2_IGNORE_MODES_NORMAL:
         case LV_LIBSSH2_IGNORE_MODES_MERGE:
         case LV_LIBSSH2_IGNORE_MODES_IGNORE:
+            lv_libssh2_session_lock(handle->session);
             result = libssh2_channel_handle_extended_data2(handle->inner, mode);
+            lv_libssh2_session_unlock(handle->session);
             return lv_libssh2_status_from_result(result);
         default: return LV_LIBSSH2_STATUS_ERROR_UNKNOWN_IGNORE_MODE;
     }
@@ -304,6 +906,7 @@ lv_libssh2_channel_shell(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_channel_process_startup(
         handle->inner,
         "shell",
@@ -311,6 +914,7 @@ lv_libssh2_channel_shell(
         NULL,
         0
     );
+    lv_libssh2_session_unlock(handle->session);
     return lv_libssh2_status_from_result(result);
 }
 
@@ -323,6 +927,7 @@ lv_libssh2_channel_exec(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_channel_process_startup(
         handle->inner,
         "exec",
@@ -330,6 +935,7 @@ lv_libssh2_channel_exec(
         command,
         (unsigned int)command_len
     );
+    lv_libssh2_session_unlock(handle->session);
     return lv_libssh2_status_from_result(result);
 }
 
@@ -342,6 +948,7 @@ lv_libssh2_channel_subsystem(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_channel_process_startup(
         handle->inner,
         "subsystem",
@@ -349,6 +956,7 @@ lv_libssh2_channel_subsystem(
         subsystem,
         (unsigned int)subsystem_len
     );
+    lv_libssh2_session_unlock(handle->session);
     return lv_libssh2_status_from_result(result);
 }
 
@@ -365,15 +973,79 @@ lv_libssh2_channel_receive_window_adjust(
     if (window == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_channel_receive_window_adjust2(
         handle->inner,
         (unsigned long)adjustment,
         (unsigned char)force,
         window
     );
+    lv_libssh2_session_unlock(handle->session);
     return lv_libssh2_status_from_result(result);
 }
 
+lv_libssh2_status_t
+lv_libssh2_channel_set_window_mode(
+    lv_libssh2_channel_t* handle,
+    const lv_libssh2_channel_window_modes_t mode,
+    const uint32_t max_window_size
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    switch (mode) {
+        case LV_LIBSSH2_CHANNEL_WINDOW_MODE_FIXED:
+            handle->window_max = handle->window_size;
+            break;
+        case LV_LIBSSH2_CHANNEL_WINDOW_MODE_ADAPTIVE:
+            if (max_window_size == 0) {
+                uint64_t window_max = (uint64_t)handle->window_size * handle->session->window_max_factor;
+                handle->window_max = window_max > UINT32_MAX ? UINT32_MAX : (uint32_t)window_max;
+            } else if (max_window_size < handle->window_size) {
+                handle->window_max = handle->window_size;
+            } else {
+                handle->window_max = max_window_size;
+            }
+            break;
+        default: return LV_LIBSSH2_STATUS_ERROR_UNKNOWN_WINDOW_MODE;
+    }
+    handle->window_mode = mode;
+    handle->window_target = handle->window_size;
+    handle->sample_start_us = 0;
+    handle->sample_bytes = 0;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_set_coalescing(
+    lv_libssh2_channel_t* handle,
+    const size_t threshold,
+    const uint32_t delay_ms
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_status_t status = lv_libssh2_channel_flush_writes(handle);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    size_t actual_threshold = threshold > handle->packet_size ? handle->packet_size : threshold;
+    if (actual_threshold > 0 && handle->coalesce_buffer == NULL) {
+        handle->coalesce_buffer = lv_libssh2_memory_session_alloc(handle->session, handle->packet_size);
+        if (handle->coalesce_buffer == NULL) {
+            return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+        }
+        lv_libssh2_mutex_init(&handle->coalesce_lock);
+    }
+    if (actual_threshold > 0) {
+        // The scheduler thread may send held writes from now on.
+        handle->session->locking = true;
+    }
+    handle->coalesce_threshold = actual_threshold;
+    handle->coalesce_delay_us = (uint64_t)delay_ms * 1000;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
 lv_libssh2_status_t
 lv_libssh2_channel_request_pty(
     lv_libssh2_channel_t* handle,
@@ -385,10 +1057,12 @@ lv_libssh2_channel_request_pty(
     if (terminal == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_channel_request_pty(
         handle->inner,
         terminal
     );
+    lv_libssh2_session_unlock(handle->session);
     return lv_libssh2_status_from_result(result);
 }
 
@@ -401,14 +1075,31 @@ lv_libssh2_channel_request_pty_size(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_channel_request_pty_size(
         handle->inner,
         width,
         height
     );
+    lv_libssh2_session_unlock(handle->session);
+    if (result == 0 && handle->terminal != NULL && width > 0 && height > 0) {
+        return lv_libssh2_terminal_resize(handle->terminal, (uint32_t)width, (uint32_t)height);
+    }
     return lv_libssh2_status_from_result(result);
 }
 
+lv_libssh2_status_t
+lv_libssh2_channel_set_terminal(
+    lv_libssh2_channel_t* handle,
+    lv_libssh2_terminal_t* terminal
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    handle->terminal = terminal;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
 lv_libssh2_status_t
 lv_libssh2_channel_send_eof(
     lv_libssh2_channel_t* handle
@@ -416,7 +1107,13 @@ lv_libssh2_channel_send_eof(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_status_t status = lv_libssh2_channel_flush_writes(handle);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_channel_send_eof(handle->inner);
+    lv_libssh2_session_unlock(handle->session);
     return lv_libssh2_status_from_result(result);
 }
 
@@ -428,11 +1125,14 @@ lv_libssh2_channel_set_mode(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    int blocking = 0;
     switch (mode) {
-        case LV_LIBSSH2_CHANNEL_MODE_NONBLOCKING: libssh2_channel_set_blocking(handle->inner, 0); break;
-        case LV_LIBSSH2_CHANNEL_MODE_BLOCKING: libssh2_channel_set_blocking(handle->inner, 1); break;
+        case LV_LIBSSH2_CHANNEL_MODE_NONBLOCKING: blocking = 0; break;
+        case LV_LIBSSH2_CHANNEL_MODE_BLOCKING: blocking = 1; break;
         default: return LV_LIBSSH2_STATUS_ERROR_UNKNOWN_CHANNEL_MODE;
     }
+    // libssh2 applies the mode of a channel to its whole session.
+    lv_libssh2_session_apply_mode(handle->session, blocking);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -451,11 +1151,13 @@ lv_libssh2_channel_set_environment_variable(
     if (value == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_channel_setenv(
         handle->inner,
         name,
         value
     );
+    lv_libssh2_session_unlock(handle->session);
     return lv_libssh2_status_from_result(result);
 }
 
@@ -466,8 +1168,13 @@ lv_libssh2_channel_wait_closed(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
-    int result = libssh2_channel_wait_closed(handle->inner);
-    return lv_libssh2_status_from_result(result);
+    uint64_t deadline = 0;
+    ssize_t result = 0;
+    do {
+        lv_libssh2_session_lock_io(handle->session);
+        result = libssh2_channel_wait_closed(handle->inner);
+    } while (lv_libssh2_session_unlock_io(handle->session, &result, &deadline));
+    return lv_libssh2_status_from_result((int)result);
 }
 
 lv_libssh2_status_t
@@ -477,8 +1184,13 @@ lv_libssh2_channel_wait_eof(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
-    int result = libssh2_channel_wait_eof(handle->inner);
-    return lv_libssh2_status_from_result(result);
+    uint64_t deadline = 0;
+    ssize_t result = 0;
+    do {
+        lv_libssh2_session_lock_io(handle->session);
+        result = libssh2_channel_wait_eof(handle->inner);
+    } while (lv_libssh2_session_unlock_io(handle->session, &result, &deadline));
+    return lv_libssh2_status_from_result((int)result);
 }
 
 lv_libssh2_status_t
@@ -492,7 +1204,9 @@ lv_libssh2_channel_window_read_size(
     if (size == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     unsigned int result = libssh2_channel_window_read(handle->inner);
+    lv_libssh2_session_unlock(handle->session);
     *size = result;
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -508,7 +1222,9 @@ lv_libssh2_channel_window_write_size(
     if (size == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     unsigned int result = libssh2_channel_window_write(handle->inner);
+    lv_libssh2_session_unlock(handle->session);
     *size = result;
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -529,12 +1245,37 @@ lv_libssh2_channel_write(
     if (byte_count == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
-    ssize_t result = libssh2_channel_write_ex(
-        handle->inner,
-        0,
-        buffer,
-        buffer_len
-    );
+    if (handle->coalesce_threshold > 0) {
+        bool held = false;
+        lv_libssh2_status_t status = LV_LIBSSH2_STATUS_OK;
+        lv_libssh2_mutex_lock(&handle->coalesce_lock);
+        if (handle->coalesce_len > 0 && handle->coalesce_len + buffer_len > handle->coalesce_threshold) {
+            status = lv_libssh2_channel_send_held(handle);
+        }
+        if (!lv_libssh2_status_is_err(status) && buffer_len < handle->coalesce_threshold) {
+            status = lv_libssh2_channel_hold(handle, buffer, buffer_len, byte_count);
+            held = true;
+        }
+        lv_libssh2_mutex_unlock(&handle->coalesce_lock);
+        if (held || lv_libssh2_status_is_err(status)) {
+            return status;
+        }
+    }
+    uint64_t start = lv_libssh2_time_now_us();
+    uint64_t deadline = 0;
+    ssize_t result = 0;
+    do {
+        lv_libssh2_session_lock_io(handle->session);
+        result = libssh2_channel_write_ex(
+            handle->inner,
+            0,
+            buffer,
+            buffer_len
+        );
+        if (result > 0) {
+            lv_libssh2_profile_record(handle->session, buffer, (size_t)result, start);
+        }
+    } while (lv_libssh2_session_unlock_io(handle->session, &result, &deadline));
     if (result < 0) {
         return lv_libssh2_status_from_result((int)result);
     }
@@ -542,6 +1283,161 @@ lv_libssh2_channel_write(
     return LV_LIBSSH2_STATUS_OK;
 }
 
+lv_libssh2_status_t
+lv_libssh2_channel_write_all(
+    lv_libssh2_channel_t* handle,
+    const char* buffer,
+    const size_t buffer_len,
+    const int32_t timeout_ms,
+    size_t* byte_count
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (buffer == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (byte_count == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *byte_count = 0;
+    uint64_t deadline = lv_libssh2_time_deadline_us(timeout_ms);
+    int blocking = lv_libssh2_channel_begin_loop(handle);
+    lv_libssh2_status_t status = LV_LIBSSH2_STATUS_OK;
+    while (*byte_count < buffer_len) {
+        size_t count = 0;
+        status = lv_libssh2_channel_write(handle, buffer + *byte_count, buffer_len - *byte_count, &count);
+        if (status == LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN) {
+            status = lv_libssh2_session_wait_socket(handle->session, deadline);
+            if (lv_libssh2_status_is_err(status)) {
+                break;
+            }
+            continue;
+        }
+        if (lv_libssh2_status_is_err(status)) {
+            break;
+        }
+        *byte_count += count;
+    }
+    lv_libssh2_channel_end_loop(handle, blocking);
+    return status;
+}
+
+/**
+ * Writes the staged bytes of the gather buffer, shifting any bytes that did not
+ * fit into the current window or packet to the front of the buffer.
+ */
+static int
+lv_libssh2_channel_write_gathered(
+    lv_libssh2_channel_t* handle,
+    size_t* staged,
+    size_t* sent
+) {
+    while (*staged > 0) {
+        uint64_t start = lv_libssh2_time_now_us();
+        uint64_t deadline = 0;
+        ssize_t result = 0;
+        do {
+            lv_libssh2_session_lock_io(handle->session);
+            result = libssh2_channel_write_ex(handle->inner, 0, handle->gather_buffer, *staged);
+            if (result > 0) {
+                lv_libssh2_profile_record(handle->session, handle->gather_buffer, (size_t)result, start);
+            }
+        } while (lv_libssh2_session_unlock_io(handle->session, &result, &deadline));
+        if (result < 0) {
+            return (int)result;
+        }
+        memmove(handle->gather_buffer, handle->gather_buffer + result, *staged - result);
+        *staged -= result;
+        *sent += result;
+    }
+    return 0;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_writev(
+    lv_libssh2_channel_t* handle,
+    const lv_libssh2_channel_segment_t* segments,
+    const size_t segment_count,
+    size_t* byte_count
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (segments == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (byte_count == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *byte_count = 0;
+    // Every segment is checked before any is written, so a bad segment never
+    // fails the call after part of the data was sent.
+    for (size_t i = 0; i < segment_count; i++) {
+        if (segments[i].data == NULL && segments[i].len > 0) {
+            return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+        }
+    }
+    lv_libssh2_status_t status = lv_libssh2_channel_flush_writes(handle);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    if (handle->gather_buffer == NULL) {
+        handle->gather_buffer = lv_libssh2_memory_session_alloc(handle->session, handle->packet_size);
+        if (handle->gather_buffer == NULL) {
+            return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+        }
+    }
+    int result = 0;
+    size_t staged = 0;
+    size_t sent = 0;
+    for (size_t i = 0; i < segment_count && result == 0; i++) {
+        const char* data = segments[i].data;
+        size_t len = segments[i].len;
+        while (len > 0 && result == 0) {
+            if (staged == 0 && len >= handle->packet_size) {
+                uint64_t start = lv_libssh2_time_now_us();
+                uint64_t deadline = 0;
+                ssize_t written = 0;
+                do {
+                    lv_libssh2_session_lock_io(handle->session);
+                    written = libssh2_channel_write_ex(handle->inner, 0, data, len);
+                    if (written > 0) {
+                        lv_libssh2_profile_record(handle->session, data, (size_t)written, start);
+                    }
+                } while (lv_libssh2_session_unlock_io(handle->session, &written, &deadline));
+                if (written < 0) {
+                    result = (int)written;
+                    break;
+                }
+                data += written;
+                len -= written;
+                sent += written;
+                continue;
+            }
+            size_t count = handle->packet_size - staged;
+            if (count > len) {
+                count = len;
+            }
+            memcpy(handle->gather_buffer + staged, data, count);
+            staged += count;
+            data += count;
+            len -= count;
+            if (staged == handle->packet_size) {
+                result = lv_libssh2_channel_write_gathered(handle, &staged, &sent);
+            }
+        }
+    }
+    if (result == 0) {
+        result = lv_libssh2_channel_write_gathered(handle, &staged, &sent);
+    }
+    *byte_count = sent;
+    if (result == LIBSSH2_ERROR_EAGAIN && sent > 0) {
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    return lv_libssh2_status_from_result(result);
+}
+
 lv_libssh2_status_t
 lv_libssh2_channel_write_stderr(
     lv_libssh2_channel_t* handle,
@@ -558,12 +1454,25 @@ lv_libssh2_channel_write_stderr(
     if (byte_count == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
-    ssize_t result = libssh2_channel_write_ex(
-        handle->inner,
-        SSH_EXTENDED_DATA_STDERR,
-        buffer,
-        buffer_len
-    );
+    lv_libssh2_status_t status = lv_libssh2_channel_flush_writes(handle);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    uint64_t start = lv_libssh2_time_now_us();
+    uint64_t deadline = 0;
+    ssize_t result = 0;
+    do {
+        lv_libssh2_session_lock_io(handle->session);
+        result = libssh2_channel_write_ex(
+            handle->inner,
+            SSH_EXTENDED_DATA_STDERR,
+            buffer,
+            buffer_len
+        );
+        if (result > 0) {
+            lv_libssh2_profile_record(handle->session, buffer, (size_t)result, start);
+        }
+    } while (lv_libssh2_session_unlock_io(handle->session, &result, &deadline));
     if (result < 0) {
         return lv_libssh2_status_from_result((int)result);
     }
@@ -579,9 +1488,11 @@ lv_libssh2_channel_request_x11(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_channel_x11_req(
         handle->inner,
         screen_number
     );
+    lv_libssh2_session_unlock(handle->session);
     return lv_libssh2_status_from_result(result);
 }
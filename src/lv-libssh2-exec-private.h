@@ -0,0 +1,111 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#ifndef LV_LIBSSH2_EXEC_PRIVATE_H
+#define LV_LIBSSH2_EXEC_PRIVATE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "lv-libssh2.h"
+
+typedef struct _lv_libssh2_exec_input {
+    const uint8_t* data;
+    size_t len;
+    size_t offset;
+    FILE* file;
+    uint8_t* chunk;
+    bool done;
+} lv_libssh2_exec_input_t;
+
+typedef enum _lv_libssh2_exec_stages {
+    LV_LIBSSH2_EXEC_STAGE_OPEN = 0,
+    LV_LIBSSH2_EXEC_STAGE_START = 1,
+    LV_LIBSSH2_EXEC_STAGE_PUMP = 2,
+    LV_LIBSSH2_EXEC_STAGE_CLOSE = 3,
+    LV_LIBSSH2_EXEC_STAGE_DONE = 4
+} lv_libssh2_exec_stages_t;
+
+/**
+ * A command being run on its own channel, advanced one step at a time so the
+ * caller decides how to wait on the socket between steps.
+ */
+typedef struct _lv_libssh2_exec {
+    lv_libssh2_session_t* session;
+    const char* command;
+    size_t command_len;
+    lv_libssh2_exec_input_t* input;
+    size_t max_output_len;
+    lv_libssh2_exec_stages_t stage;
+    bool eof_sent;
+    lv_libssh2_channel_t* channel;
+    int32_t exit_status;
+} lv_libssh2_exec_t;
+
+/**
+ * Prepares to run the command. The command and input must stay valid until
+ * the run completes or is aborted.
+ */
+void
+lv_libssh2_exec_init(
+    lv_libssh2_exec_t* exec,
+    lv_libssh2_session_t* session,
+    const char* command,
+    const size_t command_len,
+    lv_libssh2_exec_input_t* input,
+    const size_t max_output_len
+);
+
+/**
+ * Advances the run as far as possible without blocking. The session must be
+ * in non-blocking mode.
+ *
+ * Returns LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN when the caller should wait
+ * on the socket in the session's block directions and step again, and
+ * LV_LIBSSH2_STATUS_OK once the channel is closed and the exit status is
+ * known. On any other status, the run is over and must be aborted.
+ */
+lv_libssh2_status_t
+lv_libssh2_exec_step(
+    lv_libssh2_exec_t* exec
+);
+
+/**
+ * Destroys the channel of a run that failed or will not be completed.
+ */
+void
+lv_libssh2_exec_abort(
+    lv_libssh2_exec_t* exec
+);
+
+#endif
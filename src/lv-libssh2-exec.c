@@ -0,0 +1,428 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-status-private.h"
+#include "lv-libssh2-session-private.h"
+#include "lv-libssh2-channel-private.h"
+#include "lv-libssh2-exec-private.h"
+#include "lv-libssh2-time-private.h"
+
+#define FILE_CHUNK_SIZE 262144
+#define READ_CHUNK_SIZE 16384
+
+/**
+ * Makes sure there is pending input, reading the next chunk from the file if
+ * the previous one has been written. The `done` flag is set when there is no
+ * input left.
+ */
+static lv_libssh2_status_t
+lv_libssh2_exec_input_fill(
+    lv_libssh2_exec_input_t* input
+) {
+    if (input->offset < input->len || input->done) {
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    if (input->file == NULL) {
+        input->done = true;
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    size_t count = fread(input->chunk, 1, FILE_CHUNK_SIZE, input->file);
+    if (count == 0) {
+        if (ferror(input->file)) {
+            return LV_LIBSSH2_STATUS_ERROR_FILE;
+        }
+        input->done = true;
+    }
+    input->data = input->chunk;
+    input->len = count;
+    input->offset = 0;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+/**
+ * Reads whatever is available from one stream of the channel into one of its
+ * output buffers. The `progress` flag is set if any data was read.
+ */
+static lv_libssh2_status_t
+lv_libssh2_exec_drain(
+    lv_libssh2_channel_t* channel,
+    const int stream_id,
+    char** output,
+    size_t* output_len,
+    size_t* output_capacity,
+    const size_t max_output_len,
+    bool* progress
+) {
+    for (;;) {
+        if (*output_capacity - *output_len < READ_CHUNK_SIZE) {
+            size_t capacity = *output_capacity == 0 ? READ_CHUNK_SIZE : *output_capacity * 2;
+            char* buffer = realloc(*output, capacity);
+            if (buffer == NULL) {
+                return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+            }
+            *output = buffer;
+            *output_capacity = capacity;
+        }
+        size_t count = 0;
+        lv_libssh2_status_t status;
+        if (stream_id == SSH_EXTENDED_DATA_STDERR) {
+            status = lv_libssh2_channel_read_stderr(channel, *output + *output_len, *output_capacity - *output_len, &count);
+        } else {
+            status = lv_libssh2_channel_read(channel, *output + *output_len, *output_capacity - *output_len, &count);
+        }
+        if (status == LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN) {
+            return LV_LIBSSH2_STATUS_OK;
+        }
+        if (lv_libssh2_status_is_err(status)) {
+            return status;
+        }
+        if (count == 0) {
+            return LV_LIBSSH2_STATUS_OK;
+        }
+        *output_len += count;
+        *progress = true;
+        if (max_output_len > 0 && *output_len > max_output_len) {
+            *output_len = max_output_len;
+            return LV_LIBSSH2_STATUS_ERROR_OUTPUT_LIMIT_EXCEEDED;
+        }
+    }
+}
+
+void
+lv_libssh2_exec_init(
+    lv_libssh2_exec_t* exec,
+    lv_libssh2_session_t* session,
+    const char* command,
+    const size_t command_len,
+    lv_libssh2_exec_input_t* input,
+    const size_t max_output_len
+) {
+    exec->session = session;
+    exec->command = command;
+    exec->command_len = command_len;
+    exec->input = input;
+    exec->max_output_len = max_output_len;
+    exec->stage = LV_LIBSSH2_EXEC_STAGE_OPEN;
+    exec->eof_sent = false;
+    exec->channel = NULL;
+    exec->exit_status = 0;
+}
+
+/**
+ * Pumps the input into stdin of the command until end of file from the
+ * remote end.
+ *
+ * Stdout and stderr are drained before every write, so the remote process can
+ * never be blocked on a full output pipe while this end is blocked on a full
+ * channel window. The socket only needs to be waited on when no direction
+ * made progress.
+ */
+static lv_libssh2_status_t
+lv_libssh2_exec_pump(
+    lv_libssh2_exec_t* exec
+) {
+    lv_libssh2_channel_t* channel = exec->channel;
+    lv_libssh2_exec_input_t* input = exec->input;
+    for (;;) {
+        bool progress = false;
+        lv_libssh2_status_t status = lv_libssh2_exec_drain(
+            channel,
+            0,
+            &channel->output,
+            &channel->output_len,
+            &channel->output_capacity,
+            exec->max_output_len,
+            &progress
+        );
+        if (lv_libssh2_status_is_err(status)) {
+            return status;
+        }
+        status = lv_libssh2_exec_drain(
+            channel,
+            SSH_EXTENDED_DATA_STDERR,
+            &channel->stderr_output,
+            &channel->stderr_output_len,
+            &channel->stderr_output_capacity,
+            exec->max_output_len,
+            &progress
+        );
+        if (lv_libssh2_status_is_err(status)) {
+            return status;
+        }
+        if (!progress && lv_libssh2_channel_at_eof(channel)) {
+            return LV_LIBSSH2_STATUS_OK;
+        }
+        if (!exec->eof_sent) {
+            status = lv_libssh2_exec_input_fill(input);
+            if (lv_libssh2_status_is_err(status)) {
+                return status;
+            }
+            if (input->offset < input->len) {
+                size_t count = 0;
+                status = lv_libssh2_channel_write(
+                    channel,
+                    (const char*)(input->data + input->offset),
+                    input->len - input->offset,
+                    &count
+                );
+                if (status == LV_LIBSSH2_STATUS_OK) {
+                    input->offset += count;
+                    progress = progress || count > 0;
+                }
+            } else {
+                status = lv_libssh2_channel_send_eof(channel);
+                if (status == LV_LIBSSH2_STATUS_OK) {
+                    exec->eof_sent = true;
+                    progress = true;
+                }
+            }
+            if (status == LV_LIBSSH2_STATUS_ERROR_CHANNEL_CLOSED) {
+                exec->eof_sent = true;
+                status = LV_LIBSSH2_STATUS_OK;
+            }
+            if (status == LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN) {
+                status = LV_LIBSSH2_STATUS_OK;
+            }
+            if (lv_libssh2_status_is_err(status)) {
+                return status;
+            }
+        }
+        if (!progress) {
+            return LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN;
+        }
+    }
+}
+
+lv_libssh2_status_t
+lv_libssh2_exec_step(
+    lv_libssh2_exec_t* exec
+) {
+    lv_libssh2_status_t status = LV_LIBSSH2_STATUS_OK;
+    if (exec->stage == LV_LIBSSH2_EXEC_STAGE_OPEN) {
+        status = lv_libssh2_channel_create(exec->session, &exec->channel);
+        if (status != LV_LIBSSH2_STATUS_OK) {
+            return status;
+        }
+        exec->stage = LV_LIBSSH2_EXEC_STAGE_START;
+    }
+    if (exec->stage == LV_LIBSSH2_EXEC_STAGE_START) {
+        status = lv_libssh2_channel_exec(exec->channel, exec->command, exec->command_len);
+        if (status != LV_LIBSSH2_STATUS_OK) {
+            return status;
+        }
+        exec->stage = LV_LIBSSH2_EXEC_STAGE_PUMP;
+    }
+    if (exec->stage == LV_LIBSSH2_EXEC_STAGE_PUMP) {
+        status = lv_libssh2_exec_pump(exec);
+        if (status != LV_LIBSSH2_STATUS_OK) {
+            return status;
+        }
+        exec->stage = LV_LIBSSH2_EXEC_STAGE_CLOSE;
+    }
+    if (exec->stage == LV_LIBSSH2_EXEC_STAGE_CLOSE) {
+        status = lv_libssh2_channel_close(exec->channel);
+        if (status == LV_LIBSSH2_STATUS_OK) {
+            status = lv_libssh2_channel_wait_closed(exec->channel);
+        }
+        if (status != LV_LIBSSH2_STATUS_OK) {
+            return status;
+        }
+        lv_libssh2_session_lock(exec->session);
+        exec->exit_status = libssh2_channel_get_exit_status(exec->channel->inner);
+        lv_libssh2_session_unlock(exec->session);
+        exec->stage = LV_LIBSSH2_EXEC_STAGE_DONE;
+    }
+    return status;
+}
+
+void
+lv_libssh2_exec_abort(
+    lv_libssh2_exec_t* exec
+) {
+    if (exec->channel != NULL) {
+        lv_libssh2_channel_destroy(exec->channel);
+        exec->channel = NULL;
+    }
+}
+
+static lv_libssh2_status_t
+lv_libssh2_exec_run(
+    lv_libssh2_session_t* session,
+    const char* command,
+    const size_t command_len,
+    lv_libssh2_exec_input_t* input,
+    const size_t max_output_len,
+    const int32_t timeout_ms,
+    int32_t* exit_status,
+    lv_libssh2_channel_t** handle
+) {
+    uint64_t deadline = lv_libssh2_time_deadline_us(timeout_ms);
+    lv_libssh2_session_lock(session);
+    int blocking = lv_libssh2_session_begin_nonblocking(session);
+    lv_libssh2_session_unlock(session);
+    lv_libssh2_exec_t exec;
+    lv_libssh2_exec_init(&exec, session, command, command_len, input, max_output_len);
+    lv_libssh2_status_t status;
+    for (;;) {
+        status = lv_libssh2_exec_step(&exec);
+        if (status != LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN) {
+            break;
+        }
+        status = lv_libssh2_session_wait_socket(session, deadline);
+        if (lv_libssh2_status_is_err(status)) {
+            break;
+        }
+    }
+    lv_libssh2_session_lock(session);
+    lv_libssh2_session_end_nonblocking(session, blocking);
+    lv_libssh2_session_unlock(session);
+    if (exec.channel != NULL
+        && (status == LV_LIBSSH2_STATUS_ERROR_OUTPUT_LIMIT_EXCEEDED || status == LV_LIBSSH2_STATUS_ERROR_TIMEOUT)) {
+        // The output collected so far is still useful, so the channel is
+        // returned with the status instead of being thrown away.
+        *handle = exec.channel;
+        return status;
+    }
+    if (lv_libssh2_status_is_err(status)) {
+        lv_libssh2_exec_abort(&exec);
+        return status;
+    }
+    *exit_status = exec.exit_status;
+    *handle = exec.channel;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_exec_with_input(
+    lv_libssh2_session_t* session,
+    const char* command,
+    const size_t command_len,
+    const uint8_t* input,
+    const size_t input_len,
+    const size_t max_output_len,
+    const int32_t timeout_ms,
+    int32_t* exit_status,
+    lv_libssh2_channel_t** handle
+) {
+    *handle = NULL;
+    if (session == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (command == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (input == NULL && input_len > 0) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (exit_status == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_exec_input_t source;
+    source.data = input;
+    source.len = input_len;
+    source.offset = 0;
+    source.file = NULL;
+    source.chunk = NULL;
+    source.done = false;
+    return lv_libssh2_exec_run(
+        session,
+        command,
+        command_len,
+        &source,
+        max_output_len,
+        timeout_ms,
+        exit_status,
+        handle
+    );
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_exec_with_file(
+    lv_libssh2_session_t* session,
+    const char* command,
+    const size_t command_len,
+    const char* local_path,
+    const size_t max_output_len,
+    const int32_t timeout_ms,
+    int32_t* exit_status,
+    lv_libssh2_channel_t** handle
+) {
+    *handle = NULL;
+    if (session == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (command == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (local_path == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (exit_status == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_exec_input_t source;
+    source.data = NULL;
+    source.len = 0;
+    source.offset = 0;
+    source.done = false;
+    source.chunk = malloc(FILE_CHUNK_SIZE);
+    if (source.chunk == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    source.file = fopen(local_path, "rb");
+    if (source.file == NULL) {
+        free(source.chunk);
+        return LV_LIBSSH2_STATUS_ERROR_FILE;
+    }
+    lv_libssh2_status_t status = lv_libssh2_exec_run(
+        session,
+        command,
+        command_len,
+        &source,
+        max_output_len,
+        timeout_ms,
+        exit_status,
+        handle
+    );
+    fclose(source.file);
+    free(source.chunk);
+    return status;
+}
@@ -0,0 +1,89 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#ifndef LV_LIBSSH2_EXPECT_PRIVATE_H
+#define LV_LIBSSH2_EXPECT_PRIVATE_H
+
+#include "lv-libssh2.h"
+
+typedef struct _lv_libssh2_expect_pattern {
+    uint8_t* data;
+    size_t len;
+} lv_libssh2_expect_pattern_t;
+
+struct _lv_libssh2_expect {
+    lv_libssh2_expect_pattern_t* patterns;
+    size_t pattern_count;
+    int32_t* transitions;
+    int32_t* outputs;
+    bool compiled;
+    int32_t state;
+    uint8_t* buffer;
+    size_t buffer_len;
+    size_t buffer_capacity;
+    size_t scanned;
+    size_t consumed;
+    size_t before_start;
+    size_t before_len;
+};
+
+/**
+ * Scans the buffered bytes that have not been scanned yet and stops at the
+ * first match. The match index is -1 if no pattern matched.
+ */
+lv_libssh2_status_t
+lv_libssh2_expect_scan(
+    lv_libssh2_expect_t* handle,
+    int32_t* match_index
+);
+
+/**
+ * Discards the bytes up to and including the last match, which invalidates the
+ * data before the last match.
+ */
+void
+lv_libssh2_expect_compact(
+    lv_libssh2_expect_t* handle
+);
+
+/**
+ * Ensures there are at least `len` bytes available after the buffered bytes.
+ */
+lv_libssh2_status_t
+lv_libssh2_expect_reserve(
+    lv_libssh2_expect_t* handle,
+    size_t len
+);
+
+#endif
+
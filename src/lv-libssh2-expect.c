@@ -0,0 +1,420 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-status-private.h"
+#include "lv-libssh2-expect-private.h"
+
+#define ALPHABET_SIZE 256
+#define NO_MATCH -1
+#define READ_CHUNK_SIZE 4096
+
+lv_libssh2_status_t
+lv_libssh2_expect_create(
+    lv_libssh2_expect_t** handle
+) {
+    *handle = NULL;
+    lv_libssh2_expect_t* expect = malloc(sizeof(lv_libssh2_expect_t));
+    if (expect == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    expect->patterns = NULL;
+    expect->pattern_count = 0;
+    expect->transitions = NULL;
+    expect->outputs = NULL;
+    expect->compiled = false;
+    expect->state = 0;
+    expect->buffer = NULL;
+    expect->buffer_len = 0;
+    expect->buffer_capacity = 0;
+    expect->scanned = 0;
+    expect->consumed = 0;
+    expect->before_start = 0;
+    expect->before_len = 0;
+    *handle = expect;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_expect_destroy(
+    lv_libssh2_expect_t* handle
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    for (size_t i = 0; i < handle->pattern_count; i++) {
+        free(handle->patterns[i].data);
+    }
+    free(handle->patterns);
+    free(handle->transitions);
+    free(handle->outputs);
+    free(handle->buffer);
+    free(handle);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_expect_add_pattern(
+    lv_libssh2_expect_t* handle,
+    const uint8_t* pattern,
+    const size_t pattern_len,
+    int32_t* index
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (pattern == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (index == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (pattern_len == 0) {
+        return LV_LIBSSH2_STATUS_ERROR_INVALID_PATTERN;
+    }
+    lv_libssh2_expect_pattern_t* patterns = realloc(
+        handle->patterns,
+        (handle->pattern_count + 1) * sizeof(lv_libssh2_expect_pattern_t)
+    );
+    if (patterns == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    handle->patterns = patterns;
+    uint8_t* data = malloc(pattern_len);
+    if (data == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    memcpy(data, pattern, pattern_len);
+    handle->patterns[handle->pattern_count].data = data;
+    handle->patterns[handle->pattern_count].len = pattern_len;
+    *index = (int32_t)handle->pattern_count;
+    handle->pattern_count += 1;
+    handle->compiled = false;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+/**
+ * Builds the Aho-Corasick automaton for the patterns as a complete transition
+ * table, so scanning is a single table lookup per byte regardless of how many
+ * patterns there are or how much data has been buffered.
+ *
+ * The output of a state is the lowest index of all the patterns that end at
+ * that state, including those reached through the failure links.
+ */
+static lv_libssh2_status_t
+lv_libssh2_expect_compile(
+    lv_libssh2_expect_t* handle
+) {
+    if (handle->pattern_count == 0) {
+        return LV_LIBSSH2_STATUS_ERROR_INVALID_PATTERN;
+    }
+    size_t max_states = 1;
+    for (size_t i = 0; i < handle->pattern_count; i++) {
+        max_states += handle->patterns[i].len;
+    }
+    int32_t* transitions = calloc(max_states * ALPHABET_SIZE, sizeof(int32_t));
+    int32_t* outputs = malloc(max_states * sizeof(int32_t));
+    int32_t* failures = calloc(max_states, sizeof(int32_t));
+    int32_t* queue = malloc(max_states * sizeof(int32_t));
+    if (transitions == NULL || outputs == NULL || failures == NULL || queue == NULL) {
+        free(transitions);
+        free(outputs);
+        free(failures);
+        free(queue);
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    for (size_t i = 0; i < max_states; i++) {
+        outputs[i] = NO_MATCH;
+    }
+    int32_t state_count = 1;
+    for (size_t i = 0; i < handle->pattern_count; i++) {
+        int32_t state = 0;
+        for (size_t j = 0; j < handle->patterns[i].len; j++) {
+            int32_t* next = &transitions[state * ALPHABET_SIZE + handle->patterns[i].data[j]];
+            if (*next == 0) {
+                *next = state_count;
+                state_count += 1;
+            }
+            state = *next;
+        }
+        if (outputs[state] == NO_MATCH) {
+            outputs[state] = (int32_t)i;
+        }
+    }
+    size_t head = 0;
+    size_t tail = 0;
+    for (int c = 0; c < ALPHABET_SIZE; c++) {
+        int32_t child = transitions[c];
+        if (child != 0) {
+            failures[child] = 0;
+            queue[tail++] = child;
+        }
+    }
+    while (head < tail) {
+        int32_t state = queue[head++];
+        int32_t fallback = outputs[failures[state]];
+        if (fallback != NO_MATCH && (outputs[state] == NO_MATCH || fallback < outputs[state])) {
+            outputs[state] = fallback;
+        }
+        for (int c = 0; c < ALPHABET_SIZE; c++) {
+            int32_t* next = &transitions[state * ALPHABET_SIZE + c];
+            int32_t failure_next = transitions[failures[state] * ALPHABET_SIZE + c];
+            if (*next != 0) {
+                failures[*next] = failure_next;
+                queue[tail++] = *next;
+            } else {
+                *next = failure_next;
+            }
+        }
+    }
+    free(failures);
+    free(queue);
+    free(handle->transitions);
+    free(handle->outputs);
+    handle->transitions = transitions;
+    handle->outputs = outputs;
+    handle->compiled = true;
+    // The automaton starts over, so the bytes that are not consumed yet are
+    // scanned again in case a new pattern matches across them.
+    handle->state = 0;
+    handle->scanned = handle->consumed;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_expect_scan(
+    lv_libssh2_expect_t* handle,
+    int32_t* match_index
+) {
+    *match_index = NO_MATCH;
+    if (!handle->compiled) {
+        lv_libssh2_status_t status = lv_libssh2_expect_compile(handle);
+        if (lv_libssh2_status_is_err(status)) {
+            return status;
+        }
+    }
+    const int32_t* transitions = handle->transitions;
+    const int32_t* outputs = handle->outputs;
+    int32_t state = handle->state;
+    for (size_t i = handle->scanned; i < handle->buffer_len; i++) {
+        state = transitions[state * ALPHABET_SIZE + handle->buffer[i]];
+        if (outputs[state] != NO_MATCH) {
+            size_t end = i + 1;
+            size_t match_start = end - handle->patterns[outputs[state]].len;
+            handle->before_start = handle->consumed;
+            handle->before_len = match_start - handle->consumed;
+            handle->consumed = end;
+            handle->scanned = end;
+            handle->state = 0;
+            *match_index = outputs[state];
+            return LV_LIBSSH2_STATUS_OK;
+        }
+    }
+    handle->scanned = handle->buffer_len;
+    handle->state = state;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+void
+lv_libssh2_expect_compact(
+    lv_libssh2_expect_t* handle
+) {
+    if (handle->consumed > 0) {
+        memmove(handle->buffer, handle->buffer + handle->consumed, handle->buffer_len - handle->consumed);
+        handle->buffer_len -= handle->consumed;
+        handle->scanned -= handle->consumed;
+        handle->consumed = 0;
+    }
+    handle->before_start = 0;
+    handle->before_len = 0;
+}
+
+lv_libssh2_status_t
+lv_libssh2_expect_reserve(
+    lv_libssh2_expect_t* handle,
+    size_t len
+) {
+    if (handle->buffer_capacity - handle->buffer_len >= len) {
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    size_t capacity = handle->buffer_capacity == 0 ? READ_CHUNK_SIZE : handle->buffer_capacity;
+    while (capacity - handle->buffer_len < len) {
+        capacity *= 2;
+    }
+    uint8_t* buffer = realloc(handle->buffer, capacity);
+    if (buffer == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    handle->buffer = buffer;
+    handle->buffer_capacity = capacity;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_expect_feed(
+    lv_libssh2_expect_t* handle,
+    const uint8_t* data,
+    const size_t data_len,
+    int32_t* match_index
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (data == NULL && data_len > 0) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (match_index == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_expect_compact(handle);
+    lv_libssh2_status_t status = lv_libssh2_expect_reserve(handle, data_len);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    if (data_len > 0) {
+        memcpy(handle->buffer + handle->buffer_len, data, data_len);
+        handle->buffer_len += data_len;
+    }
+    return lv_libssh2_expect_scan(handle, match_index);
+}
+
+lv_libssh2_status_t
+lv_libssh2_expect_reset(
+    lv_libssh2_expect_t* handle
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    handle->state = 0;
+    handle->buffer_len = 0;
+    handle->scanned = 0;
+    handle->consumed = 0;
+    handle->before_start = 0;
+    handle->before_len = 0;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_expect_before_len(
+    lv_libssh2_expect_t* handle,
+    size_t* len
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (len == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *len = handle->before_len;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_expect_before(
+    lv_libssh2_expect_t* handle,
+    uint8_t* buffer
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (buffer == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    memcpy(buffer, handle->buffer + handle->before_start, handle->before_len);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_expect(
+    lv_libssh2_channel_t* channel,
+    lv_libssh2_expect_t* handle,
+    int32_t* match_index
+) {
+    if (channel == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (match_index == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_expect_compact(handle);
+    lv_libssh2_status_t status = lv_libssh2_expect_scan(handle, match_index);
+    if (lv_libssh2_status_is_err(status) || *match_index != NO_MATCH) {
+        return status;
+    }
+    while (true) {
+        status = lv_libssh2_expect_reserve(handle, READ_CHUNK_SIZE);
+        if (lv_libssh2_status_is_err(status)) {
+            return status;
+        }
+        size_t byte_count = 0;
+        status = lv_libssh2_channel_read(
+            channel,
+            (char*)handle->buffer + handle->buffer_len,
+            handle->buffer_capacity - handle->buffer_len,
+            &byte_count
+        );
+        if (lv_libssh2_status_is_err(status)) {
+            return status;
+        }
+        if (byte_count == 0) {
+            int eof = 0;
+            status = lv_libssh2_channel_eof(channel, &eof);
+            if (lv_libssh2_status_is_err(status)) {
+                return status;
+            }
+            if (eof) {
+                handle->before_start = handle->consumed;
+                handle->before_len = handle->buffer_len - handle->consumed;
+                handle->consumed = handle->buffer_len;
+                handle->scanned = handle->buffer_len;
+                handle->state = 0;
+                return LV_LIBSSH2_STATUS_OK;
+            }
+            continue;
+        }
+        handle->buffer_len += byte_count;
+        status = lv_libssh2_expect_scan(handle, match_index);
+        if (lv_libssh2_status_is_err(status) || *match_index != NO_MATCH) {
+            return status;
+        }
+    }
+}
@@ -36,8 +36,13 @@
 
 #include "lv-libssh2.h"
 
+/**
+ * The stat structure is stored with the wrapper, so creating a file info is
+ * a single allocation, and `inner` points to the `stat` field.
+ */
 struct _lv_libssh2_fileinfo {
     libssh2_struct_stat* inner;
+    libssh2_struct_stat stat;
 };
 
 #endif
@@ -49,12 +49,7 @@ lv_libssh2_fileinfo_create(
     if (file_info == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
-    libssh2_struct_stat* inner = malloc(sizeof(libssh2_struct_stat));
-    if (inner == NULL) {
-        free(file_info);
-        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
-    }
-    file_info->inner = inner;
+    file_info->inner = &file_info->stat;
     *handle = file_info;
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -66,7 +61,6 @@ lv_libssh2_fileinfo_destroy(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
-    free(handle->inner);
     handle->inner = NULL;
     free(handle);
     return LV_LIBSSH2_STATUS_OK;
@@ -0,0 +1,484 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-channel-private.h"
+#include "lv-libssh2-fleet-private.h"
+#include "lv-libssh2-knownhosts-private.h"
+#include "lv-libssh2-session-private.h"
+#include "lv-libssh2-thread-private.h"
+#include "lv-libssh2-time-private.h"
+
+#define DEFAULT_CONCURRENCY 32
+#define DEFAULT_PORT 22
+
+/**
+ * The work shared by the threads of a run, which take the hosts in order.
+ */
+typedef struct _lv_libssh2_fleet_run {
+    lv_libssh2_fleet_t* fleet;
+    const lv_libssh2_fleet_host_t* hosts;
+    lv_libssh2_knownhosts_t* knownhosts;
+    const char* command;
+    size_t command_len;
+    size_t max_output_len;
+    int32_t timeout_ms;
+    lv_libssh2_mutex_t mutex;
+    size_t next;
+} lv_libssh2_fleet_run_t;
+
+/**
+ * Gets the time left until the deadline in milliseconds, rounded up so a
+ * deadline that has not quite passed does not become a zero timeout, which
+ * means no timeout to libssh2, or -1 if there is no deadline.
+ */
+static int32_t
+lv_libssh2_fleet_remaining_ms(
+    const uint64_t deadline_us
+) {
+    if (deadline_us == LV_LIBSSH2_TIME_NO_DEADLINE) {
+        return -1;
+    }
+    uint64_t now = lv_libssh2_time_now_us();
+    if (now >= deadline_us) {
+        return 1;
+    }
+    return (int32_t)((deadline_us - now + 999) / 1000);
+}
+
+/**
+ * Maps the type of a host key to the key type of a known host, which libssh2
+ * compares before the key itself.
+ */
+static int
+lv_libssh2_fleet_knownhost_key_type(
+    const int hostkey_type
+) {
+    switch (hostkey_type) {
+        case LIBSSH2_HOSTKEY_TYPE_RSA: return LIBSSH2_KNOWNHOST_KEY_SSHRSA;
+        case LIBSSH2_HOSTKEY_TYPE_DSS: return LIBSSH2_KNOWNHOST_KEY_SSHDSS;
+#ifdef LIBSSH2_HOSTKEY_TYPE_ECDSA_256
+        case LIBSSH2_HOSTKEY_TYPE_ECDSA_256: return LIBSSH2_KNOWNHOST_KEY_ECDSA_256;
+        case LIBSSH2_HOSTKEY_TYPE_ECDSA_384: return LIBSSH2_KNOWNHOST_KEY_ECDSA_384;
+        case LIBSSH2_HOSTKEY_TYPE_ECDSA_521: return LIBSSH2_KNOWNHOST_KEY_ECDSA_521;
+#endif
+#ifdef LIBSSH2_HOSTKEY_TYPE_ED25519
+        case LIBSSH2_HOSTKEY_TYPE_ED25519: return LIBSSH2_KNOWNHOST_KEY_ED25519;
+#endif
+        default: return LIBSSH2_KNOWNHOST_KEY_UNKNOWN;
+    }
+}
+
+static lv_libssh2_status_t
+lv_libssh2_fleet_check_hostkey(
+    lv_libssh2_session_t* session,
+    lv_libssh2_knownhosts_t* knownhosts,
+    const lv_libssh2_fleet_host_t* host,
+    const uint16_t port
+) {
+    size_t key_len = 0;
+    int key_type = 0;
+    lv_libssh2_session_lock(session);
+    const char* key = libssh2_session_hostkey(session->inner, &key_len, &key_type);
+    lv_libssh2_session_unlock(session);
+    if (key == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_HOSTKEY_REJECTED;
+    }
+    int result = libssh2_knownhost_checkp(
+        knownhosts->inner,
+        host->host,
+        port,
+        key,
+        key_len,
+        LIBSSH2_KNOWNHOST_TYPE_PLAIN
+            | LIBSSH2_KNOWNHOST_KEYENC_RAW
+            | lv_libssh2_fleet_knownhost_key_type(key_type),
+        NULL
+    );
+    if (result != LIBSSH2_KNOWNHOST_CHECK_MATCH) {
+        return LV_LIBSSH2_STATUS_ERROR_HOSTKEY_REJECTED;
+    }
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+static lv_libssh2_status_t
+lv_libssh2_fleet_authenticate(
+    lv_libssh2_session_t* session,
+    const lv_libssh2_fleet_host_t* host
+) {
+    if (host->password != NULL) {
+        return lv_libssh2_userauth_password(session, host->user, host->password);
+    }
+    return lv_libssh2_userauth_publickey_from_file(
+        session,
+        host->user,
+        host->public_key_path,
+        host->private_key_path,
+        host->passphrase
+    );
+}
+
+/**
+ * Connects to one host, authenticates, and runs the command, recording the
+ * status and time of each step in the entry of the host.
+ */
+static void
+lv_libssh2_fleet_run_host(
+    lv_libssh2_fleet_run_t* run,
+    const size_t index
+) {
+    const lv_libssh2_fleet_host_t* host = &run->hosts[index];
+    lv_libssh2_fleet_entry_t* entry = &run->fleet->entries[index];
+    lv_libssh2_fleet_result_t* result = &entry->result;
+    uint16_t port = host->port == 0 ? DEFAULT_PORT : host->port;
+    uint64_t deadline = lv_libssh2_time_deadline_us(run->timeout_ms);
+    uint64_t start = lv_libssh2_time_now_us();
+    lv_libssh2_session_t* session = NULL;
+    lv_libssh2_status_t status = lv_libssh2_session_create(&session);
+    if (lv_libssh2_status_is_err(status)) {
+        result->status = status;
+        return;
+    }
+    status = lv_libssh2_session_connect_host(session, host->host, port, run->timeout_ms, NULL);
+    if (!lv_libssh2_status_is_err(status)) {
+        status = lv_libssh2_fleet_check_hostkey(session, run->knownhosts, host, port);
+    }
+    uint64_t now = lv_libssh2_time_now_us();
+    result->connect_us = now - start;
+    if (!lv_libssh2_status_is_err(status)) {
+        start = now;
+        // Authentication runs in blocking mode, where the session timeout is
+        // the only way to bound it.
+        lv_libssh2_session_set_timeout(session, lv_libssh2_fleet_remaining_ms(deadline));
+        status = lv_libssh2_fleet_authenticate(session, host);
+        lv_libssh2_session_set_timeout(session, 0);
+        now = lv_libssh2_time_now_us();
+        result->authenticate_us = now - start;
+    }
+    if (lv_libssh2_status_is_err(status)) {
+        lv_libssh2_session_destroy(session);
+        result->status = status;
+        return;
+    }
+    entry->session = session;
+    if (run->command != NULL) {
+        start = now;
+        lv_libssh2_channel_t* channel = NULL;
+        status = lv_libssh2_channel_exec_with_input(
+            session,
+            run->command,
+            run->command_len,
+            NULL,
+            0,
+            run->max_output_len,
+            lv_libssh2_fleet_remaining_ms(deadline),
+            &result->exit_status,
+            &channel
+        );
+        result->exec_us = lv_libssh2_time_now_us() - start;
+        if (channel != NULL) {
+            entry->output = channel->output;
+            result->output_len = channel->output_len;
+            channel->output = NULL;
+            entry->stderr_output = channel->stderr_output;
+            result->stderr_output_len = channel->stderr_output_len;
+            channel->stderr_output = NULL;
+            lv_libssh2_channel_destroy(channel);
+        }
+    }
+    result->status = status;
+}
+
+static void
+lv_libssh2_fleet_worker(
+    void* arg
+) {
+    lv_libssh2_fleet_run_t* run = arg;
+    for (;;) {
+        lv_libssh2_mutex_lock(&run->mutex);
+        size_t index = run->next++;
+        lv_libssh2_mutex_unlock(&run->mutex);
+        if (index >= run->fleet->count) {
+            return;
+        }
+        lv_libssh2_fleet_run_host(run, index);
+    }
+}
+
+lv_libssh2_status_t
+lv_libssh2_fleet_run(
+    const lv_libssh2_fleet_host_t* hosts,
+    const size_t host_count,
+    lv_libssh2_knownhosts_t* knownhosts,
+    const char* command,
+    const size_t command_len,
+    const size_t max_output_len,
+    const uint32_t concurrency,
+    const int32_t timeout_ms,
+    lv_libssh2_fleet_t** handle
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *handle = NULL;
+    // Credentials are never sent to a host whose key was not checked.
+    if (knownhosts == NULL || (hosts == NULL && host_count > 0)) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    for (size_t i = 0; i < host_count; i++) {
+        if (hosts[i].host == NULL || hosts[i].user == NULL) {
+            return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+        }
+        if (hosts[i].password == NULL && hosts[i].private_key_path == NULL) {
+            return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+        }
+    }
+    lv_libssh2_fleet_t* fleet = malloc(sizeof(lv_libssh2_fleet_t));
+    if (fleet == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    fleet->entries = calloc(host_count == 0 ? 1 : host_count, sizeof(lv_libssh2_fleet_entry_t));
+    if (fleet->entries == NULL) {
+        free(fleet);
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    fleet->count = host_count;
+    lv_libssh2_fleet_run_t run;
+    run.fleet = fleet;
+    run.hosts = hosts;
+    run.knownhosts = knownhosts;
+    run.command = command;
+    run.command_len = command_len;
+    run.max_output_len = max_output_len;
+    run.timeout_ms = timeout_ms;
+    lv_libssh2_mutex_init(&run.mutex);
+    run.next = 0;
+    size_t thread_count = concurrency == 0 ? DEFAULT_CONCURRENCY : concurrency;
+    if (thread_count > host_count) {
+        thread_count = host_count;
+    }
+    // The calling thread is one of the workers, so one thread fewer is
+    // started.
+    lv_libssh2_thread_t* threads = NULL;
+    if (thread_count > 1) {
+        threads = malloc(sizeof(lv_libssh2_thread_t) * (thread_count - 1));
+    }
+    size_t started = 0;
+    if (threads != NULL) {
+        while (started < thread_count - 1
+            && lv_libssh2_thread_start(&threads[started], lv_libssh2_fleet_worker, &run)) {
+            started++;
+        }
+    }
+    // The calling thread works through whatever hosts are left, which is all
+    // of them if no thread could be started.
+    lv_libssh2_fleet_worker(&run);
+    for (size_t i = 0; i < started; i++) {
+        lv_libssh2_thread_join(threads[i]);
+    }
+    free(threads);
+    lv_libssh2_mutex_destroy(&run.mutex);
+    *handle = fleet;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_fleet_destroy(
+    lv_libssh2_fleet_t* handle
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    for (size_t i = 0; i < handle->count; i++) {
+        lv_libssh2_fleet_entry_t* entry = &handle->entries[i];
+        if (entry->session != NULL) {
+            if (lv_libssh2_status_is_err(lv_libssh2_session_destroy_async(entry->session, "Fleet destroyed"))) {
+                lv_libssh2_session_disconnect(entry->session, "Fleet destroyed");
+                lv_libssh2_session_destroy(entry->session);
+            }
+        }
+        free(entry->output);
+        free(entry->stderr_output);
+    }
+    free(handle->entries);
+    free(handle);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_fleet_host_count(
+    lv_libssh2_fleet_t* handle,
+    size_t* count
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (count == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *count = handle->count;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_fleet_results(
+    lv_libssh2_fleet_t* handle,
+    lv_libssh2_fleet_result_t* results
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (results == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    for (size_t i = 0; i < handle->count; i++) {
+        results[i] = handle->entries[i].result;
+    }
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+static size_t
+lv_libssh2_fleet_packed_len(
+    lv_libssh2_fleet_t* handle,
+    const bool stderr_output
+) {
+    size_t len = 0;
+    for (size_t i = 0; i < handle->count; i++) {
+        const lv_libssh2_fleet_result_t* result = &handle->entries[i].result;
+        len += (size_t)(stderr_output ? result->stderr_output_len : result->output_len);
+    }
+    return len;
+}
+
+static void
+lv_libssh2_fleet_pack(
+    lv_libssh2_fleet_t* handle,
+    const bool stderr_output,
+    uint8_t* buffer
+) {
+    for (size_t i = 0; i < handle->count; i++) {
+        const lv_libssh2_fleet_entry_t* entry = &handle->entries[i];
+        const char* output = stderr_output ? entry->stderr_output : entry->output;
+        size_t len = (size_t)(stderr_output ? entry->result.stderr_output_len : entry->result.output_len);
+        if (len > 0) {
+            memcpy(buffer, output, len);
+            buffer += len;
+        }
+    }
+}
+
+lv_libssh2_status_t
+lv_libssh2_fleet_output_len(
+    lv_libssh2_fleet_t* handle,
+    size_t* len
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (len == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *len = lv_libssh2_fleet_packed_len(handle, false);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_fleet_output(
+    lv_libssh2_fleet_t* handle,
+    uint8_t* buffer
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (buffer == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_fleet_pack(handle, false, buffer);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_fleet_stderr_output_len(
+    lv_libssh2_fleet_t* handle,
+    size_t* len
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (len == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *len = lv_libssh2_fleet_packed_len(handle, true);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_fleet_stderr_output(
+    lv_libssh2_fleet_t* handle,
+    uint8_t* buffer
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (buffer == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_fleet_pack(handle, true, buffer);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_fleet_take_session(
+    lv_libssh2_fleet_t* handle,
+    const size_t index,
+    lv_libssh2_session_t** session
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (session == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (index >= handle->count) {
+        return LV_LIBSSH2_STATUS_ERROR_OUT_OF_BOUNDARY;
+    }
+    *session = handle->entries[index].session;
+    handle->entries[index].session = NULL;
+    return LV_LIBSSH2_STATUS_OK;
+}
@@ -0,0 +1,87 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#ifndef LV_LIBSSH2_JUMP_PRIVATE_H
+#define LV_LIBSSH2_JUMP_PRIVATE_H
+
+#include <stdint.h>
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+
+/**
+ * The pump thread of a jump session, which moves the data of every tunnel
+ * opened through the session between its channel and its socket pair.
+ */
+typedef struct _lv_libssh2_jump lv_libssh2_jump_t;
+
+/**
+ * Opens a direct TCP/IP channel to the host through the jump session and
+ * returns the end of a socket pair that carries the data of the channel. The
+ * other end is pumped by the thread of the jump session, which is started on
+ * first use and switches the jump session to thread safe mode.
+ *
+ * The tunnel is closed when the returned socket is closed, or when the jump
+ * session is destroyed, which the owner of the socket sees as the end of the
+ * stream.
+ */
+lv_libssh2_status_t
+lv_libssh2_jump_open(
+    lv_libssh2_session_t* session,
+    const char* host,
+    const uint16_t port,
+    const uint64_t deadline_us,
+    libssh2_socket_t* socket
+);
+
+/**
+ * Wakes the pump thread, which is called with the session lock held whenever
+ * another thread received data on the jump session, since it may have queued
+ * packets for the channels of the tunnels.
+ */
+void
+lv_libssh2_jump_wake(
+    lv_libssh2_jump_t* jump
+);
+
+/**
+ * Stops the pump thread of the session, if any, and closes its end of every
+ * tunnel. The channels are left to be freed with the session.
+ */
+void
+lv_libssh2_jump_stop(
+    lv_libssh2_session_t* session
+);
+
+#endif
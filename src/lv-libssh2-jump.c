@@ -0,0 +1,579 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/socket.h>
+#endif
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-channel-pool-private.h"
+#include "lv-libssh2-jump-private.h"
+#include "lv-libssh2-session-private.h"
+#include "lv-libssh2-socket-private.h"
+#include "lv-libssh2-status-private.h"
+#include "lv-libssh2-thread-private.h"
+
+// Each direction of a tunnel is buffered separately, so a slow reader on one
+// side never stalls the other, and each buffer holds several full packets so
+// a pass moves as much data as the channel window allows.
+#define BUFFER_SIZE 262144
+#define LOW_MEMORY_BUFFER_SIZE 32768
+#define WAKE_DRAIN_SIZE 64
+// The pump retries after this long if it cannot grow its poll set.
+#define RETRY_WAIT_MS 10
+
+typedef struct _lv_libssh2_jump_buffer {
+    char* data;
+    size_t capacity;
+    size_t start;
+    size_t end;
+} lv_libssh2_jump_buffer_t;
+
+typedef struct _lv_libssh2_jump_tunnel {
+    LIBSSH2_CHANNEL* channel;
+    libssh2_socket_t socket;
+    lv_libssh2_jump_buffer_t to_channel;
+    lv_libssh2_jump_buffer_t to_socket;
+    bool socket_eof;
+    bool channel_eof;
+    bool socket_shut;
+    bool failed;
+    struct _lv_libssh2_jump_tunnel* next;
+} lv_libssh2_jump_tunnel_t;
+
+struct _lv_libssh2_jump {
+    lv_libssh2_session_t* session;
+    lv_libssh2_thread_t thread;
+    lv_libssh2_mutex_t mutex;
+    lv_libssh2_jump_tunnel_t* pending;
+    lv_libssh2_jump_tunnel_t* tunnels;
+    bool stopping;
+    libssh2_socket_t wake[2];
+    lv_libssh2_pollfd_t* fds;
+    size_t fds_capacity;
+};
+
+static bool
+lv_libssh2_jump_buffer_empty(
+    const lv_libssh2_jump_buffer_t* buffer
+) {
+    return buffer->start == buffer->end;
+}
+
+/**
+ * Gets the free space at the end of the buffer, moving the pending data to the
+ * front first if the buffer is filled up to its end.
+ */
+static size_t
+lv_libssh2_jump_buffer_space(
+    lv_libssh2_jump_buffer_t* buffer
+) {
+    if (buffer->end == buffer->capacity && buffer->start > 0) {
+        memmove(buffer->data, buffer->data + buffer->start, buffer->end - buffer->start);
+        buffer->end -= buffer->start;
+        buffer->start = 0;
+    }
+    return buffer->capacity - buffer->end;
+}
+
+static void
+lv_libssh2_jump_buffer_consume(
+    lv_libssh2_jump_buffer_t* buffer,
+    const size_t len
+) {
+    buffer->start += len;
+    if (buffer->start == buffer->end) {
+        buffer->start = 0;
+        buffer->end = 0;
+    }
+}
+
+static lv_libssh2_status_t
+lv_libssh2_jump_tunnel_create(
+    const size_t capacity,
+    lv_libssh2_jump_tunnel_t** handle
+) {
+    *handle = NULL;
+    lv_libssh2_jump_tunnel_t* tunnel = malloc(sizeof(lv_libssh2_jump_tunnel_t));
+    if (tunnel == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    memset(tunnel, 0, sizeof(lv_libssh2_jump_tunnel_t));
+    tunnel->socket = LIBSSH2_INVALID_SOCKET;
+    tunnel->to_channel.data = malloc(capacity);
+    tunnel->to_channel.capacity = capacity;
+    tunnel->to_socket.data = malloc(capacity);
+    tunnel->to_socket.capacity = capacity;
+    if (tunnel->to_channel.data == NULL || tunnel->to_socket.data == NULL) {
+        free(tunnel->to_channel.data);
+        free(tunnel->to_socket.data);
+        free(tunnel);
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    *handle = tunnel;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+/**
+ * Closes the end of the socket pair of the tunnel and frees it, but not its
+ * channel, which is either already freed or left to the session.
+ */
+static void
+lv_libssh2_jump_tunnel_destroy(
+    lv_libssh2_jump_tunnel_t* tunnel
+) {
+    if (tunnel->socket != LIBSSH2_INVALID_SOCKET) {
+        lv_libssh2_socket_close(tunnel->socket);
+    }
+    free(tunnel->to_channel.data);
+    free(tunnel->to_socket.data);
+    free(tunnel);
+}
+
+/**
+ * Moves data of the tunnel in both directions as far as possible without
+ * blocking, and returns `true` if anything changed.
+ */
+static bool
+lv_libssh2_jump_pump(
+    lv_libssh2_jump_t* jump,
+    lv_libssh2_jump_tunnel_t* tunnel
+) {
+    lv_libssh2_session_t* session = jump->session;
+    lv_libssh2_jump_buffer_t* to_channel = &tunnel->to_channel;
+    lv_libssh2_jump_buffer_t* to_socket = &tunnel->to_socket;
+    bool progress = false;
+    uint64_t deadline = 0;
+    ssize_t result = 0;
+    if (!tunnel->socket_eof && lv_libssh2_jump_buffer_space(to_channel) > 0) {
+        result = recv(tunnel->socket, to_channel->data + to_channel->end, to_channel->capacity - to_channel->end, 0);
+        if (result > 0) {
+            to_channel->end += (size_t)result;
+            progress = true;
+        } else if (result == 0 || !lv_libssh2_socket_would_block()) {
+            tunnel->socket_eof = true;
+            progress = true;
+        }
+    }
+    if (tunnel->failed) {
+        // Nothing can be sent anymore, but the socket is still read until its
+        // end, so the owner is never blocked on a full socket.
+        to_channel->start = 0;
+        to_channel->end = 0;
+    } else if (!lv_libssh2_jump_buffer_empty(to_channel)) {
+        do {
+            lv_libssh2_session_lock_io(session);
+            result = libssh2_channel_write(
+                tunnel->channel,
+                to_channel->data + to_channel->start,
+                to_channel->end - to_channel->start
+            );
+        } while (lv_libssh2_session_unlock_io(session, &result, &deadline));
+        if (result > 0) {
+            lv_libssh2_jump_buffer_consume(to_channel, (size_t)result);
+            progress = true;
+        } else if (result != LIBSSH2_ERROR_EAGAIN) {
+            tunnel->failed = true;
+            progress = true;
+        }
+    }
+    if (!tunnel->failed && !tunnel->channel_eof && lv_libssh2_jump_buffer_space(to_socket) > 0) {
+        do {
+            lv_libssh2_session_lock_io(session);
+            result = libssh2_channel_read(
+                tunnel->channel,
+                to_socket->data + to_socket->end,
+                to_socket->capacity - to_socket->end
+            );
+        } while (lv_libssh2_session_unlock_io(session, &result, &deadline));
+        if (result > 0) {
+            to_socket->end += (size_t)result;
+            progress = true;
+        } else if (result == 0) {
+            tunnel->channel_eof = true;
+            progress = true;
+        } else if (result != LIBSSH2_ERROR_EAGAIN) {
+            tunnel->failed = true;
+            progress = true;
+        }
+    }
+    if (!tunnel->socket_eof && !lv_libssh2_jump_buffer_empty(to_socket)) {
+        result = lv_libssh2_socket_send(
+            tunnel->socket,
+            to_socket->data + to_socket->start,
+            to_socket->end - to_socket->start
+        );
+        if (result > 0) {
+            lv_libssh2_jump_buffer_consume(to_socket, (size_t)result);
+            progress = true;
+        } else if (!lv_libssh2_socket_would_block()) {
+            tunnel->socket_eof = true;
+            progress = true;
+        }
+    }
+    if ((tunnel->channel_eof || tunnel->failed) && lv_libssh2_jump_buffer_empty(to_socket) && !tunnel->socket_shut) {
+        lv_libssh2_socket_shutdown_send(tunnel->socket);
+        tunnel->socket_shut = true;
+        progress = true;
+    }
+    return progress;
+}
+
+/**
+ * Frees the channel of the tunnel once its socket is closed by the owner and
+ * everything the owner sent is written, and returns `true` when the tunnel is
+ * done.
+ */
+static bool
+lv_libssh2_jump_finish(
+    lv_libssh2_jump_t* jump,
+    lv_libssh2_jump_tunnel_t* tunnel
+) {
+    if (!tunnel->socket_eof) {
+        return false;
+    }
+    if (!tunnel->failed && !lv_libssh2_jump_buffer_empty(&tunnel->to_channel)) {
+        return false;
+    }
+    uint64_t deadline = 0;
+    ssize_t result = 0;
+    do {
+        lv_libssh2_session_lock_io(jump->session);
+        result = libssh2_channel_free(tunnel->channel);
+    } while (lv_libssh2_session_unlock_io(jump->session, &result, &deadline));
+    return result != LIBSSH2_ERROR_EAGAIN;
+}
+
+/**
+ * Waits until a socket of a tunnel is ready for the data it has pending, the
+ * jump session receives data for the channels that can take it, or the pump is
+ * woken.
+ */
+static void
+lv_libssh2_jump_wait(
+    lv_libssh2_jump_t* jump
+) {
+    // One entry for the wake socket, one per tunnel, and one for the session.
+    size_t capacity = 2;
+    for (lv_libssh2_jump_tunnel_t* tunnel = jump->tunnels; tunnel != NULL; tunnel = tunnel->next) {
+        capacity++;
+    }
+    if (capacity > jump->fds_capacity) {
+        lv_libssh2_pollfd_t* fds = realloc(jump->fds, sizeof(lv_libssh2_pollfd_t) * capacity);
+        if (fds == NULL) {
+            lv_libssh2_pollfd_t wake;
+            wake.fd = jump->wake[0];
+            wake.events = POLLIN;
+            wake.revents = 0;
+            lv_libssh2_poll(&wake, 1, RETRY_WAIT_MS);
+            return;
+        }
+        jump->fds = fds;
+        jump->fds_capacity = capacity;
+    }
+    lv_libssh2_pollfd_t* fds = jump->fds;
+    fds[0].fd = jump->wake[0];
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    size_t count = 1;
+    bool session_needed = false;
+    for (lv_libssh2_jump_tunnel_t* tunnel = jump->tunnels; tunnel != NULL; tunnel = tunnel->next) {
+        if (!tunnel->socket_eof) {
+            short events = 0;
+            if (tunnel->to_channel.end - tunnel->to_channel.start < tunnel->to_channel.capacity) {
+                events |= POLLIN;
+            }
+            if (!lv_libssh2_jump_buffer_empty(&tunnel->to_socket)) {
+                events |= POLLOUT;
+            }
+            if (events != 0) {
+                fds[count].fd = tunnel->socket;
+                fds[count].events = events;
+                fds[count].revents = 0;
+                count++;
+            }
+        }
+        // Only wait on the session when a channel call can consume what it
+        // receives, since the data stays readable until then.
+        if (!tunnel->failed && (tunnel->socket_eof
+            || !lv_libssh2_jump_buffer_empty(&tunnel->to_channel)
+            || (!tunnel->channel_eof && tunnel->to_socket.end - tunnel->to_socket.start < tunnel->to_socket.capacity))) {
+            session_needed = true;
+        }
+    }
+    libssh2_socket_t session_socket = jump->session->socket;
+    if (session_needed && session_socket != LIBSSH2_INVALID_SOCKET) {
+        fds[count].fd = session_socket;
+        fds[count].events = POLLIN;
+        fds[count].revents = 0;
+        count++;
+    }
+    int result = lv_libssh2_poll(fds, count, -1);
+    if (result > 0 && (fds[0].revents & POLLIN)) {
+        char buffer[WAKE_DRAIN_SIZE];
+        while (recv(jump->wake[0], buffer, sizeof(buffer), 0) > 0) {}
+    }
+}
+
+/**
+ * Pumps every tunnel until nothing moves, then waits for more, until the jump
+ * session is destroyed. The thread stays in non-blocking mode for the session,
+ * so a channel that cannot move never holds up the others.
+ */
+static void
+lv_libssh2_jump_main(
+    void* arg
+) {
+    lv_libssh2_jump_t* jump = arg;
+    lv_libssh2_session_t* session = jump->session;
+    lv_libssh2_session_lock(session);
+    int blocking = lv_libssh2_session_begin_nonblocking(session);
+    lv_libssh2_session_unlock(session);
+    for (;;) {
+        lv_libssh2_mutex_lock(&jump->mutex);
+        bool stopping = jump->stopping;
+        while (jump->pending != NULL) {
+            lv_libssh2_jump_tunnel_t* tunnel = jump->pending;
+            jump->pending = tunnel->next;
+            tunnel->next = jump->tunnels;
+            jump->tunnels = tunnel;
+        }
+        lv_libssh2_mutex_unlock(&jump->mutex);
+        if (stopping) {
+            break;
+        }
+        bool progress = false;
+        lv_libssh2_jump_tunnel_t** link = &jump->tunnels;
+        while (*link != NULL) {
+            lv_libssh2_jump_tunnel_t* tunnel = *link;
+            if (lv_libssh2_jump_pump(jump, tunnel)) {
+                progress = true;
+            }
+            if (lv_libssh2_jump_finish(jump, tunnel)) {
+                *link = tunnel->next;
+                lv_libssh2_jump_tunnel_destroy(tunnel);
+                progress = true;
+            } else {
+                link = &tunnel->next;
+            }
+        }
+        if (!progress) {
+            lv_libssh2_jump_wait(jump);
+        }
+    }
+    lv_libssh2_session_lock(session);
+    lv_libssh2_session_end_nonblocking(session, blocking);
+    lv_libssh2_session_unlock(session);
+}
+
+/**
+ * Gets the pump of the session, starting it if the session does not have one
+ * yet.
+ */
+static lv_libssh2_status_t
+lv_libssh2_jump_start(
+    lv_libssh2_session_t* session,
+    lv_libssh2_jump_t** handle
+) {
+    lv_libssh2_status_t status = LV_LIBSSH2_STATUS_OK;
+    lv_libssh2_session_lock(session);
+    if (session->jump == NULL) {
+        lv_libssh2_jump_t* jump = malloc(sizeof(lv_libssh2_jump_t));
+        if (jump == NULL) {
+            lv_libssh2_session_unlock(session);
+            return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+        }
+        status = lv_libssh2_socket_pair(jump->wake);
+        if (lv_libssh2_status_is_err(status)) {
+            lv_libssh2_session_unlock(session);
+            free(jump);
+            return status;
+        }
+        lv_libssh2_socket_set_nonblocking(jump->wake[0], true);
+        lv_libssh2_socket_set_nonblocking(jump->wake[1], true);
+        jump->session = session;
+        lv_libssh2_mutex_init(&jump->mutex);
+        jump->pending = NULL;
+        jump->tunnels = NULL;
+        jump->stopping = false;
+        jump->fds = NULL;
+        jump->fds_capacity = 0;
+        if (!lv_libssh2_thread_start(&jump->thread, lv_libssh2_jump_main, jump)) {
+            lv_libssh2_session_unlock(session);
+            lv_libssh2_socket_close(jump->wake[0]);
+            lv_libssh2_socket_close(jump->wake[1]);
+            lv_libssh2_mutex_destroy(&jump->mutex);
+            free(jump);
+            return LV_LIBSSH2_STATUS_ERROR_GENERIC;
+        }
+        session->jump = jump;
+    }
+    *handle = session->jump;
+    lv_libssh2_session_unlock(session);
+    return status;
+}
+
+/**
+ * Opens the direct TCP/IP channel before the deadline. The session lock is
+ * held for the whole open, since libssh2 keeps the state of the open in the
+ * session, and another thread opening a channel between the retries would
+ * resume this open and take its channel.
+ */
+static lv_libssh2_status_t
+lv_libssh2_jump_channel_open(
+    lv_libssh2_session_t* session,
+    const char* host,
+    const uint16_t port,
+    const uint64_t deadline_us,
+    LIBSSH2_CHANNEL** channel
+) {
+    *channel = NULL;
+    lv_libssh2_status_t status = LV_LIBSSH2_STATUS_OK;
+    lv_libssh2_session_lock(session);
+    int blocking = lv_libssh2_session_begin_nonblocking(session);
+    for (;;) {
+        int error_code = lv_libssh2_channel_pool_settle(session);
+        if (error_code == 0) {
+            *channel = libssh2_channel_direct_tcpip(session->inner, host, port);
+            error_code = *channel == NULL ? libssh2_session_last_errno(session->inner) : 0;
+        }
+        if (*channel != NULL) {
+            break;
+        }
+        if (error_code != LIBSSH2_ERROR_EAGAIN) {
+            status = lv_libssh2_status_from_result(error_code);
+            break;
+        }
+        status = lv_libssh2_session_wait_socket_locked(session, deadline_us);
+        if (lv_libssh2_status_is_err(status)) {
+            break;
+        }
+    }
+    lv_libssh2_session_end_nonblocking(session, blocking);
+    lv_libssh2_session_unlock(session);
+    return status;
+}
+
+lv_libssh2_status_t
+lv_libssh2_jump_open(
+    lv_libssh2_session_t* session,
+    const char* host,
+    const uint16_t port,
+    const uint64_t deadline_us,
+    libssh2_socket_t* socket
+) {
+    lv_libssh2_status_t status = lv_libssh2_session_set_thread_safe(session, true);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    lv_libssh2_jump_t* jump = NULL;
+    status = lv_libssh2_jump_start(session, &jump);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    lv_libssh2_jump_tunnel_t* tunnel = NULL;
+    size_t capacity = session->memory_mode == LV_LIBSSH2_MEMORY_MODE_LOW ? LOW_MEMORY_BUFFER_SIZE : BUFFER_SIZE;
+    status = lv_libssh2_jump_tunnel_create(capacity, &tunnel);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    libssh2_socket_t pair[2];
+    status = lv_libssh2_socket_pair(pair);
+    if (lv_libssh2_status_is_err(status)) {
+        lv_libssh2_jump_tunnel_destroy(tunnel);
+        return status;
+    }
+    tunnel->socket = pair[1];
+    status = lv_libssh2_jump_channel_open(session, host, port, deadline_us, &tunnel->channel);
+    if (lv_libssh2_status_is_err(status)) {
+        lv_libssh2_socket_close(pair[0]);
+        lv_libssh2_jump_tunnel_destroy(tunnel);
+        return status;
+    }
+    lv_libssh2_socket_set_nonblocking(pair[1], true);
+    lv_libssh2_mutex_lock(&jump->mutex);
+    tunnel->next = jump->pending;
+    jump->pending = tunnel;
+    lv_libssh2_mutex_unlock(&jump->mutex);
+    lv_libssh2_jump_wake(jump);
+    *socket = pair[0];
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+void
+lv_libssh2_jump_wake(
+    lv_libssh2_jump_t* jump
+) {
+    char byte = 0;
+    lv_libssh2_socket_send(jump->wake[1], &byte, 1);
+}
+
+void
+lv_libssh2_jump_stop(
+    lv_libssh2_session_t* session
+) {
+    lv_libssh2_jump_t* jump = session->jump;
+    if (jump == NULL) {
+        return;
+    }
+    lv_libssh2_mutex_lock(&jump->mutex);
+    jump->stopping = true;
+    lv_libssh2_mutex_unlock(&jump->mutex);
+    lv_libssh2_jump_wake(jump);
+    lv_libssh2_thread_join(jump->thread);
+    lv_libssh2_session_lock(session);
+    session->jump = NULL;
+    lv_libssh2_session_unlock(session);
+    lv_libssh2_jump_tunnel_t* lists[2] = { jump->pending, jump->tunnels };
+    for (size_t i = 0; i < 2; i++) {
+        lv_libssh2_jump_tunnel_t* tunnel = lists[i];
+        while (tunnel != NULL) {
+            lv_libssh2_jump_tunnel_t* next = tunnel->next;
+            lv_libssh2_jump_tunnel_destroy(tunnel);
+            tunnel = next;
+        }
+    }
+    lv_libssh2_socket_close(jump->wake[0]);
+    lv_libssh2_socket_close(jump->wake[1]);
+    lv_libssh2_mutex_destroy(&jump->mutex);
+    free(jump->fds);
+    free(jump);
+}
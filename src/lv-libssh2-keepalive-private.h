@@ -0,0 +1,74 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#ifndef LV_LIBSSH2_KEEPALIVE_PRIVATE_H
+#define LV_LIBSSH2_KEEPALIVE_PRIVATE_H
+
+#include "lv-libssh2.h"
+
+/**
+ * Removes the session from the keepalive scheduler, if it was added. Once this
+ * returns, the scheduler thread no longer uses the session.
+ */
+void
+lv_libssh2_keepalive_unregister(
+    lv_libssh2_session_t* handle
+);
+
+/**
+ * Has the scheduler thread send the writes held back by coalescing on the
+ * channel at `due_us`, unless they have all been sent by then. The coalescing
+ * lock of the channel must be held.
+ */
+lv_libssh2_status_t
+lv_libssh2_keepalive_schedule_flush(
+    lv_libssh2_channel_t* channel,
+    const uint64_t due_us
+);
+
+/**
+ * Removes a flush of the channel from the scheduler, if one was added. Once
+ * this returns, the scheduler thread no longer uses the channel.
+ */
+void
+lv_libssh2_keepalive_cancel_flush(
+    lv_libssh2_channel_t* channel
+);
+
+/**
+ * Stops the keepalive scheduler thread and removes all sessions from it.
+ */
+void
+lv_libssh2_keepalive_shutdown();
+
+#endif
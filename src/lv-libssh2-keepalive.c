@@ -0,0 +1,451 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-channel-private.h"
+#include "lv-libssh2-keepalive-private.h"
+#include "lv-libssh2-status-private.h"
+#include "lv-libssh2-session-private.h"
+#include "lv-libssh2-socket-private.h"
+#include "lv-libssh2-thread-private.h"
+#include "lv-libssh2-time-private.h"
+
+#define MICROSECONDS_PER_SECOND 1000000
+#define MIN_INTERVAL_S 2
+#define MAX_UNANSWERED 3
+#define BUSY_RETRY_US 1000000
+#define FLUSH_RETRY_US 1000
+#define MAX_UNREAD_BYTES 16384
+#define INITIAL_CAPACITY 16
+
+/**
+ * A session to send keepalives on or, if the channel is set, a channel with
+ * held writes to send, in which case the session is NULL.
+ */
+typedef struct _lv_libssh2_keepalive_entry {
+    lv_libssh2_session_t* session;
+    lv_libssh2_channel_t* channel;
+    uint64_t due_us;
+    bool awaiting;
+    uint64_t received_at_send;
+    uint32_t unanswered;
+} lv_libssh2_keepalive_entry_t;
+
+static lv_libssh2_mutex_t scheduler_mutex = LV_LIBSSH2_MUTEX_INITIALIZER;
+static lv_libssh2_cond_t scheduler_cond = LV_LIBSSH2_COND_INITIALIZER;
+static lv_libssh2_thread_t scheduler_thread;
+static bool scheduler_running = false;
+static bool scheduler_stopping = false;
+static lv_libssh2_keepalive_entry_t* scheduler_entries = NULL;
+static size_t scheduler_count = 0;
+static size_t scheduler_capacity = 0;
+
+/**
+ * Marks the session as dead and shuts down its socket, so an operation that
+ * is blocked on the session, or the next one, fails at once instead of after
+ * a TCP timeout. The scheduler lock must be held.
+ */
+static void
+lv_libssh2_keepalive_mark_dead(
+    lv_libssh2_session_t* session
+) {
+    session->state = LV_LIBSSH2_SESSION_STATE_DEAD;
+    lv_libssh2_socket_shutdown(session->socket);
+}
+
+/**
+ * Checks the socket of a due session and sends a keepalive request. A session
+ * that is in use by another thread, or that has a packet of the owner only
+ * partly sent, is only checked and retried sooner, since the owner is
+ * exchanging packets anyway. The scheduler lock must be held.
+ *
+ * The replies are read by the owner of the session, if at all, so a request
+ * counts as answered when the bytes received by the session plus those still
+ * waiting on the socket have grown since it was sent. The session is marked
+ * dead after MAX_UNANSWERED requests in a row went unanswered or failed to
+ * send. While more than MAX_UNREAD_BYTES wait unread, a reply could be held up
+ * behind them, so no reply is asked for and the user timeout of the socket is
+ * left to notice a dead peer.
+ */
+static void
+lv_libssh2_keepalive_service(
+    lv_libssh2_keepalive_entry_t* entry,
+    const uint64_t now
+) {
+    lv_libssh2_session_t* session = entry->session;
+    uint64_t interval_us = (uint64_t)session->keepalive_interval_s * MICROSECONDS_PER_SECOND;
+    uint64_t busy_due_us = now + (interval_us < BUSY_RETRY_US ? interval_us : BUSY_RETRY_US);
+    entry->due_us = now + interval_us;
+    if (session->state == LV_LIBSSH2_SESSION_STATE_DEAD) {
+        return;
+    }
+    if (lv_libssh2_socket_is_closed(session->socket)) {
+        lv_libssh2_keepalive_mark_dead(session);
+        return;
+    }
+    if (!lv_libssh2_session_try_lock(session)) {
+        entry->due_us = busy_due_us;
+        return;
+    }
+    // libssh2 only keeps a pointer to a packet it could not send whole, which
+    // for a keepalive is gone once the call returns, so one is only sent when
+    // nothing else is pending and the socket can take it.
+    if ((libssh2_session_block_directions(session->inner) & LIBSSH2_SESSION_BLOCK_OUTBOUND) != 0
+        || !lv_libssh2_socket_is_writable(session->socket)) {
+        lv_libssh2_session_unlock(session);
+        entry->due_us = busy_due_us;
+        return;
+    }
+    size_t pending = lv_libssh2_socket_pending(session->socket);
+    uint64_t received = session->received + pending;
+    bool want_reply = pending < MAX_UNREAD_BYTES;
+    libssh2_keepalive_config(session->inner, want_reply, session->keepalive_interval_s);
+    int blocking = libssh2_session_get_blocking(session->inner);
+    libssh2_session_set_blocking(session->inner, LV_LIBSSH2_SESSION_MODE_NONBLOCKING);
+    int seconds_to_next = 0;
+    int result = libssh2_keepalive_send(session->inner, &seconds_to_next);
+    libssh2_session_set_blocking(session->inner, blocking);
+    bool stranded = (libssh2_session_block_directions(session->inner) & LIBSSH2_SESSION_BLOCK_OUTBOUND) != 0;
+    lv_libssh2_session_unlock(session);
+    if (result == LIBSSH2_ERROR_BAD_USE || result == LIBSSH2_ERROR_EAGAIN) {
+        entry->due_us = busy_due_us;
+        return;
+    }
+    if (stranded) {
+        // Every later packet would wait behind the part that is left, which
+        // nothing can send anymore.
+        lv_libssh2_keepalive_mark_dead(session);
+        return;
+    }
+    // libssh2 counts the interval in whole seconds from its last send, so it
+    // may decline to send yet and report the remaining time instead.
+    if (result == 0 && seconds_to_next > 0 && (uint32_t)seconds_to_next < session->keepalive_interval_s) {
+        entry->due_us = now + (uint64_t)seconds_to_next * MICROSECONDS_PER_SECOND;
+        return;
+    }
+    if (received != entry->received_at_send) {
+        entry->unanswered = 0;
+    } else if (entry->awaiting) {
+        entry->unanswered++;
+    }
+    if (result != 0) {
+        entry->unanswered++;
+    }
+    entry->awaiting = result == 0 && want_reply;
+    entry->received_at_send = received;
+    if (entry->unanswered >= MAX_UNANSWERED) {
+        lv_libssh2_keepalive_mark_dead(session);
+    }
+}
+
+/**
+ * Sends the held writes of a channel whose delay has passed, unless the owner
+ * is using the channel or its session, or the session has a packet only partly
+ * sent or a full socket, in which case it is retried shortly. A packet this
+ * starts is finished with the session lock held, waiting for the socket as
+ * needed, so the owner never finds it half sent. Returns whether writes are
+ * still held, since the entry is removed otherwise. An error is left for the
+ * next call of the owner to report. The scheduler lock must be held.
+ */
+static bool
+lv_libssh2_keepalive_flush(
+    lv_libssh2_keepalive_entry_t* entry,
+    const uint64_t now
+) {
+    lv_libssh2_channel_t* channel = entry->channel;
+    entry->due_us = now + FLUSH_RETRY_US;
+    if (!lv_libssh2_mutex_try_lock(&channel->coalesce_lock)) {
+        return true;
+    }
+    lv_libssh2_session_t* session = channel->session;
+    ssize_t written = 0;
+    if (channel->coalesce_len > 0 && lv_libssh2_session_try_lock(session)) {
+        if ((libssh2_session_block_directions(session->inner) & LIBSSH2_SESSION_BLOCK_OUTBOUND) == 0
+            && lv_libssh2_socket_is_writable(session->socket)) {
+            int blocking = lv_libssh2_session_begin_nonblocking(session);
+            uint64_t deadline_us = 0;
+            for (;;) {
+                written = libssh2_channel_write_ex(channel->inner, 0, channel->coalesce_buffer, channel->coalesce_len);
+                if (written != LIBSSH2_ERROR_EAGAIN
+                    || (libssh2_session_block_directions(session->inner) & LIBSSH2_SESSION_BLOCK_OUTBOUND) == 0) {
+                    break;
+                }
+                if (deadline_us == 0) {
+                    long timeout_ms = libssh2_session_get_timeout(session->inner);
+                    deadline_us = timeout_ms > 0 ? lv_libssh2_time_deadline_us((int32_t)timeout_ms) : LV_LIBSSH2_TIME_NO_DEADLINE;
+                }
+                if (lv_libssh2_status_is_err(lv_libssh2_session_wait_socket_locked(session, deadline_us))) {
+                    break;
+                }
+            }
+            lv_libssh2_session_end_nonblocking(session, blocking);
+        }
+        lv_libssh2_session_unlock(session);
+        if (written > 0) {
+            memmove(channel->coalesce_buffer, channel->coalesce_buffer + written, channel->coalesce_len - written);
+            channel->coalesce_len -= written;
+        }
+    }
+    bool pending = channel->coalesce_len > 0 && (written >= 0 || written == LIBSSH2_ERROR_EAGAIN);
+    channel->flush_scheduled = pending;
+    lv_libssh2_mutex_unlock(&channel->coalesce_lock);
+    return pending;
+}
+
+static void
+lv_libssh2_keepalive_main(
+    void* arg
+) {
+    (void)arg;
+    lv_libssh2_mutex_lock(&scheduler_mutex);
+    while (!scheduler_stopping) {
+        uint64_t now = lv_libssh2_time_now_us();
+        uint64_t wake_us = LV_LIBSSH2_TIME_NO_DEADLINE;
+        size_t i = 0;
+        while (i < scheduler_count) {
+            lv_libssh2_keepalive_entry_t* entry = &scheduler_entries[i];
+            if (entry->due_us <= now) {
+                if (entry->channel == NULL) {
+                    lv_libssh2_keepalive_service(entry, now);
+                } else if (!lv_libssh2_keepalive_flush(entry, now)) {
+                    scheduler_entries[i] = scheduler_entries[scheduler_count - 1];
+                    scheduler_count--;
+                    continue;
+                }
+            }
+            if (entry->due_us < wake_us) {
+                wake_us = entry->due_us;
+            }
+            i++;
+        }
+        lv_libssh2_cond_wait(&scheduler_cond, &scheduler_mutex, wake_us);
+    }
+    lv_libssh2_mutex_unlock(&scheduler_mutex);
+}
+
+/**
+ * Adds an entry with room to grow the list as needed. The scheduler lock must
+ * be held, and the thread is started if it is not running yet.
+ */
+static lv_libssh2_status_t
+lv_libssh2_keepalive_add(
+    const lv_libssh2_keepalive_entry_t* entry
+) {
+    if (!scheduler_running) {
+        if (!lv_libssh2_thread_start(&scheduler_thread, lv_libssh2_keepalive_main, NULL)) {
+            return LV_LIBSSH2_STATUS_ERROR_GENERIC;
+        }
+        scheduler_running = true;
+    }
+    if (scheduler_count == scheduler_capacity) {
+        size_t capacity = scheduler_capacity == 0 ? INITIAL_CAPACITY : scheduler_capacity * 2;
+        lv_libssh2_keepalive_entry_t* entries = realloc(scheduler_entries, capacity * sizeof(lv_libssh2_keepalive_entry_t));
+        if (entries == NULL) {
+            return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+        }
+        scheduler_entries = entries;
+        scheduler_capacity = capacity;
+    }
+    scheduler_entries[scheduler_count] = *entry;
+    scheduler_count++;
+    lv_libssh2_cond_broadcast(&scheduler_cond);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+void
+lv_libssh2_keepalive_unregister(
+    lv_libssh2_session_t* handle
+) {
+    lv_libssh2_mutex_lock(&scheduler_mutex);
+    if (!handle->scheduled) {
+        lv_libssh2_mutex_unlock(&scheduler_mutex);
+        return;
+    }
+    for (size_t i = 0; i < scheduler_count; i++) {
+        if (scheduler_entries[i].session == handle) {
+            scheduler_entries[i] = scheduler_entries[scheduler_count - 1];
+            scheduler_count--;
+            break;
+        }
+    }
+    handle->scheduled = false;
+    handle->keepalive_interval_s = 0;
+    lv_libssh2_mutex_unlock(&scheduler_mutex);
+}
+
+lv_libssh2_status_t
+lv_libssh2_keepalive_schedule_flush(
+    lv_libssh2_channel_t* channel,
+    const uint64_t due_us
+) {
+    lv_libssh2_keepalive_entry_t entry;
+    entry.session = NULL;
+    entry.channel = channel;
+    entry.due_us = due_us;
+    entry.awaiting = false;
+    entry.received_at_send = 0;
+    entry.unanswered = 0;
+    lv_libssh2_mutex_lock(&scheduler_mutex);
+    lv_libssh2_status_t status = lv_libssh2_keepalive_add(&entry);
+    if (!lv_libssh2_status_is_err(status)) {
+        channel->flush_scheduled = true;
+    }
+    lv_libssh2_mutex_unlock(&scheduler_mutex);
+    return status;
+}
+
+void
+lv_libssh2_keepalive_cancel_flush(
+    lv_libssh2_channel_t* channel
+) {
+    lv_libssh2_mutex_lock(&scheduler_mutex);
+    for (size_t i = 0; i < scheduler_count; i++) {
+        if (scheduler_entries[i].channel == channel) {
+            scheduler_entries[i] = scheduler_entries[scheduler_count - 1];
+            scheduler_count--;
+            break;
+        }
+    }
+    channel->flush_scheduled = false;
+    lv_libssh2_mutex_unlock(&scheduler_mutex);
+}
+
+void
+lv_libssh2_keepalive_shutdown()
+{
+    lv_libssh2_mutex_lock(&scheduler_mutex);
+    bool running = scheduler_running;
+    scheduler_stopping = true;
+    lv_libssh2_cond_broadcast(&scheduler_cond);
+    lv_libssh2_mutex_unlock(&scheduler_mutex);
+    if (running) {
+        lv_libssh2_thread_join(scheduler_thread);
+    }
+    lv_libssh2_mutex_lock(&scheduler_mutex);
+    for (size_t i = 0; i < scheduler_count; i++) {
+        if (scheduler_entries[i].channel != NULL) {
+            scheduler_entries[i].channel->flush_scheduled = false;
+        } else {
+            scheduler_entries[i].session->scheduled = false;
+            scheduler_entries[i].session->keepalive_interval_s = 0;
+        }
+    }
+    free(scheduler_entries);
+    scheduler_entries = NULL;
+    scheduler_count = 0;
+    scheduler_capacity = 0;
+    scheduler_running = false;
+    scheduler_stopping = false;
+    lv_libssh2_mutex_unlock(&scheduler_mutex);
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_set_keepalive(
+    lv_libssh2_session_t* handle,
+    const uint32_t interval_s
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (interval_s == 0) {
+        lv_libssh2_keepalive_unregister(handle);
+        lv_libssh2_session_lock(handle);
+        libssh2_keepalive_config(handle->inner, 0, 0);
+        lv_libssh2_session_unlock(handle);
+        if (handle->socket != LIBSSH2_INVALID_SOCKET) {
+            lv_libssh2_socket_set_user_timeout(handle->socket, 0);
+        }
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    if (handle->socket == LIBSSH2_INVALID_SOCKET) {
+        return LV_LIBSSH2_STATUS_ERROR_SOCKET_NONE;
+    }
+    uint32_t interval = interval_s < MIN_INTERVAL_S ? MIN_INTERVAL_S : interval_s;
+    lv_libssh2_session_lock(handle);
+    libssh2_keepalive_config(handle->inner, 1, interval);
+    lv_libssh2_session_count_received(handle);
+    lv_libssh2_session_unlock(handle);
+    lv_libssh2_socket_set_user_timeout(handle->socket, interval * MAX_UNANSWERED * 1000);
+    lv_libssh2_mutex_lock(&scheduler_mutex);
+    // The session locks from here on, before the scheduler can touch it.
+    handle->locking = true;
+    uint64_t due_us = lv_libssh2_time_now_us() + (uint64_t)interval * MICROSECONDS_PER_SECOND;
+    if (handle->scheduled) {
+        for (size_t i = 0; i < scheduler_count; i++) {
+            if (scheduler_entries[i].session == handle) {
+                scheduler_entries[i].due_us = due_us;
+            }
+        }
+        lv_libssh2_cond_broadcast(&scheduler_cond);
+    } else {
+        lv_libssh2_keepalive_entry_t entry;
+        entry.session = handle;
+        entry.channel = NULL;
+        entry.due_us = due_us;
+        entry.awaiting = false;
+        entry.received_at_send = 0;
+        entry.unanswered = 0;
+        lv_libssh2_status_t status = lv_libssh2_keepalive_add(&entry);
+        if (lv_libssh2_status_is_err(status)) {
+            lv_libssh2_mutex_unlock(&scheduler_mutex);
+            return status;
+        }
+        handle->scheduled = true;
+    }
+    handle->keepalive_interval_s = interval;
+    lv_libssh2_mutex_unlock(&scheduler_mutex);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_state(
+    lv_libssh2_session_t* handle,
+    lv_libssh2_session_states_t* state
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (state == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_mutex_lock(&scheduler_mutex);
+    *state = handle->state;
+    lv_libssh2_mutex_unlock(&scheduler_mutex);
+    return LV_LIBSSH2_STATUS_OK;
+}
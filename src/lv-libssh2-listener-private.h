@@ -38,6 +38,7 @@
 
 struct _lv_libssh2_listener {
     LIBSSH2_LISTENER* inner;
+    lv_libssh2_session_t* session;
 };
 
 #endif
@@ -0,0 +1,145 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#ifndef LV_LIBSSH2_MEMORY_PRIVATE_H
+#define LV_LIBSSH2_MEMORY_PRIVATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+
+/**
+ * The allocator of a session created with lv_libssh2_session_create_ex(),
+ * which libssh2 uses for everything it allocates for the session and which
+ * counts the memory it holds.
+ */
+typedef struct _lv_libssh2_memory lv_libssh2_memory_t;
+
+/**
+ * Creates an allocator. A pooled allocator rounds allocations up to a power of
+ * two and keeps freed blocks of up to `retain_limit` bytes in total for reuse,
+ * so a session that repeatedly allocates packets of similar sizes reuses the
+ * same blocks instead of fragmenting the heap.
+ *
+ * With a non-zero `arena_size`, the allocator is pooled and takes every block
+ * from one region allocated here instead of from the system, and keeps every
+ * freed block for reuse, so it never calls malloc() or free() afterwards. An
+ * allocation fails once the arena is exhausted.
+ *
+ * With a non-zero `limit`, an allocation that would make the allocator hold
+ * more than `limit` bytes fails, after the blocks kept for reuse are freed to
+ * make room if that helps.
+ */
+lv_libssh2_status_t
+lv_libssh2_memory_create(
+    const bool pooled,
+    const size_t retain_limit,
+    const size_t arena_size,
+    const uint64_t limit,
+    lv_libssh2_memory_t** handle
+);
+
+/**
+ * Releases the blocks kept for reuse and the allocator. Everything allocated
+ * from it must be freed first.
+ */
+void
+lv_libssh2_memory_destroy(
+    lv_libssh2_memory_t* handle
+);
+
+/**
+ * Gets the bytes currently held from the system or the arena, including the
+ * blocks kept for reuse and the bookkeeping of each block, and the most ever
+ * held.
+ */
+void
+lv_libssh2_memory_usage(
+    lv_libssh2_memory_t* handle,
+    uint64_t* current,
+    uint64_t* peak
+);
+
+/**
+ * The libssh2 allocation callbacks, where the abstract pointer of the libssh2
+ * session is the session that owns the allocator.
+ */
+void*
+lv_libssh2_memory_alloc(
+    size_t count,
+    void** abstract
+);
+
+void
+lv_libssh2_memory_free(
+    void* ptr,
+    void** abstract
+);
+
+void*
+lv_libssh2_memory_realloc(
+    void* ptr,
+    size_t count,
+    void** abstract
+);
+
+/**
+ * Allocates the wrappers and buffers of a session from its allocator, so they
+ * come from the arena in the real-time mode, or from the system if the
+ * session has no allocator. Memory from these must only be resized and freed
+ * with them.
+ */
+void*
+lv_libssh2_memory_session_alloc(
+    lv_libssh2_session_t* session,
+    const size_t size
+);
+
+void*
+lv_libssh2_memory_session_realloc(
+    lv_libssh2_session_t* session,
+    void* ptr,
+    const size_t size
+);
+
+void
+lv_libssh2_memory_session_free(
+    lv_libssh2_session_t* session,
+    void* ptr
+);
+
+#endif
@@ -0,0 +1,413 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-memory-private.h"
+#include "lv-libssh2-session-private.h"
+#include "lv-libssh2-thread-private.h"
+
+// Blocks of 32 bytes up to 64 KB, which covers the packets libssh2 allocates
+// for the default maximum packet size, are pooled. Larger ones are allocated
+// and freed directly.
+#define MIN_CLASS_SHIFT 5
+#define CLASS_COUNT 12
+#define UNPOOLED CLASS_COUNT
+
+/**
+ * The bookkeeping in front of every block, which keeps the payload aligned
+ * like malloc() does on the common platforms.
+ */
+typedef struct _lv_libssh2_memory_header {
+    size_t size;
+    size_t class_index;
+} lv_libssh2_memory_header_t;
+
+struct _lv_libssh2_memory {
+    lv_libssh2_mutex_t mutex;
+    bool pooled;
+    size_t retain_limit;
+    size_t retained;
+    void* free_lists[CLASS_COUNT];
+    char* arena;
+    size_t arena_size;
+    size_t arena_used;
+    lv_libssh2_memory_header_t* large_blocks;
+    uint64_t limit;
+    uint64_t current;
+    uint64_t peak;
+};
+
+/**
+ * Gets the smallest size class that fits a block of `size` bytes including
+ * its header, or ::UNPOOLED if it is too large for the pool.
+ */
+static size_t
+lv_libssh2_memory_class(
+    const size_t size
+) {
+    for (size_t class_index = 0; class_index < CLASS_COUNT; class_index++) {
+        if (size <= ((size_t)1 << (class_index + MIN_CLASS_SHIFT))) {
+            return class_index;
+        }
+    }
+    return UNPOOLED;
+}
+
+static lv_libssh2_memory_t*
+lv_libssh2_memory_of(
+    void** abstract
+) {
+    lv_libssh2_session_t* session = *abstract;
+    return session->memory;
+}
+
+static void
+lv_libssh2_memory_add(
+    lv_libssh2_memory_t* handle,
+    const size_t size
+) {
+    handle->current += size;
+    if (handle->current > handle->peak) {
+        handle->peak = handle->current;
+    }
+}
+
+/**
+ * Frees the blocks kept for reuse back to the system. This is called with the
+ * mutex held.
+ */
+static void
+lv_libssh2_memory_release(
+    lv_libssh2_memory_t* handle
+) {
+    for (size_t class_index = 0; class_index < CLASS_COUNT; class_index++) {
+        void* block = handle->free_lists[class_index];
+        while (block != NULL) {
+            void* next = *(void**)((lv_libssh2_memory_header_t*)block + 1);
+            free(block);
+            block = next;
+        }
+        handle->free_lists[class_index] = NULL;
+    }
+    handle->current -= handle->retained;
+    handle->retained = 0;
+}
+
+/**
+ * Checks that `size` more bytes stay within the limit, first freeing the
+ * blocks kept for reuse if they would not. This is called with the mutex
+ * held.
+ */
+static bool
+lv_libssh2_memory_within_limit(
+    lv_libssh2_memory_t* handle,
+    const size_t size
+) {
+    if (handle->limit == 0 || handle->current + size <= handle->limit) {
+        return true;
+    }
+    if (handle->arena == NULL && handle->retained > 0) {
+        lv_libssh2_memory_release(handle);
+    }
+    return handle->current + size <= handle->limit;
+}
+
+/**
+ * Takes a block from the arena, reusing a freed block of at least the size
+ * for allocations too large for the pool, and returns NULL if the arena is
+ * exhausted. This is called with the mutex held.
+ */
+static lv_libssh2_memory_header_t*
+lv_libssh2_memory_carve(
+    lv_libssh2_memory_t* handle,
+    size_t size,
+    const size_t class_index
+) {
+    if (class_index == UNPOOLED) {
+        lv_libssh2_memory_header_t** link = &handle->large_blocks;
+        while (*link != NULL) {
+            lv_libssh2_memory_header_t* header = *link;
+            if (header->size >= size) {
+                *link = *(lv_libssh2_memory_header_t**)(header + 1);
+                handle->retained -= header->size;
+                return header;
+            }
+            link = (lv_libssh2_memory_header_t**)(header + 1);
+        }
+        size = (size + sizeof(lv_libssh2_memory_header_t) - 1) / sizeof(lv_libssh2_memory_header_t)
+            * sizeof(lv_libssh2_memory_header_t);
+    }
+    if (handle->arena_size - handle->arena_used < size || !lv_libssh2_memory_within_limit(handle, size)) {
+        return NULL;
+    }
+    lv_libssh2_memory_header_t* header = (lv_libssh2_memory_header_t*)(handle->arena + handle->arena_used);
+    handle->arena_used += size;
+    header->size = size;
+    header->class_index = class_index;
+    lv_libssh2_memory_add(handle, size);
+    return header;
+}
+
+lv_libssh2_status_t
+lv_libssh2_memory_create(
+    const bool pooled,
+    const size_t retain_limit,
+    const size_t arena_size,
+    const uint64_t limit,
+    lv_libssh2_memory_t** handle
+) {
+    *handle = NULL;
+    lv_libssh2_memory_t* memory = malloc(sizeof(lv_libssh2_memory_t));
+    if (memory == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    memory->arena = NULL;
+    if (arena_size > 0) {
+        memory->arena = malloc(arena_size);
+        if (memory->arena == NULL) {
+            free(memory);
+            return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+        }
+        // Touching every page now keeps page faults out of the later
+        // allocations.
+        memset(memory->arena, 0, arena_size);
+    }
+    lv_libssh2_mutex_init(&memory->mutex);
+    memory->pooled = pooled || arena_size > 0;
+    memory->retain_limit = retain_limit;
+    memory->retained = 0;
+    memset(memory->free_lists, 0, sizeof(memory->free_lists));
+    memory->arena_size = arena_size;
+    memory->arena_used = 0;
+    memory->large_blocks = NULL;
+    memory->limit = limit;
+    memory->current = 0;
+    memory->peak = 0;
+    *handle = memory;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+void
+lv_libssh2_memory_destroy(
+    lv_libssh2_memory_t* handle
+) {
+    if (handle->arena != NULL) {
+        free(handle->arena);
+        lv_libssh2_mutex_destroy(&handle->mutex);
+        free(handle);
+        return;
+    }
+    lv_libssh2_memory_release(handle);
+    lv_libssh2_mutex_destroy(&handle->mutex);
+    free(handle);
+}
+
+void
+lv_libssh2_memory_usage(
+    lv_libssh2_memory_t* handle,
+    uint64_t* current,
+    uint64_t* peak
+) {
+    lv_libssh2_mutex_lock(&handle->mutex);
+    *current = handle->current;
+    *peak = handle->peak;
+    lv_libssh2_mutex_unlock(&handle->mutex);
+}
+
+void*
+lv_libssh2_memory_alloc(
+    size_t count,
+    void** abstract
+) {
+    lv_libssh2_memory_t* memory = lv_libssh2_memory_of(abstract);
+    size_t size = count + sizeof(lv_libssh2_memory_header_t);
+    size_t class_index = memory->pooled ? lv_libssh2_memory_class(size) : UNPOOLED;
+    if (class_index != UNPOOLED) {
+        size = (size_t)1 << (class_index + MIN_CLASS_SHIFT);
+    }
+    lv_libssh2_memory_header_t* header = NULL;
+    lv_libssh2_mutex_lock(&memory->mutex);
+    if (class_index != UNPOOLED && memory->free_lists[class_index] != NULL) {
+        header = memory->free_lists[class_index];
+        memory->free_lists[class_index] = *(void**)(header + 1);
+        memory->retained -= size;
+        lv_libssh2_mutex_unlock(&memory->mutex);
+        return header + 1;
+    }
+    if (memory->arena != NULL) {
+        header = lv_libssh2_memory_carve(memory, size, class_index);
+        lv_libssh2_mutex_unlock(&memory->mutex);
+        return header == NULL ? NULL : header + 1;
+    }
+    if (!lv_libssh2_memory_within_limit(memory, size)) {
+        lv_libssh2_mutex_unlock(&memory->mutex);
+        return NULL;
+    }
+    lv_libssh2_memory_add(memory, size);
+    lv_libssh2_mutex_unlock(&memory->mutex);
+    header = malloc(size);
+    if (header == NULL) {
+        lv_libssh2_mutex_lock(&memory->mutex);
+        memory->current -= size;
+        lv_libssh2_mutex_unlock(&memory->mutex);
+        return NULL;
+    }
+    header->size = size;
+    header->class_index = class_index;
+    return header + 1;
+}
+
+void
+lv_libssh2_memory_free(
+    void* ptr,
+    void** abstract
+) {
+    if (ptr == NULL) {
+        return;
+    }
+    lv_libssh2_memory_t* memory = lv_libssh2_memory_of(abstract);
+    lv_libssh2_memory_header_t* header = (lv_libssh2_memory_header_t*)ptr - 1;
+    size_t size = header->size;
+    lv_libssh2_mutex_lock(&memory->mutex);
+    if (memory->arena != NULL) {
+        // Nothing goes back to the system, so every block is kept for reuse.
+        void** list = header->class_index == UNPOOLED
+            ? (void**)&memory->large_blocks
+            : &memory->free_lists[header->class_index];
+        *(void**)ptr = *list;
+        *list = header;
+        memory->retained += size;
+        lv_libssh2_mutex_unlock(&memory->mutex);
+        return;
+    }
+    if (header->class_index != UNPOOLED && memory->retained + size <= memory->retain_limit) {
+        *(void**)ptr = memory->free_lists[header->class_index];
+        memory->free_lists[header->class_index] = header;
+        memory->retained += size;
+        lv_libssh2_mutex_unlock(&memory->mutex);
+        return;
+    }
+    memory->current -= size;
+    lv_libssh2_mutex_unlock(&memory->mutex);
+    free(header);
+}
+
+void*
+lv_libssh2_memory_realloc(
+    void* ptr,
+    size_t count,
+    void** abstract
+) {
+    if (ptr == NULL) {
+        return lv_libssh2_memory_alloc(count, abstract);
+    }
+    lv_libssh2_memory_t* memory = lv_libssh2_memory_of(abstract);
+    lv_libssh2_memory_header_t* header = (lv_libssh2_memory_header_t*)ptr - 1;
+    size_t size = count + sizeof(lv_libssh2_memory_header_t);
+    if (size <= header->size && (header->class_index != UNPOOLED || size > header->size / 2)) {
+        return ptr;
+    }
+    if (header->class_index == UNPOOLED
+        && memory->arena == NULL
+        && (!memory->pooled || lv_libssh2_memory_class(size) == UNPOOLED)) {
+        size_t previous = header->size;
+        lv_libssh2_mutex_lock(&memory->mutex);
+        if (size > previous && !lv_libssh2_memory_within_limit(memory, size - previous)) {
+            lv_libssh2_mutex_unlock(&memory->mutex);
+            return NULL;
+        }
+        lv_libssh2_mutex_unlock(&memory->mutex);
+        lv_libssh2_memory_header_t* resized = realloc(header, size);
+        if (resized == NULL) {
+            return NULL;
+        }
+        resized->size = size;
+        lv_libssh2_mutex_lock(&memory->mutex);
+        memory->current -= previous;
+        lv_libssh2_memory_add(memory, size);
+        lv_libssh2_mutex_unlock(&memory->mutex);
+        return resized + 1;
+    }
+    void* moved = lv_libssh2_memory_alloc(count, abstract);
+    if (moved == NULL) {
+        return NULL;
+    }
+    size_t payload = header->size - sizeof(lv_libssh2_memory_header_t);
+    memcpy(moved, ptr, payload < count ? payload : count);
+    lv_libssh2_memory_free(ptr, abstract);
+    return moved;
+}
+
+void*
+lv_libssh2_memory_session_alloc(
+    lv_libssh2_session_t* session,
+    const size_t size
+) {
+    if (session->memory == NULL) {
+        return malloc(size);
+    }
+    void* abstract = session;
+    return lv_libssh2_memory_alloc(size, &abstract);
+}
+
+void*
+lv_libssh2_memory_session_realloc(
+    lv_libssh2_session_t* session,
+    void* ptr,
+    const size_t size
+) {
+    if (session->memory == NULL) {
+        return realloc(ptr, size);
+    }
+    void* abstract = session;
+    return lv_libssh2_memory_realloc(ptr, size, &abstract);
+}
+
+void
+lv_libssh2_memory_session_free(
+    lv_libssh2_session_t* session,
+    void* ptr
+) {
+    if (session->memory == NULL) {
+        free(ptr);
+        return;
+    }
+    void* abstract = session;
+    lv_libssh2_memory_free(ptr, &abstract);
+}
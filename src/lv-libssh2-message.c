@@ -0,0 +1,326 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-status-private.h"
+#include "lv-libssh2-channel-private.h"
+#include "lv-libssh2-memory-private.h"
+
+#define HEADER_SIZE 4
+#define READ_CHUNK_SIZE 16384
+#define MAX_MESSAGE_SIZE 0x1000000
+
+static void
+lv_libssh2_message_encode_header(
+    uint8_t* header,
+    const uint32_t len
+) {
+    header[0] = (uint8_t)(len >> 24);
+    header[1] = (uint8_t)(len >> 16);
+    header[2] = (uint8_t)(len >> 8);
+    header[3] = (uint8_t)len;
+}
+
+static uint32_t
+lv_libssh2_message_decode_header(
+    const uint8_t* header
+) {
+    return ((uint32_t)header[0] << 24)
+        | ((uint32_t)header[1] << 16)
+        | ((uint32_t)header[2] << 8)
+        | (uint32_t)header[3];
+}
+
+static lv_libssh2_status_t
+lv_libssh2_message_reserve(
+    lv_libssh2_channel_t* handle,
+    size_t len
+) {
+    if (handle->message_buffer_capacity - handle->message_buffer_len >= len) {
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    size_t capacity = handle->message_buffer_capacity == 0 ? READ_CHUNK_SIZE : handle->message_buffer_capacity;
+    while (capacity - handle->message_buffer_len < len) {
+        capacity *= 2;
+    }
+    uint8_t* buffer = lv_libssh2_memory_session_realloc(handle->session, handle->message_buffer, capacity);
+    if (buffer == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    handle->message_buffer = buffer;
+    handle->message_buffer_capacity = capacity;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+/**
+ * Gets the length of the message at the offset in the reassembly buffer.
+ *
+ * The `complete` flag is false if the header or the body has not been
+ * received yet.
+ */
+static lv_libssh2_status_t
+lv_libssh2_message_peek(
+    lv_libssh2_channel_t* handle,
+    const size_t offset,
+    uint32_t* len,
+    bool* complete
+) {
+    *complete = false;
+    size_t available = handle->message_buffer_len - offset;
+    if (available < HEADER_SIZE) {
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    *len = lv_libssh2_message_decode_header(handle->message_buffer + offset);
+    if (*len > MAX_MESSAGE_SIZE) {
+        return LV_LIBSSH2_STATUS_ERROR_INVALID_MESSAGE_LENGTH;
+    }
+    *complete = available - HEADER_SIZE >= *len;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+static lv_libssh2_status_t
+lv_libssh2_message_fill(
+    lv_libssh2_channel_t* handle,
+    const size_t needed
+) {
+    size_t reserve = needed > READ_CHUNK_SIZE ? needed : READ_CHUNK_SIZE;
+    lv_libssh2_status_t status = lv_libssh2_message_reserve(handle, reserve);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    size_t byte_count = 0;
+    status = lv_libssh2_channel_read(
+        handle,
+        (char*)(handle->message_buffer + handle->message_buffer_len),
+        handle->message_buffer_capacity - handle->message_buffer_len,
+        &byte_count
+    );
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    if (byte_count == 0 && lv_libssh2_channel_at_eof(handle)) {
+        return LV_LIBSSH2_STATUS_ERROR_CHANNEL_CLOSED;
+    }
+    handle->message_buffer_len += byte_count;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+/**
+ * Reads from the channel until the first message in the reassembly buffer is
+ * complete.
+ */
+static lv_libssh2_status_t
+lv_libssh2_message_wait(
+    lv_libssh2_channel_t* handle,
+    uint32_t* len
+) {
+    for (;;) {
+        bool complete = false;
+        lv_libssh2_status_t status = lv_libssh2_message_peek(handle, 0, len, &complete);
+        if (lv_libssh2_status_is_err(status)) {
+            return status;
+        }
+        if (complete) {
+            return LV_LIBSSH2_STATUS_OK;
+        }
+        size_t needed = 0;
+        if (handle->message_buffer_len >= HEADER_SIZE) {
+            needed = HEADER_SIZE + *len - handle->message_buffer_len;
+        }
+        status = lv_libssh2_message_fill(handle, needed);
+        if (lv_libssh2_status_is_err(status)) {
+            return status;
+        }
+    }
+}
+
+static void
+lv_libssh2_message_consume(
+    lv_libssh2_channel_t* handle,
+    const size_t len
+) {
+    memmove(
+        handle->message_buffer,
+        handle->message_buffer + len,
+        handle->message_buffer_len - len
+    );
+    handle->message_buffer_len -= len;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_send_message(
+    lv_libssh2_channel_t* handle,
+    const uint8_t* message,
+    const size_t message_len
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (message == NULL && message_len > 0) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (message_len > MAX_MESSAGE_SIZE) {
+        return LV_LIBSSH2_STATUS_ERROR_INVALID_MESSAGE_LENGTH;
+    }
+    uint8_t header[HEADER_SIZE];
+    lv_libssh2_message_encode_header(header, (uint32_t)message_len);
+    size_t total = HEADER_SIZE + message_len;
+    while (handle->message_sent < total) {
+        lv_libssh2_channel_segment_t segments[2];
+        size_t segment_count = 0;
+        if (handle->message_sent < HEADER_SIZE) {
+            segments[segment_count].data = (const char*)(header + handle->message_sent);
+            segments[segment_count].len = HEADER_SIZE - handle->message_sent;
+            segment_count++;
+            segments[segment_count].data = (const char*)message;
+            segments[segment_count].len = message_len;
+            segment_count++;
+        } else {
+            size_t offset = handle->message_sent - HEADER_SIZE;
+            segments[segment_count].data = (const char*)(message + offset);
+            segments[segment_count].len = message_len - offset;
+            segment_count++;
+        }
+        size_t byte_count = 0;
+        lv_libssh2_status_t status = lv_libssh2_channel_writev(
+            handle,
+            segments,
+            segment_count,
+            &byte_count
+        );
+        if (status == LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN) {
+            return status;
+        }
+        if (lv_libssh2_status_is_err(status)) {
+            handle->message_sent = 0;
+            return status;
+        }
+        handle->message_sent += byte_count;
+    }
+    handle->message_sent = 0;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_recv_message(
+    lv_libssh2_channel_t* handle,
+    uint8_t* buffer,
+    const size_t buffer_len,
+    size_t* message_len
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (buffer == NULL && buffer_len > 0) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (message_len == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    uint32_t len = 0;
+    lv_libssh2_status_t status = lv_libssh2_message_wait(handle, &len);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    *message_len = len;
+    if (len > buffer_len) {
+        return LV_LIBSSH2_STATUS_ERROR_BUFFER_TOO_SMALL;
+    }
+    if (len > 0) {
+        memcpy(buffer, handle->message_buffer + HEADER_SIZE, len);
+    }
+    lv_libssh2_message_consume(handle, HEADER_SIZE + len);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_channel_recv_messages(
+    lv_libssh2_channel_t* handle,
+    uint8_t* buffer,
+    const size_t buffer_len,
+    uint32_t* message_lens,
+    const size_t max_message_count,
+    size_t* message_count
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (buffer == NULL && buffer_len > 0) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (message_lens == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (message_count == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *message_count = 0;
+    if (max_message_count == 0) {
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    uint32_t len = 0;
+    lv_libssh2_status_t status = lv_libssh2_message_wait(handle, &len);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    if (len > buffer_len) {
+        message_lens[0] = len;
+        return LV_LIBSSH2_STATUS_ERROR_BUFFER_TOO_SMALL;
+    }
+    size_t offset = 0;
+    size_t written = 0;
+    size_t count = 0;
+    while (count < max_message_count) {
+        bool complete = false;
+        status = lv_libssh2_message_peek(handle, offset, &len, &complete);
+        if (lv_libssh2_status_is_err(status) || !complete || len > buffer_len - written) {
+            break;
+        }
+        if (len > 0) {
+            memcpy(buffer + written, handle->message_buffer + offset + HEADER_SIZE, len);
+        }
+        message_lens[count] = len;
+        written += len;
+        offset += HEADER_SIZE + len;
+        count++;
+    }
+    lv_libssh2_message_consume(handle, offset);
+    *message_count = count;
+    return LV_LIBSSH2_STATUS_OK;
+}
@@ -0,0 +1,122 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#ifndef LV_LIBSSH2_PROFILE_PRIVATE_H
+#define LV_LIBSSH2_PROFILE_PRIVATE_H
+
+#include <stdbool.h>
+
+#include "lv-libssh2.h"
+
+/**
+ * The transfers of one session since it connected, which are folded into the
+ * profile of its host when the session disconnects.
+ */
+typedef struct _lv_libssh2_profile_sample {
+    uint64_t bytes;
+    uint64_t busy_us;
+    uint64_t last_us;
+    uint64_t next_entropy_bytes;
+    double entropy_sum;
+    uint32_t entropy_count;
+} lv_libssh2_profile_sample_t;
+
+/**
+ * Adds a transfer of `len` payload bytes that started at `start_us` to the
+ * sample of the session. The entropy of the bytes is only estimated once
+ * every 256 KB, so this is cheap enough to call on every read and write. It
+ * is called with the session lock held, right after the libssh2 call, since
+ * the threads of a thread safe session share the sample.
+ */
+void
+lv_libssh2_profile_record(
+    lv_libssh2_session_t* session,
+    const void* data,
+    const size_t len,
+    const uint64_t start_us
+);
+
+/**
+ * Prefers the methods negotiated last time with the host of the session, and
+ * enables or disables compression if the session uses the learned compression
+ * policy. This must be called before the handshake.
+ */
+void
+lv_libssh2_profile_apply(
+    lv_libssh2_session_t* session
+);
+
+/**
+ * Records the host key, the negotiated methods, and the authentication method
+ * of a session that just authenticated as `username`, for the next session
+ * with the same host.
+ */
+void
+lv_libssh2_profile_authenticated(
+    lv_libssh2_session_t* session,
+    const char* username,
+    const char* method
+);
+
+/**
+ * Records the authentication methods the server listed for `username`.
+ */
+void
+lv_libssh2_profile_auth_listed(
+    lv_libssh2_session_t* session,
+    const char* username,
+    const char* list
+);
+
+/**
+ * Gets the authentication methods for `username` from the profile of the
+ * host, with the method that last succeeded first, or NULL if no method has
+ * succeeded yet. The caller frees the list.
+ */
+char*
+lv_libssh2_profile_auth_list(
+    lv_libssh2_session_t* session,
+    const char* username
+);
+
+/**
+ * Folds the sample of the session into the profile of its host and resets the
+ * sample. The session must still be connected, so the negotiated compression
+ * method can be read.
+ */
+void
+lv_libssh2_profile_commit(
+    lv_libssh2_session_t* session
+);
+
+#endif
@@ -0,0 +1,566 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-profile-private.h"
+#include "lv-libssh2-session-private.h"
+#include "lv-libssh2-thread-private.h"
+#include "lv-libssh2-time-private.h"
+
+// Transfers that start within this long of the end of the previous one are
+// part of the same burst, and the time between them counts as busy.
+#define IDLE_GAP_US 100000
+#define ENTROPY_INTERVAL (256 * 1024)
+#define ENTROPY_SAMPLE_LEN 4096
+// Sessions that moved less than this say more about latency than throughput.
+#define MIN_SAMPLE_BYTES (64 * 1024)
+// Data at or above this entropy in bits per byte, such as compressed files,
+// does not shrink enough to repay the CPU time.
+#define INCOMPRESSIBLE_ENTROPY 7.5
+#define SMOOTHING 0.25
+// Every so many connects, the mode that lost is tried again, so a host whose
+// link or data changed is learned again.
+#define EXPLORE_INTERVAL 16
+// The key exchange, host key, cipher, and MAC method types, which are the
+// first six libssh2 method types.
+#define METHOD_COUNT 6
+#define HOSTKEY_HASH_MAX_LEN 32
+
+#ifdef LIBSSH2_HOSTKEY_HASH_SHA256
+#define HOSTKEY_HASH_TYPE LIBSSH2_HOSTKEY_HASH_SHA256
+#define HOSTKEY_HASH_LEN 32
+#else
+#define HOSTKEY_HASH_TYPE LIBSSH2_HOSTKEY_HASH_SHA1
+#define HOSTKEY_HASH_LEN 20
+#endif
+
+typedef struct _lv_libssh2_profile {
+    char* host;
+    double entropy;
+    double rates[2];
+    uint32_t connects;
+    uint8_t hostkey_hash[HOSTKEY_HASH_MAX_LEN];
+    bool has_hostkey_hash;
+    char* methods[METHOD_COUNT];
+    char* auth_user;
+    char* auth_list;
+    char* auth_method;
+} lv_libssh2_profile_t;
+
+static lv_libssh2_mutex_t profile_mutex = LV_LIBSSH2_MUTEX_INITIALIZER;
+static lv_libssh2_profile_t* profiles = NULL;
+static size_t profile_count = 0;
+static size_t profile_capacity = 0;
+
+static char*
+lv_libssh2_profile_copy(
+    const char* value
+) {
+    char* copy = malloc(strlen(value) + 1);
+    if (copy != NULL) {
+        strcpy(copy, value);
+    }
+    return copy;
+}
+
+/**
+ * Replaces a string of a profile with a copy of the value, keeping the old
+ * string if the copy cannot be made.
+ */
+static void
+lv_libssh2_profile_set(
+    char** field,
+    const char* value
+) {
+    char* copy = lv_libssh2_profile_copy(value);
+    if (copy != NULL) {
+        free(*field);
+        *field = copy;
+    }
+}
+
+static lv_libssh2_profile_t*
+lv_libssh2_profile_find(
+    const char* host
+) {
+    for (size_t i = 0; i < profile_count; i++) {
+        if (strcmp(profiles[i].host, host) == 0) {
+            return &profiles[i];
+        }
+    }
+    return NULL;
+}
+
+static lv_libssh2_profile_t*
+lv_libssh2_profile_find_or_add(
+    const char* host
+) {
+    lv_libssh2_profile_t* profile = lv_libssh2_profile_find(host);
+    if (profile != NULL) {
+        return profile;
+    }
+    if (profile_count == profile_capacity) {
+        size_t capacity = profile_capacity == 0 ? 8 : profile_capacity * 2;
+        lv_libssh2_profile_t* resized = realloc(profiles, capacity * sizeof(lv_libssh2_profile_t));
+        if (resized == NULL) {
+            return NULL;
+        }
+        profiles = resized;
+        profile_capacity = capacity;
+    }
+    char* copy = lv_libssh2_profile_copy(host);
+    if (copy == NULL) {
+        return NULL;
+    }
+    profile = &profiles[profile_count++];
+    memset(profile, 0, sizeof(lv_libssh2_profile_t));
+    profile->host = copy;
+    profile->entropy = -1.0;
+    return profile;
+}
+
+static double
+lv_libssh2_profile_smooth(
+    const double average,
+    const double value
+) {
+    if (average <= 0.0) {
+        return value;
+    }
+    return average + SMOOTHING * (value - average);
+}
+
+/**
+ * Estimates the Shannon entropy of the bytes in bits per byte, which is a
+ * cheap stand-in for how well they would compress.
+ */
+static double
+lv_libssh2_profile_entropy(
+    const uint8_t* data,
+    const size_t len
+) {
+    uint32_t counts[256] = { 0 };
+    for (size_t i = 0; i < len; i++) {
+        counts[data[i]]++;
+    }
+    double sum = 0.0;
+    for (size_t i = 0; i < 256; i++) {
+        if (counts[i] > 0) {
+            sum += counts[i] * log2((double)counts[i]);
+        }
+    }
+    return log2((double)len) - sum / (double)len;
+}
+
+void
+lv_libssh2_profile_record(
+    lv_libssh2_session_t* session,
+    const void* data,
+    const size_t len,
+    const uint64_t start_us
+) {
+    if (session->host == NULL || len == 0) {
+        return;
+    }
+    lv_libssh2_profile_sample_t* sample = &session->profile_sample;
+    uint64_t now = lv_libssh2_time_now_us();
+    uint64_t from = start_us;
+    if (sample->last_us != 0 && start_us < sample->last_us + IDLE_GAP_US) {
+        from = sample->last_us;
+    }
+    sample->busy_us += now > from ? now - from : 0;
+    sample->last_us = now;
+    sample->bytes += len;
+    if (sample->bytes >= sample->next_entropy_bytes) {
+        size_t sample_len = len < ENTROPY_SAMPLE_LEN ? len : ENTROPY_SAMPLE_LEN;
+        sample->entropy_sum += lv_libssh2_profile_entropy(data, sample_len);
+        sample->entropy_count++;
+        sample->next_entropy_bytes = sample->bytes + ENTROPY_INTERVAL;
+    }
+}
+
+/**
+ * Builds a preference string with the method first, followed by every other
+ * method libssh2 supports in its default order, so a server that no longer
+ * offers the method can still be connected.
+ */
+static char*
+lv_libssh2_profile_method_pref(
+    LIBSSH2_SESSION* session,
+    const int method_type,
+    const char* method
+) {
+    const char** algs = NULL;
+    int count = libssh2_session_supported_algs(session, method_type, &algs);
+    if (count < 0) {
+        return NULL;
+    }
+    size_t len = strlen(method) + 1;
+    for (int i = 0; i < count; i++) {
+        len += strlen(algs[i]) + 1;
+    }
+    char* pref = malloc(len);
+    if (pref != NULL) {
+        strcpy(pref, method);
+        for (int i = 0; i < count; i++) {
+            if (strcmp(algs[i], method) != 0) {
+                strcat(pref, ",");
+                strcat(pref, algs[i]);
+            }
+        }
+    }
+    if (algs != NULL) {
+        libssh2_free(session, algs);
+    }
+    return pref;
+}
+
+/**
+ * Puts the methods negotiated by the last authenticated session with the host
+ * first, for the method types the caller has not set preferences for.
+ */
+static void
+lv_libssh2_profile_apply_methods(
+    lv_libssh2_session_t* session
+) {
+    char* methods[METHOD_COUNT] = { NULL };
+    lv_libssh2_mutex_lock(&profile_mutex);
+    lv_libssh2_profile_t* profile = lv_libssh2_profile_find(session->host);
+    for (int i = 0; profile != NULL && i < METHOD_COUNT; i++) {
+        if (profile->methods[i] != NULL && (session->method_prefs & (1u << i)) == 0) {
+            methods[i] = lv_libssh2_profile_copy(profile->methods[i]);
+        }
+    }
+    lv_libssh2_mutex_unlock(&profile_mutex);
+    for (int i = 0; i < METHOD_COUNT; i++) {
+        if (methods[i] == NULL) {
+            continue;
+        }
+        lv_libssh2_session_lock(session);
+        char* pref = lv_libssh2_profile_method_pref(session->inner, i, methods[i]);
+        if (pref != NULL) {
+            libssh2_session_method_pref(session->inner, i, pref);
+        }
+        lv_libssh2_session_unlock(session);
+        free(pref);
+        free(methods[i]);
+    }
+}
+
+/**
+ * Enables or disables compression from the profile of the host, if the
+ * session uses the learned compression policy.
+ */
+static void
+lv_libssh2_profile_apply_compression(
+    lv_libssh2_session_t* session
+) {
+    if (session->compression_policy != LV_LIBSSH2_COMPRESSION_POLICY_LEARNED) {
+        return;
+    }
+    bool known = false;
+    bool compress = false;
+    lv_libssh2_mutex_lock(&profile_mutex);
+    lv_libssh2_profile_t* profile = lv_libssh2_profile_find(session->host);
+    if (profile != NULL && profile->entropy >= 0.0) {
+        known = true;
+        profile->connects++;
+        if (profile->entropy >= INCOMPRESSIBLE_ENTROPY) {
+            compress = false;
+        } else if (profile->rates[1] == 0.0) {
+            compress = true;
+        } else if (profile->rates[0] == 0.0) {
+            compress = false;
+        } else {
+            compress = profile->rates[1] > profile->rates[0];
+            if (profile->connects % EXPLORE_INTERVAL == 0) {
+                compress = !compress;
+            }
+        }
+    }
+    lv_libssh2_mutex_unlock(&profile_mutex);
+    if (!known) {
+        return;
+    }
+    if (compress) {
+        lv_libssh2_session_enable_option(session, LV_LIBSSH2_SESSION_OPTIONS_COMPRESS);
+    } else {
+        lv_libssh2_session_disable_option(session, LV_LIBSSH2_SESSION_OPTIONS_COMPRESS);
+    }
+}
+
+void
+lv_libssh2_profile_apply(
+    lv_libssh2_session_t* session
+) {
+    if (session->host == NULL) {
+        return;
+    }
+    lv_libssh2_profile_apply_methods(session);
+    lv_libssh2_profile_apply_compression(session);
+}
+
+void
+lv_libssh2_profile_authenticated(
+    lv_libssh2_session_t* session,
+    const char* username,
+    const char* method
+) {
+    if (session->host == NULL) {
+        return;
+    }
+    const char* methods[METHOD_COUNT] = { NULL };
+    lv_libssh2_session_lock(session);
+    const char* hash = libssh2_hostkey_hash(session->inner, HOSTKEY_HASH_TYPE);
+    for (int i = 0; i < METHOD_COUNT; i++) {
+        methods[i] = libssh2_session_methods(session->inner, i);
+    }
+    lv_libssh2_mutex_lock(&profile_mutex);
+    lv_libssh2_profile_t* profile = lv_libssh2_profile_find_or_add(session->host);
+    if (profile != NULL) {
+        if (hash != NULL) {
+            memcpy(profile->hostkey_hash, hash, HOSTKEY_HASH_LEN);
+            profile->has_hostkey_hash = true;
+        }
+        for (int i = 0; i < METHOD_COUNT; i++) {
+            if (methods[i] != NULL) {
+                lv_libssh2_profile_set(&profile->methods[i], methods[i]);
+            }
+        }
+        if (profile->auth_user == NULL || strcmp(profile->auth_user, username) != 0) {
+            free(profile->auth_list);
+            profile->auth_list = NULL;
+            lv_libssh2_profile_set(&profile->auth_user, username);
+        }
+        lv_libssh2_profile_set(&profile->auth_method, method);
+    }
+    lv_libssh2_mutex_unlock(&profile_mutex);
+    lv_libssh2_session_unlock(session);
+}
+
+void
+lv_libssh2_profile_auth_listed(
+    lv_libssh2_session_t* session,
+    const char* username,
+    const char* list
+) {
+    if (session->host == NULL) {
+        return;
+    }
+    lv_libssh2_mutex_lock(&profile_mutex);
+    lv_libssh2_profile_t* profile = lv_libssh2_profile_find_or_add(session->host);
+    if (profile != NULL) {
+        if (profile->auth_user == NULL || strcmp(profile->auth_user, username) != 0) {
+            free(profile->auth_method);
+            profile->auth_method = NULL;
+            lv_libssh2_profile_set(&profile->auth_user, username);
+        }
+        lv_libssh2_profile_set(&profile->auth_list, list);
+    }
+    lv_libssh2_mutex_unlock(&profile_mutex);
+}
+
+char*
+lv_libssh2_profile_auth_list(
+    lv_libssh2_session_t* session,
+    const char* username
+) {
+    if (session->host == NULL) {
+        return NULL;
+    }
+    char* list = NULL;
+    lv_libssh2_mutex_lock(&profile_mutex);
+    lv_libssh2_profile_t* profile = lv_libssh2_profile_find(session->host);
+    if (profile != NULL
+        && profile->auth_method != NULL
+        && profile->auth_user != NULL
+        && strcmp(profile->auth_user, username) == 0) {
+        const char* others = profile->auth_list == NULL ? "" : profile->auth_list;
+        size_t method_len = strlen(profile->auth_method);
+        list = malloc(method_len + strlen(others) + 2);
+        if (list != NULL) {
+            strcpy(list, profile->auth_method);
+            // Copy the rest of the list as it was, without the method that
+            // moved to the front.
+            const char* cursor = others;
+            while (*cursor != '\0') {
+                const char* end = strchr(cursor, ',');
+                size_t len = end == NULL ? strlen(cursor) : (size_t)(end - cursor);
+                if (len > 0 && (len != method_len || strncmp(cursor, profile->auth_method, len) != 0)) {
+                    strcat(list, ",");
+                    strncat(list, cursor, len);
+                }
+                cursor += end == NULL ? len : len + 1;
+            }
+        }
+    }
+    lv_libssh2_mutex_unlock(&profile_mutex);
+    return list;
+}
+
+void
+lv_libssh2_profile_commit(
+    lv_libssh2_session_t* session
+) {
+    lv_libssh2_profile_sample_t sample = session->profile_sample;
+    memset(&session->profile_sample, 0, sizeof(lv_libssh2_profile_sample_t));
+    if (session->host == NULL || sample.bytes < MIN_SAMPLE_BYTES || sample.busy_us == 0) {
+        return;
+    }
+    // The server can refuse compression, so the negotiated methods decide
+    // which mode the sample measured, not the option that was asked for.
+    lv_libssh2_session_lock(session);
+    const char* outbound = libssh2_session_methods(session->inner, LIBSSH2_METHOD_COMP_CS);
+    const char* inbound = libssh2_session_methods(session->inner, LIBSSH2_METHOD_COMP_SC);
+    bool compressed = (outbound != NULL && strcmp(outbound, "none") != 0)
+        || (inbound != NULL && strcmp(inbound, "none") != 0);
+    lv_libssh2_session_unlock(session);
+    if (outbound == NULL || inbound == NULL) {
+        return;
+    }
+    double rate = (double)sample.bytes * 1000000.0 / (double)sample.busy_us;
+    double entropy = sample.entropy_sum / (double)sample.entropy_count;
+    lv_libssh2_mutex_lock(&profile_mutex);
+    lv_libssh2_profile_t* profile = lv_libssh2_profile_find_or_add(session->host);
+    if (profile != NULL) {
+        profile->rates[compressed] = lv_libssh2_profile_smooth(profile->rates[compressed], rate);
+        profile->entropy = profile->entropy < 0.0 ? entropy : lv_libssh2_profile_smooth(profile->entropy, entropy);
+    }
+    lv_libssh2_mutex_unlock(&profile_mutex);
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_set_host(
+    lv_libssh2_session_t* handle,
+    const char* host,
+    const uint16_t port
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (host == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    size_t len = strlen(host) + sizeof(":65535");
+    char* key = malloc(len);
+    if (key == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    snprintf(key, len, "%s:%u", host, (unsigned int)port);
+    free(handle->host);
+    handle->host = key;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_set_compression_policy(
+    lv_libssh2_session_t* handle,
+    const lv_libssh2_compression_policies_t policy
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    switch (policy) {
+        case LV_LIBSSH2_COMPRESSION_POLICY_MANUAL:
+        case LV_LIBSSH2_COMPRESSION_POLICY_LEARNED:
+            handle->compression_policy = policy;
+            return LV_LIBSSH2_STATUS_OK;
+        default:
+            return LV_LIBSSH2_STATUS_ERROR_UNKNOWN_COMPRESSION_POLICY;
+    }
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_hostkey_check_profile(
+    lv_libssh2_session_t* handle,
+    lv_libssh2_knownhosts_check_results_t* result
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (result == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_session_lock(handle);
+    const char* hash = libssh2_hostkey_hash(handle->inner, HOSTKEY_HASH_TYPE);
+    uint8_t actual[HOSTKEY_HASH_MAX_LEN];
+    if (hash != NULL) {
+        memcpy(actual, hash, HOSTKEY_HASH_LEN);
+    }
+    lv_libssh2_session_unlock(handle);
+    if (hash == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_SESSION_NOT_STARTED;
+    }
+    *result = LV_LIBSSH2_KNOWNHOSTS_CHECK_RESULT_NOT_FOUND;
+    if (handle->host == NULL) {
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    lv_libssh2_mutex_lock(&profile_mutex);
+    lv_libssh2_profile_t* profile = lv_libssh2_profile_find(handle->host);
+    if (profile != NULL && profile->has_hostkey_hash) {
+        *result = memcmp(profile->hostkey_hash, actual, HOSTKEY_HASH_LEN) == 0
+            ? LV_LIBSSH2_KNOWNHOSTS_CHECK_RESULT_MATCH
+            : LV_LIBSSH2_KNOWNHOSTS_CHECK_RESULT_MISMATCH;
+    }
+    lv_libssh2_mutex_unlock(&profile_mutex);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_profile_clear()
+{
+    lv_libssh2_mutex_lock(&profile_mutex);
+    for (size_t i = 0; i < profile_count; i++) {
+        free(profiles[i].host);
+        for (int j = 0; j < METHOD_COUNT; j++) {
+            free(profiles[i].methods[j]);
+        }
+        free(profiles[i].auth_user);
+        free(profiles[i].auth_list);
+        free(profiles[i].auth_method);
+    }
+    free(profiles);
+    profiles = NULL;
+    profile_count = 0;
+    profile_capacity = 0;
+    lv_libssh2_mutex_unlock(&profile_mutex);
+    return LV_LIBSSH2_STATUS_OK;
+}
@@ -0,0 +1,77 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#ifndef LV_LIBSSH2_REACTOR_PRIVATE_H
+#define LV_LIBSSH2_REACTOR_PRIVATE_H
+
+#include <stdbool.h>
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-exec-private.h"
+#include "lv-libssh2-thread-private.h"
+
+typedef struct _lv_libssh2_reactor_shard lv_libssh2_reactor_shard_t;
+
+struct _lv_libssh2_reactor_job {
+    lv_libssh2_reactor_t* reactor;
+    lv_libssh2_exec_t exec;
+    lv_libssh2_exec_input_t input;
+    char* command;
+    uint8_t* input_data;
+    uint64_t deadline_us;
+    int blocking;
+    short events;
+    bool registered;
+    bool ready;
+    bool done;
+    bool detached;
+    lv_libssh2_status_t status;
+    lv_libssh2_reactor_job_t* next;
+    lv_libssh2_reactor_job_t* job_prev;
+    lv_libssh2_reactor_job_t* job_next;
+    lv_libssh2_reactor_job_t* completed_prev;
+    lv_libssh2_reactor_job_t* completed_next;
+    bool completed_queued;
+};
+
+struct _lv_libssh2_reactor {
+    lv_libssh2_reactor_shard_t** shards;
+    uint32_t shard_count;
+    lv_libssh2_mutex_t mutex;
+    lv_libssh2_cond_t cond;
+    lv_libssh2_reactor_job_t* jobs;
+    lv_libssh2_reactor_job_t* completed_head;
+    lv_libssh2_reactor_job_t* completed_tail;
+};
+
+#endif
@@ -0,0 +1,846 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#elif defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define LV_LIBSSH2_REACTOR_EPOLL
+#else
+#include <sys/socket.h>
+#endif
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-status-private.h"
+#include "lv-libssh2-session-private.h"
+#include "lv-libssh2-channel-private.h"
+#include "lv-libssh2-exec-private.h"
+#include "lv-libssh2-reactor-private.h"
+#include "lv-libssh2-socket-private.h"
+#include "lv-libssh2-thread-private.h"
+#include "lv-libssh2-time-private.h"
+
+#define MAX_SHARDS 64
+#define MAX_WAIT_MS 1000
+#define INITIAL_CAPACITY 64
+
+/**
+ * One worker thread and the sessions assigned to it. Everything below the
+ * mutex-protected submission queue is only touched by the worker thread.
+ */
+struct _lv_libssh2_reactor_shard {
+    lv_libssh2_reactor_t* reactor;
+    lv_libssh2_thread_t thread;
+    bool started;
+    lv_libssh2_mutex_t mutex;
+    bool stopping;
+    bool wake_pending;
+    lv_libssh2_reactor_job_t* submitted_head;
+    lv_libssh2_reactor_job_t* submitted_tail;
+    libssh2_socket_t wake[2];
+    lv_libssh2_reactor_job_t* waiting_head;
+    lv_libssh2_reactor_job_t* waiting_tail;
+    lv_libssh2_reactor_job_t** active;
+    size_t active_count;
+    size_t active_capacity;
+#ifdef LV_LIBSSH2_REACTOR_EPOLL
+    int epoll_fd;
+    struct epoll_event* events;
+#else
+    lv_libssh2_pollfd_t* poll_fds;
+#endif
+    size_t events_capacity;
+};
+
+static void
+lv_libssh2_reactor_job_free(
+    lv_libssh2_reactor_job_t* job
+) {
+    lv_libssh2_exec_abort(&job->exec);
+    free(job->command);
+    free(job->input_data);
+    free(job);
+}
+
+/**
+ * Records the outcome of a job and hands it to the caller through the
+ * completion queue, or frees it if the caller has already destroyed it.
+ */
+static void
+lv_libssh2_reactor_finish(
+    lv_libssh2_reactor_job_t* job,
+    const lv_libssh2_status_t status
+) {
+    lv_libssh2_reactor_t* reactor = job->reactor;
+    lv_libssh2_mutex_lock(&reactor->mutex);
+    job->status = status;
+    job->done = true;
+    if (job->detached) {
+        lv_libssh2_mutex_unlock(&reactor->mutex);
+        lv_libssh2_reactor_job_free(job);
+        return;
+    }
+    job->completed_prev = reactor->completed_tail;
+    job->completed_next = NULL;
+    if (reactor->completed_tail != NULL) {
+        reactor->completed_tail->completed_next = job;
+    } else {
+        reactor->completed_head = job;
+    }
+    reactor->completed_tail = job;
+    job->completed_queued = true;
+    lv_libssh2_cond_broadcast(&reactor->cond);
+    lv_libssh2_mutex_unlock(&reactor->mutex);
+}
+
+static void
+lv_libssh2_reactor_completed_remove(
+    lv_libssh2_reactor_t* reactor,
+    lv_libssh2_reactor_job_t* job
+) {
+    if (!job->completed_queued) {
+        return;
+    }
+    if (job->completed_prev != NULL) {
+        job->completed_prev->completed_next = job->completed_next;
+    } else {
+        reactor->completed_head = job->completed_next;
+    }
+    if (job->completed_next != NULL) {
+        job->completed_next->completed_prev = job->completed_prev;
+    } else {
+        reactor->completed_tail = job->completed_prev;
+    }
+    job->completed_prev = NULL;
+    job->completed_next = NULL;
+    job->completed_queued = false;
+}
+
+static void
+lv_libssh2_reactor_shard_wake(
+    lv_libssh2_reactor_shard_t* shard
+) {
+    char byte = 0;
+    send(shard->wake[1], &byte, 1, 0);
+}
+
+static void
+lv_libssh2_reactor_shard_drain_wake(
+    lv_libssh2_reactor_shard_t* shard
+) {
+    char buffer[64];
+    while (recv(shard->wake[0], buffer, sizeof(buffer), 0) > 0) {
+    }
+}
+
+/**
+ * Updates the socket readiness the job waits for from the directions libssh2
+ * is blocked on.
+ */
+static void
+lv_libssh2_reactor_shard_arm(
+    lv_libssh2_reactor_shard_t* shard,
+    lv_libssh2_reactor_job_t* job
+) {
+    lv_libssh2_session_t* session = job->exec.session;
+    lv_libssh2_session_lock(session);
+    int directions = libssh2_session_block_directions(session->inner);
+    lv_libssh2_session_unlock(session);
+    if (directions == 0) {
+        directions = LIBSSH2_SESSION_BLOCK_INBOUND;
+    }
+#ifdef LV_LIBSSH2_REACTOR_EPOLL
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = 0;
+    if (directions & LIBSSH2_SESSION_BLOCK_INBOUND) {
+        event.events |= EPOLLIN;
+    }
+    if (directions & LIBSSH2_SESSION_BLOCK_OUTBOUND) {
+        event.events |= EPOLLOUT;
+    }
+    event.data.ptr = job;
+    if (job->registered) {
+        epoll_ctl(shard->epoll_fd, EPOLL_CTL_MOD, session->socket, &event);
+    } else if (epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, session->socket, &event) == 0) {
+        job->registered = true;
+    }
+#else
+    (void)shard;
+    job->events = 0;
+    if (directions & LIBSSH2_SESSION_BLOCK_INBOUND) {
+        job->events |= POLLIN;
+    }
+    if (directions & LIBSSH2_SESSION_BLOCK_OUTBOUND) {
+        job->events |= POLLOUT;
+    }
+    job->registered = true;
+#endif
+}
+
+/**
+ * Removes the job at the index from the active set, restores the session
+ * mode, and finishes the job. Waiting jobs on the same session can start
+ * afterwards.
+ */
+static void
+lv_libssh2_reactor_shard_complete(
+    lv_libssh2_reactor_shard_t* shard,
+    const size_t index,
+    const lv_libssh2_status_t status
+) {
+    lv_libssh2_reactor_job_t* job = shard->active[index];
+    shard->active[index] = shard->active[--shard->active_count];
+    lv_libssh2_session_t* session = job->exec.session;
+#ifdef LV_LIBSSH2_REACTOR_EPOLL
+    if (job->registered) {
+        epoll_ctl(shard->epoll_fd, EPOLL_CTL_DEL, session->socket, NULL);
+    }
+#endif
+    job->registered = false;
+    lv_libssh2_session_lock(session);
+    lv_libssh2_session_end_nonblocking(session, job->blocking);
+    lv_libssh2_session_unlock(session);
+    session->reactor_active = false;
+    if (lv_libssh2_status_is_err(status)) {
+        lv_libssh2_exec_abort(&job->exec);
+    }
+    lv_libssh2_reactor_finish(job, status);
+}
+
+/**
+ * Starts waiting jobs whose sessions are idle, in submission order, and fails
+ * waiting jobs whose deadline has passed. A session only runs one job at a
+ * time, since libssh2 only allows one channel open in progress per session.
+ */
+static lv_libssh2_status_t
+lv_libssh2_reactor_shard_activate(
+    lv_libssh2_reactor_shard_t* shard,
+    const uint64_t now
+) {
+    lv_libssh2_reactor_job_t* previous = NULL;
+    lv_libssh2_reactor_job_t* job = shard->waiting_head;
+    while (job != NULL) {
+        lv_libssh2_reactor_job_t* next = job->next;
+        lv_libssh2_session_t* session = job->exec.session;
+        bool expired = job->deadline_us <= now;
+        if (!expired && session->reactor_active) {
+            previous = job;
+            job = next;
+            continue;
+        }
+        if (!expired && shard->active_count == shard->active_capacity) {
+            size_t capacity = shard->active_capacity == 0 ? INITIAL_CAPACITY : shard->active_capacity * 2;
+            lv_libssh2_reactor_job_t** active = realloc(shard->active, capacity * sizeof(lv_libssh2_reactor_job_t*));
+            if (active == NULL) {
+                return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+            }
+            shard->active = active;
+            shard->active_capacity = capacity;
+        }
+        if (previous != NULL) {
+            previous->next = next;
+        } else {
+            shard->waiting_head = next;
+        }
+        if (shard->waiting_tail == job) {
+            shard->waiting_tail = previous;
+        }
+        job->next = NULL;
+        if (expired) {
+            lv_libssh2_reactor_finish(job, LV_LIBSSH2_STATUS_ERROR_TIMEOUT);
+        } else {
+            session->reactor_active = true;
+            lv_libssh2_session_lock(session);
+            job->blocking = lv_libssh2_session_begin_nonblocking(session);
+            lv_libssh2_session_unlock(session);
+            job->ready = true;
+            shard->active[shard->active_count++] = job;
+        }
+        job = next;
+    }
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+/**
+ * Steps every active job whose socket is ready and times out the ones whose
+ * deadline has passed. Returns `true` if any job completed, since that may
+ * let a waiting job start.
+ */
+static bool
+lv_libssh2_reactor_shard_step(
+    lv_libssh2_reactor_shard_t* shard,
+    const uint64_t now
+) {
+    bool completed = false;
+    size_t i = 0;
+    while (i < shard->active_count) {
+        lv_libssh2_reactor_job_t* job = shard->active[i];
+        lv_libssh2_status_t status = LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN;
+        bool stepped = job->ready;
+        if (stepped) {
+            job->ready = false;
+            status = lv_libssh2_exec_step(&job->exec);
+        }
+        if (status == LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN && job->deadline_us <= now) {
+            status = LV_LIBSSH2_STATUS_ERROR_TIMEOUT;
+        }
+        if (status == LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN) {
+            if (stepped) {
+                lv_libssh2_reactor_shard_arm(shard, job);
+            }
+            i++;
+        } else {
+            lv_libssh2_reactor_shard_complete(shard, i, status);
+            completed = true;
+        }
+    }
+    return completed;
+}
+
+static bool
+lv_libssh2_reactor_shard_reserve_events(
+    lv_libssh2_reactor_shard_t* shard
+) {
+    size_t needed = shard->active_count + 1;
+    if (needed <= shard->events_capacity) {
+        return true;
+    }
+    size_t capacity = shard->events_capacity == 0 ? INITIAL_CAPACITY : shard->events_capacity;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+#ifdef LV_LIBSSH2_REACTOR_EPOLL
+    struct epoll_event* events = realloc(shard->events, capacity * sizeof(struct epoll_event));
+    if (events == NULL) {
+        return false;
+    }
+    shard->events = events;
+#else
+    lv_libssh2_pollfd_t* poll_fds = realloc(shard->poll_fds, capacity * sizeof(lv_libssh2_pollfd_t));
+    if (poll_fds == NULL) {
+        return false;
+    }
+    shard->poll_fds = poll_fds;
+#endif
+    shard->events_capacity = capacity;
+    return true;
+}
+
+/**
+ * Waits until a socket of an active job is ready, a job is submitted, or the
+ * deadline passes, and marks the ready jobs.
+ *
+ * The wait is capped so that every job is stepped at least once a second,
+ * because another thread holding the session lock, such as the keepalive
+ * scheduler, may have read the packet a job was waiting for.
+ */
+static void
+lv_libssh2_reactor_shard_wait(
+    lv_libssh2_reactor_shard_t* shard,
+    const uint64_t deadline_us
+) {
+    int timeout_ms = MAX_WAIT_MS;
+    if (deadline_us != LV_LIBSSH2_TIME_NO_DEADLINE) {
+        uint64_t now = lv_libssh2_time_now_us();
+        uint64_t remaining_ms = deadline_us > now ? (deadline_us - now + 999) / 1000 : 0;
+        if (remaining_ms < (uint64_t)timeout_ms) {
+            timeout_ms = (int)remaining_ms;
+        }
+    }
+    if (!lv_libssh2_reactor_shard_reserve_events(shard)) {
+        timeout_ms = timeout_ms < 10 ? timeout_ms : 10;
+    }
+    bool timed_out = true;
+#ifdef LV_LIBSSH2_REACTOR_EPOLL
+    int count = epoll_wait(shard->epoll_fd, shard->events, (int)shard->events_capacity, timeout_ms);
+    for (int i = 0; i < count; i++) {
+        lv_libssh2_reactor_job_t* job = shard->events[i].data.ptr;
+        if (job == NULL) {
+            lv_libssh2_reactor_shard_drain_wake(shard);
+        } else {
+            job->ready = true;
+        }
+        timed_out = false;
+    }
+#else
+    size_t count = 0;
+    if (shard->events_capacity > shard->active_count) {
+        shard->poll_fds[count].fd = shard->wake[0];
+        shard->poll_fds[count].events = POLLIN;
+        shard->poll_fds[count].revents = 0;
+        count++;
+        for (size_t i = 0; i < shard->active_count; i++) {
+            shard->poll_fds[count].fd = shard->active[i]->exec.session->socket;
+            shard->poll_fds[count].events = shard->active[i]->events;
+            shard->poll_fds[count].revents = 0;
+            count++;
+        }
+    }
+    int ready = count > 0 ? lv_libssh2_poll(shard->poll_fds, count, timeout_ms) : 0;
+    if (ready > 0) {
+        timed_out = false;
+        if (shard->poll_fds[0].revents != 0) {
+            lv_libssh2_reactor_shard_drain_wake(shard);
+        }
+        for (size_t i = 1; i < count; i++) {
+            if (shard->poll_fds[i].revents != 0) {
+                shard->active[i - 1]->ready = true;
+            }
+        }
+    }
+#endif
+    if (timed_out) {
+        for (size_t i = 0; i < shard->active_count; i++) {
+            shard->active[i]->ready = true;
+        }
+    }
+}
+
+static void
+lv_libssh2_reactor_shard_main(
+    void* arg
+) {
+    lv_libssh2_reactor_shard_t* shard = arg;
+    for (;;) {
+        lv_libssh2_mutex_lock(&shard->mutex);
+        lv_libssh2_reactor_job_t* submitted = shard->submitted_head;
+        lv_libssh2_reactor_job_t* submitted_tail = shard->submitted_tail;
+        shard->submitted_head = NULL;
+        shard->submitted_tail = NULL;
+        shard->wake_pending = false;
+        bool stopping = shard->stopping;
+        lv_libssh2_mutex_unlock(&shard->mutex);
+        if (submitted != NULL) {
+            if (shard->waiting_tail != NULL) {
+                shard->waiting_tail->next = submitted;
+            } else {
+                shard->waiting_head = submitted;
+            }
+            shard->waiting_tail = submitted_tail;
+        }
+        if (stopping) {
+            break;
+        }
+        bool completed = true;
+        while (completed) {
+            uint64_t now = lv_libssh2_time_now_us();
+            lv_libssh2_reactor_shard_activate(shard, now);
+            completed = lv_libssh2_reactor_shard_step(shard, now);
+        }
+        uint64_t deadline_us = LV_LIBSSH2_TIME_NO_DEADLINE;
+        for (size_t i = 0; i < shard->active_count; i++) {
+            if (shard->active[i]->deadline_us < deadline_us) {
+                deadline_us = shard->active[i]->deadline_us;
+            }
+        }
+        for (lv_libssh2_reactor_job_t* job = shard->waiting_head; job != NULL; job = job->next) {
+            if (job->deadline_us < deadline_us) {
+                deadline_us = job->deadline_us;
+            }
+        }
+        lv_libssh2_reactor_shard_wait(shard, deadline_us);
+    }
+    while (shard->active_count > 0) {
+        lv_libssh2_reactor_shard_complete(shard, shard->active_count - 1, LV_LIBSSH2_STATUS_ERROR_CANCELED);
+    }
+    while (shard->waiting_head != NULL) {
+        lv_libssh2_reactor_job_t* job = shard->waiting_head;
+        shard->waiting_head = job->next;
+        job->next = NULL;
+        lv_libssh2_reactor_finish(job, LV_LIBSSH2_STATUS_ERROR_CANCELED);
+    }
+    shard->waiting_tail = NULL;
+}
+
+static void
+lv_libssh2_reactor_shard_destroy(
+    lv_libssh2_reactor_shard_t* shard
+) {
+    if (shard->started) {
+        lv_libssh2_mutex_lock(&shard->mutex);
+        shard->stopping = true;
+        lv_libssh2_mutex_unlock(&shard->mutex);
+        lv_libssh2_reactor_shard_wake(shard);
+        lv_libssh2_thread_join(shard->thread);
+    }
+#ifdef LV_LIBSSH2_REACTOR_EPOLL
+    if (shard->epoll_fd >= 0) {
+        close(shard->epoll_fd);
+    }
+    free(shard->events);
+#else
+    free(shard->poll_fds);
+#endif
+    if (shard->wake[0] != LIBSSH2_INVALID_SOCKET) {
+        lv_libssh2_socket_close(shard->wake[0]);
+        lv_libssh2_socket_close(shard->wake[1]);
+    }
+    free(shard->active);
+    lv_libssh2_mutex_destroy(&shard->mutex);
+    free(shard);
+}
+
+static lv_libssh2_status_t
+lv_libssh2_reactor_shard_create(
+    lv_libssh2_reactor_t* reactor,
+    lv_libssh2_reactor_shard_t** handle
+) {
+    *handle = NULL;
+    lv_libssh2_reactor_shard_t* shard = malloc(sizeof(lv_libssh2_reactor_shard_t));
+    if (shard == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    memset(shard, 0, sizeof(lv_libssh2_reactor_shard_t));
+    shard->reactor = reactor;
+    shard->started = false;
+    lv_libssh2_mutex_init(&shard->mutex);
+    shard->wake[0] = LIBSSH2_INVALID_SOCKET;
+    shard->wake[1] = LIBSSH2_INVALID_SOCKET;
+#ifdef LV_LIBSSH2_REACTOR_EPOLL
+    shard->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (shard->epoll_fd < 0) {
+        lv_libssh2_reactor_shard_destroy(shard);
+        return LV_LIBSSH2_STATUS_ERROR_GENERIC;
+    }
+#endif
+    lv_libssh2_status_t status = lv_libssh2_socket_pair(shard->wake);
+    if (lv_libssh2_status_is_err(status)) {
+        lv_libssh2_reactor_shard_destroy(shard);
+        return status;
+    }
+    lv_libssh2_socket_set_nonblocking(shard->wake[0], true);
+    lv_libssh2_socket_set_nonblocking(shard->wake[1], true);
+#ifdef LV_LIBSSH2_REACTOR_EPOLL
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    if (epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, shard->wake[0], &event) != 0) {
+        lv_libssh2_reactor_shard_destroy(shard);
+        return LV_LIBSSH2_STATUS_ERROR_GENERIC;
+    }
+#endif
+    if (!lv_libssh2_reactor_shard_reserve_events(shard)) {
+        lv_libssh2_reactor_shard_destroy(shard);
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    if (!lv_libssh2_thread_start(&shard->thread, lv_libssh2_reactor_shard_main, shard)) {
+        lv_libssh2_reactor_shard_destroy(shard);
+        return LV_LIBSSH2_STATUS_ERROR_GENERIC;
+    }
+    shard->started = true;
+    *handle = shard;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+/**
+ * Picks the shard for a session. The choice only depends on the session, so
+ * all of its jobs run on the same thread.
+ */
+static lv_libssh2_reactor_shard_t*
+lv_libssh2_reactor_shard_for(
+    lv_libssh2_reactor_t* reactor,
+    lv_libssh2_session_t* session
+) {
+    uint64_t hash = (uint64_t)(uintptr_t)session * UINT64_C(11400714819323198485);
+    return reactor->shards[(hash >> 32) % reactor->shard_count];
+}
+
+lv_libssh2_status_t
+lv_libssh2_reactor_create(
+    const uint32_t thread_count,
+    lv_libssh2_reactor_t** handle
+) {
+    *handle = NULL;
+    uint32_t count = thread_count == 0 ? lv_libssh2_thread_processor_count() : thread_count;
+    if (count > MAX_SHARDS) {
+        count = MAX_SHARDS;
+    }
+    lv_libssh2_reactor_t* reactor = malloc(sizeof(lv_libssh2_reactor_t));
+    if (reactor == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    reactor->shards = calloc(count, sizeof(lv_libssh2_reactor_shard_t*));
+    if (reactor->shards == NULL) {
+        free(reactor);
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    reactor->shard_count = 0;
+    lv_libssh2_mutex_init(&reactor->mutex);
+    lv_libssh2_cond_init(&reactor->cond);
+    reactor->jobs = NULL;
+    reactor->completed_head = NULL;
+    reactor->completed_tail = NULL;
+    for (uint32_t i = 0; i < count; i++) {
+        lv_libssh2_status_t status = lv_libssh2_reactor_shard_create(reactor, &reactor->shards[i]);
+        if (lv_libssh2_status_is_err(status)) {
+            lv_libssh2_reactor_destroy(reactor);
+            return status;
+        }
+        reactor->shard_count++;
+    }
+    *handle = reactor;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_reactor_destroy(
+    lv_libssh2_reactor_t* handle
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    for (uint32_t i = 0; i < handle->shard_count; i++) {
+        lv_libssh2_reactor_shard_destroy(handle->shards[i]);
+    }
+    free(handle->shards);
+    handle->shards = NULL;
+    while (handle->jobs != NULL) {
+        lv_libssh2_reactor_job_t* job = handle->jobs;
+        handle->jobs = job->job_next;
+        lv_libssh2_reactor_job_free(job);
+    }
+    lv_libssh2_cond_destroy(&handle->cond);
+    lv_libssh2_mutex_destroy(&handle->mutex);
+    free(handle);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_reactor_exec(
+    lv_libssh2_reactor_t* handle,
+    lv_libssh2_session_t* session,
+    const char* command,
+    const size_t command_len,
+    const uint8_t* input,
+    const size_t input_len,
+    const size_t max_output_len,
+    const int32_t timeout_ms,
+    lv_libssh2_reactor_job_t** job
+) {
+    if (job == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *job = NULL;
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (session == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (command == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (input == NULL && input_len > 0) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (session->socket == LIBSSH2_INVALID_SOCKET) {
+        return LV_LIBSSH2_STATUS_ERROR_SOCKET_NONE;
+    }
+    lv_libssh2_reactor_job_t* submitted = malloc(sizeof(lv_libssh2_reactor_job_t));
+    if (submitted == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    memset(submitted, 0, sizeof(lv_libssh2_reactor_job_t));
+    submitted->command = malloc(command_len == 0 ? 1 : command_len);
+    submitted->input_data = malloc(input_len == 0 ? 1 : input_len);
+    if (submitted->command == NULL || submitted->input_data == NULL) {
+        free(submitted->command);
+        free(submitted->input_data);
+        free(submitted);
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    memcpy(submitted->command, command, command_len);
+    if (input_len > 0) {
+        memcpy(submitted->input_data, input, input_len);
+    }
+    submitted->reactor = handle;
+    submitted->input.data = submitted->input_data;
+    submitted->input.len = input_len;
+    submitted->input.offset = 0;
+    submitted->input.file = NULL;
+    submitted->input.chunk = NULL;
+    submitted->input.done = false;
+    lv_libssh2_exec_init(
+        &submitted->exec,
+        session,
+        submitted->command,
+        command_len,
+        &submitted->input,
+        max_output_len
+    );
+    submitted->deadline_us = lv_libssh2_time_deadline_us(timeout_ms);
+    submitted->status = LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN;
+    lv_libssh2_mutex_lock(&handle->mutex);
+    submitted->job_next = handle->jobs;
+    if (handle->jobs != NULL) {
+        handle->jobs->job_prev = submitted;
+    }
+    handle->jobs = submitted;
+    lv_libssh2_mutex_unlock(&handle->mutex);
+    lv_libssh2_reactor_shard_t* shard = lv_libssh2_reactor_shard_for(handle, session);
+    lv_libssh2_mutex_lock(&shard->mutex);
+    if (shard->submitted_tail != NULL) {
+        shard->submitted_tail->next = submitted;
+    } else {
+        shard->submitted_head = submitted;
+    }
+    shard->submitted_tail = submitted;
+    bool wake = !shard->wake_pending;
+    shard->wake_pending = true;
+    lv_libssh2_mutex_unlock(&shard->mutex);
+    if (wake) {
+        lv_libssh2_reactor_shard_wake(shard);
+    }
+    *job = submitted;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_reactor_wait(
+    lv_libssh2_reactor_t* handle,
+    const int32_t timeout_ms,
+    lv_libssh2_reactor_job_t** job
+) {
+    if (job == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *job = NULL;
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    uint64_t deadline = lv_libssh2_time_deadline_us(timeout_ms);
+    lv_libssh2_mutex_lock(&handle->mutex);
+    while (handle->completed_head == NULL && lv_libssh2_time_now_us() < deadline) {
+        lv_libssh2_cond_wait(&handle->cond, &handle->mutex, deadline);
+    }
+    lv_libssh2_reactor_job_t* completed = handle->completed_head;
+    if (completed != NULL) {
+        lv_libssh2_reactor_completed_remove(handle, completed);
+    }
+    lv_libssh2_mutex_unlock(&handle->mutex);
+    if (completed == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN;
+    }
+    *job = completed;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_reactor_job_wait(
+    lv_libssh2_reactor_job_t* handle,
+    const int32_t timeout_ms,
+    int32_t* exit_status,
+    lv_libssh2_channel_t** channel
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (exit_status == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (channel == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *channel = NULL;
+    lv_libssh2_reactor_t* reactor = handle->reactor;
+    uint64_t deadline = lv_libssh2_time_deadline_us(timeout_ms);
+    lv_libssh2_mutex_lock(&reactor->mutex);
+    while (!handle->done && lv_libssh2_time_now_us() < deadline) {
+        lv_libssh2_cond_wait(&reactor->cond, &reactor->mutex, deadline);
+    }
+    bool done = handle->done;
+    if (done) {
+        lv_libssh2_reactor_completed_remove(reactor, handle);
+    }
+    lv_libssh2_mutex_unlock(&reactor->mutex);
+    if (!done) {
+        return LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN;
+    }
+    if (handle->status == LV_LIBSSH2_STATUS_OK) {
+        *exit_status = handle->exec.exit_status;
+        *channel = handle->exec.channel;
+    }
+    return handle->status;
+}
+
+lv_libssh2_status_t
+lv_libssh2_reactor_job_session(
+    lv_libssh2_reactor_job_t* handle,
+    lv_libssh2_session_t** session
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (session == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *session = handle->exec.session;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_reactor_job_destroy(
+    lv_libssh2_reactor_job_t* handle
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_reactor_t* reactor = handle->reactor;
+    lv_libssh2_mutex_lock(&reactor->mutex);
+    if (handle->job_prev != NULL) {
+        handle->job_prev->job_next = handle->job_next;
+    } else {
+        reactor->jobs = handle->job_next;
+    }
+    if (handle->job_next != NULL) {
+        handle->job_next->job_prev = handle->job_prev;
+    }
+    lv_libssh2_reactor_completed_remove(reactor, handle);
+    bool done = handle->done;
+    handle->detached = !done;
+    lv_libssh2_mutex_unlock(&reactor->mutex);
+    if (done) {
+        lv_libssh2_reactor_job_free(handle);
+    }
+    return LV_LIBSSH2_STATUS_OK;
+}
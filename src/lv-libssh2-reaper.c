@@ -0,0 +1,240 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-keepalive-private.h"
+#include "lv-libssh2-profile-private.h"
+#include "lv-libssh2-reaper-private.h"
+#include "lv-libssh2-session-private.h"
+#include "lv-libssh2-socket-private.h"
+#include "lv-libssh2-thread-private.h"
+#include "lv-libssh2-time-private.h"
+
+#define DISCONNECT_TIMEOUT_US 1000000
+#define RETRY_INTERVAL_US 10000
+#define INITIAL_CAPACITY 16
+
+typedef struct _lv_libssh2_reaper_entry {
+    lv_libssh2_session_t* session;
+    char* description;
+    int blocking;
+    bool disconnecting;
+} lv_libssh2_reaper_entry_t;
+
+static lv_libssh2_mutex_t reaper_mutex = LV_LIBSSH2_MUTEX_INITIALIZER;
+static lv_libssh2_cond_t reaper_cond = LV_LIBSSH2_COND_INITIALIZER;
+static lv_libssh2_thread_t reaper_thread;
+static bool reaper_running = false;
+static bool reaper_stopping = false;
+static lv_libssh2_reaper_entry_t* reaper_entries = NULL;
+static size_t reaper_count = 0;
+static size_t reaper_capacity = 0;
+
+/**
+ * Tries to send the disconnect message of the entry without blocking, and
+ * returns `true` while it still has to be retried.
+ */
+static bool
+lv_libssh2_reaper_disconnect(
+    lv_libssh2_reaper_entry_t* entry
+) {
+    lv_libssh2_session_t* session = entry->session;
+    lv_libssh2_session_lock(session);
+    int result = libssh2_session_disconnect_ex(
+        session->inner,
+        SSH_DISCONNECT_BY_APPLICATION,
+        entry->description,
+        ""
+    );
+    lv_libssh2_session_unlock(session);
+    entry->disconnecting = result == LIBSSH2_ERROR_EAGAIN;
+    return entry->disconnecting;
+}
+
+/**
+ * Disconnects and destroys a batch of sessions. The disconnect messages are
+ * sent to all of them together, and the ones that cannot be sent at once are
+ * retried until the shared deadline, so a few unreachable peers cost at most
+ * one timeout for the batch rather than one each.
+ */
+static void
+lv_libssh2_reaper_destroy_batch(
+    lv_libssh2_reaper_entry_t* entries,
+    const size_t count
+) {
+    uint64_t deadline = lv_libssh2_time_now_us() + DISCONNECT_TIMEOUT_US;
+    size_t pending = 0;
+    for (size_t i = 0; i < count; i++) {
+        lv_libssh2_session_t* session = entries[i].session;
+        lv_libssh2_keepalive_unregister(session);
+        entries[i].disconnecting = false;
+        if (entries[i].description == NULL || session->socket == LIBSSH2_INVALID_SOCKET) {
+            continue;
+        }
+        lv_libssh2_profile_commit(session);
+        lv_libssh2_session_lock(session);
+        entries[i].blocking = lv_libssh2_session_begin_nonblocking(session);
+        lv_libssh2_session_unlock(session);
+        if (lv_libssh2_reaper_disconnect(&entries[i])) {
+            pending++;
+        }
+    }
+    while (pending > 0 && lv_libssh2_time_now_us() < deadline) {
+        size_t first = 0;
+        while (!entries[first].disconnecting) {
+            first++;
+        }
+        uint64_t wait_deadline = lv_libssh2_time_now_us() + RETRY_INTERVAL_US;
+        lv_libssh2_session_wait_socket(entries[first].session, wait_deadline < deadline ? wait_deadline : deadline);
+        pending = 0;
+        for (size_t i = first; i < count; i++) {
+            if (entries[i].disconnecting && lv_libssh2_reaper_disconnect(&entries[i])) {
+                pending++;
+            }
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        lv_libssh2_session_t* session = entries[i].session;
+        if (entries[i].description != NULL && session->socket != LIBSSH2_INVALID_SOCKET) {
+            lv_libssh2_session_lock(session);
+            lv_libssh2_session_end_nonblocking(session, entries[i].blocking);
+            lv_libssh2_session_unlock(session);
+        }
+        if (session->socket != LIBSSH2_INVALID_SOCKET) {
+            lv_libssh2_socket_shutdown(session->socket);
+        }
+        lv_libssh2_session_destroy(session);
+        free(entries[i].description);
+    }
+}
+
+/**
+ * Takes every queued session at once and destroys them as a batch, until the
+ * reaper is stopped and the queue is empty.
+ */
+static void
+lv_libssh2_reaper_main(
+    void* arg
+) {
+    (void)arg;
+    lv_libssh2_mutex_lock(&reaper_mutex);
+    for (;;) {
+        if (reaper_count == 0) {
+            if (reaper_stopping) {
+                break;
+            }
+            lv_libssh2_cond_wait(&reaper_cond, &reaper_mutex, LV_LIBSSH2_TIME_NO_DEADLINE);
+            continue;
+        }
+        lv_libssh2_reaper_entry_t* entries = reaper_entries;
+        size_t count = reaper_count;
+        reaper_entries = NULL;
+        reaper_count = 0;
+        reaper_capacity = 0;
+        lv_libssh2_mutex_unlock(&reaper_mutex);
+        lv_libssh2_reaper_destroy_batch(entries, count);
+        free(entries);
+        lv_libssh2_mutex_lock(&reaper_mutex);
+    }
+    lv_libssh2_mutex_unlock(&reaper_mutex);
+}
+
+void
+lv_libssh2_reaper_shutdown()
+{
+    lv_libssh2_mutex_lock(&reaper_mutex);
+    bool running = reaper_running;
+    reaper_stopping = true;
+    lv_libssh2_cond_broadcast(&reaper_cond);
+    lv_libssh2_mutex_unlock(&reaper_mutex);
+    if (running) {
+        lv_libssh2_thread_join(reaper_thread);
+    }
+    lv_libssh2_mutex_lock(&reaper_mutex);
+    reaper_running = false;
+    reaper_stopping = false;
+    lv_libssh2_mutex_unlock(&reaper_mutex);
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_destroy_async(
+    lv_libssh2_session_t* handle,
+    const char* description
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    char* description_copy = NULL;
+    if (description != NULL) {
+        size_t description_len = strlen(description) + 1;
+        description_copy = malloc(description_len);
+        if (description_copy == NULL) {
+            return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+        }
+        memcpy(description_copy, description, description_len);
+    }
+    lv_libssh2_mutex_lock(&reaper_mutex);
+    if (!reaper_running) {
+        if (!lv_libssh2_thread_start(&reaper_thread, lv_libssh2_reaper_main, NULL)) {
+            lv_libssh2_mutex_unlock(&reaper_mutex);
+            free(description_copy);
+            return LV_LIBSSH2_STATUS_ERROR_GENERIC;
+        }
+        reaper_running = true;
+    }
+    if (reaper_count == reaper_capacity) {
+        size_t capacity = reaper_capacity == 0 ? INITIAL_CAPACITY : reaper_capacity * 2;
+        lv_libssh2_reaper_entry_t* entries = realloc(reaper_entries, capacity * sizeof(lv_libssh2_reaper_entry_t));
+        if (entries == NULL) {
+            lv_libssh2_mutex_unlock(&reaper_mutex);
+            free(description_copy);
+            return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+        }
+        reaper_entries = entries;
+        reaper_capacity = capacity;
+    }
+    reaper_entries[reaper_count].session = handle;
+    reaper_entries[reaper_count].description = description_copy;
+    reaper_entries[reaper_count].blocking = 1;
+    reaper_entries[reaper_count].disconnecting = false;
+    reaper_count++;
+    lv_libssh2_cond_broadcast(&reaper_cond);
+    lv_libssh2_mutex_unlock(&reaper_mutex);
+    return LV_LIBSSH2_STATUS_OK;
+}
@@ -0,0 +1,381 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-status-private.h"
+#include "lv-libssh2-session-private.h"
+#include "lv-libssh2-channel-private.h"
+#include "lv-libssh2-expect-private.h"
+#include "lv-libssh2-runner-private.h"
+#include "lv-libssh2-time-private.h"
+
+#define NO_MATCH -1
+#define READ_CHUNK_SIZE 4096
+#define STATUS_LINE_MAX_LEN 32
+#define TRAILER_MAX_LEN 160
+
+static void
+lv_libssh2_runner_free(
+    lv_libssh2_runner_t* handle
+) {
+    if (handle->channel != NULL) {
+        lv_libssh2_channel_destroy(handle->channel);
+        handle->channel = NULL;
+    }
+    if (handle->expect != NULL) {
+        lv_libssh2_expect_destroy(handle->expect);
+        handle->expect = NULL;
+    }
+    free(handle->command);
+    handle->command = NULL;
+    free(handle->output);
+    handle->output = NULL;
+    free(handle);
+}
+
+static lv_libssh2_status_t
+lv_libssh2_runner_append_output(
+    lv_libssh2_runner_t* handle,
+    const uint8_t* data,
+    const size_t data_len
+) {
+    if (data_len == 0) {
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    if (handle->output_capacity - handle->output_len < data_len) {
+        size_t capacity = handle->output_capacity == 0 ? READ_CHUNK_SIZE : handle->output_capacity;
+        while (capacity - handle->output_len < data_len) {
+            capacity *= 2;
+        }
+        uint8_t* output = realloc(handle->output, capacity);
+        if (output == NULL) {
+            return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+        }
+        handle->output = output;
+        handle->output_capacity = capacity;
+    }
+    memcpy(handle->output + handle->output_len, data, data_len);
+    handle->output_len += data_len;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_runner_create(
+    lv_libssh2_session_t* session,
+    lv_libssh2_runner_t** handle
+) {
+    *handle = NULL;
+    if (session == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_runner_t* runner = malloc(sizeof(lv_libssh2_runner_t));
+    if (runner == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    runner->channel = NULL;
+    runner->expect = NULL;
+    runner->sequence = 0;
+    runner->pending = false;
+    runner->awaiting_status = false;
+    runner->command = NULL;
+    runner->command_len = 0;
+    runner->command_written = 0;
+    runner->output = NULL;
+    runner->output_len = 0;
+    runner->output_capacity = 0;
+    runner->exit_status = 0;
+    snprintf(
+        runner->sentinel,
+        sizeof(runner->sentinel),
+        "__LV_LIBSSH2_%016llx_",
+        (unsigned long long)(lv_libssh2_time_now_us() ^ (uintptr_t)runner)
+    );
+    lv_libssh2_status_t status = lv_libssh2_expect_create(&runner->expect);
+    if (lv_libssh2_status_is_err(status)) {
+        lv_libssh2_runner_free(runner);
+        return status;
+    }
+    int32_t index = 0;
+    status = lv_libssh2_expect_add_pattern(
+        runner->expect,
+        (const uint8_t*)runner->sentinel,
+        strlen(runner->sentinel),
+        &index
+    );
+    if (lv_libssh2_status_is_err(status)) {
+        lv_libssh2_runner_free(runner);
+        return status;
+    }
+    status = lv_libssh2_channel_create(session, &runner->channel);
+    if (lv_libssh2_status_is_err(status)) {
+        lv_libssh2_runner_free(runner);
+        return status;
+    }
+    status = lv_libssh2_channel_set_ignore_mode(runner->channel, LV_LIBSSH2_IGNORE_MODES_MERGE);
+    if (lv_libssh2_status_is_err(status)) {
+        lv_libssh2_runner_free(runner);
+        return status;
+    }
+    status = lv_libssh2_channel_shell(runner->channel);
+    if (lv_libssh2_status_is_err(status)) {
+        lv_libssh2_runner_free(runner);
+        return status;
+    }
+    *handle = runner;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_runner_destroy(
+    lv_libssh2_runner_t* handle
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_runner_free(handle);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+/**
+ * Reads the rest of the line after a sentinel, which is the sequence number of
+ * the command and its exit status separated by a colon.
+ */
+static lv_libssh2_status_t
+lv_libssh2_runner_read_status(
+    lv_libssh2_runner_t* handle,
+    uint32_t* sequence
+) {
+    lv_libssh2_expect_t* expect = handle->expect;
+    uint8_t* newline = NULL;
+    while (true) {
+        newline = memchr(
+            expect->buffer + expect->consumed,
+            '\n',
+            expect->buffer_len - expect->consumed
+        );
+        if (newline != NULL) {
+            break;
+        }
+        lv_libssh2_status_t status = lv_libssh2_expect_reserve(expect, READ_CHUNK_SIZE);
+        if (lv_libssh2_status_is_err(status)) {
+            return status;
+        }
+        size_t byte_count = 0;
+        status = lv_libssh2_channel_read(
+            handle->channel,
+            (char*)expect->buffer + expect->buffer_len,
+            expect->buffer_capacity - expect->buffer_len,
+            &byte_count
+        );
+        if (lv_libssh2_status_is_err(status)) {
+            return status;
+        }
+        if (byte_count == 0) {
+            int eof = 0;
+            status = lv_libssh2_channel_eof(handle->channel, &eof);
+            if (lv_libssh2_status_is_err(status)) {
+                return status;
+            }
+            if (eof) {
+                return LV_LIBSSH2_STATUS_ERROR_CHANNEL_CLOSED;
+            }
+        }
+        expect->buffer_len += byte_count;
+    }
+    size_t line_len = newline - (expect->buffer + expect->consumed);
+    if (line_len >= STATUS_LINE_MAX_LEN) {
+        return LV_LIBSSH2_STATUS_ERROR_PROTOCOL;
+    }
+    char line[STATUS_LINE_MAX_LEN];
+    memcpy(line, expect->buffer + expect->consumed, line_len);
+    line[line_len] = '\0';
+    expect->consumed += line_len + 1;
+    expect->scanned = expect->consumed;
+    unsigned int actual_sequence = 0;
+    int exit_status = 0;
+    if (sscanf(line, "%u:%d", &actual_sequence, &exit_status) != 2) {
+        return LV_LIBSSH2_STATUS_ERROR_PROTOCOL;
+    }
+    *sequence = actual_sequence;
+    handle->exit_status = exit_status;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+/**
+ * Collects output until the sentinel for the current command is received.
+ *
+ * Output before a sentinel for an earlier command, which can only happen if a
+ * previous call was abandoned, belongs to that command and is discarded.
+ */
+static lv_libssh2_status_t
+lv_libssh2_runner_wait(
+    lv_libssh2_runner_t* handle
+) {
+    lv_libssh2_status_t status = LV_LIBSSH2_STATUS_OK;
+    while (true) {
+        if (!handle->awaiting_status) {
+            int32_t match_index = NO_MATCH;
+            status = lv_libssh2_channel_expect(handle->channel, handle->expect, &match_index);
+            if (lv_libssh2_status_is_err(status)) {
+                return status;
+            }
+            status = lv_libssh2_runner_append_output(
+                handle,
+                handle->expect->buffer + handle->expect->before_start,
+                handle->expect->before_len
+            );
+            if (lv_libssh2_status_is_err(status)) {
+                return status;
+            }
+            if (match_index == NO_MATCH) {
+                return LV_LIBSSH2_STATUS_ERROR_CHANNEL_CLOSED;
+            }
+            handle->awaiting_status = true;
+        }
+        uint32_t sequence = 0;
+        status = lv_libssh2_runner_read_status(handle, &sequence);
+        if (lv_libssh2_status_is_err(status)) {
+            return status;
+        }
+        handle->awaiting_status = false;
+        if (sequence == handle->sequence) {
+            return LV_LIBSSH2_STATUS_OK;
+        }
+        handle->output_len = 0;
+    }
+}
+
+lv_libssh2_status_t
+lv_libssh2_runner_run(
+    lv_libssh2_runner_t* handle,
+    const char* command,
+    const size_t command_len,
+    int32_t* exit_status
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (command == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (exit_status == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (!handle->pending) {
+        char trailer[TRAILER_MAX_LEN];
+        int trailer_len = snprintf(
+            trailer,
+            sizeof(trailer),
+            "\n} </dev/null\nprintf '%%s%%u:%%d\\n' '%s' %u \"$?\"\n",
+            handle->sentinel,
+            handle->sequence + 1
+        );
+        size_t len = sizeof("{ ") - 1 + command_len + (size_t)trailer_len;
+        char* wrapped = realloc(handle->command, len);
+        if (wrapped == NULL) {
+            return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+        }
+        memcpy(wrapped, "{ ", sizeof("{ ") - 1);
+        memcpy(wrapped + sizeof("{ ") - 1, command, command_len);
+        memcpy(wrapped + sizeof("{ ") - 1 + command_len, trailer, (size_t)trailer_len);
+        handle->command = wrapped;
+        handle->command_len = len;
+        handle->command_written = 0;
+        handle->sequence += 1;
+        handle->output_len = 0;
+        handle->pending = true;
+    }
+    while (handle->command_written < handle->command_len) {
+        size_t byte_count = 0;
+        lv_libssh2_status_t status = lv_libssh2_channel_write(
+            handle->channel,
+            handle->command + handle->command_written,
+            handle->command_len - handle->command_written,
+            &byte_count
+        );
+        if (lv_libssh2_status_is_err(status)) {
+            if (status != LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN) {
+                handle->pending = false;
+            }
+            return status;
+        }
+        handle->command_written += byte_count;
+    }
+    lv_libssh2_status_t status = lv_libssh2_runner_wait(handle);
+    if (status == LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN) {
+        return status;
+    }
+    handle->pending = false;
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    *exit_status = handle->exit_status;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_runner_output_len(
+    lv_libssh2_runner_t* handle,
+    size_t* len
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (len == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *len = handle->output_len;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_runner_output(
+    lv_libssh2_runner_t* handle,
+    uint8_t* buffer
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (buffer == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    memcpy(buffer, handle->output, handle->output_len);
+    return LV_LIBSSH2_STATUS_OK;
+}
@@ -40,6 +40,7 @@
 #include "lv-libssh2-status-private.h"
 #include "lv-libssh2-session-private.h"
 #include "lv-libssh2-channel-private.h"
+#include "lv-libssh2-channel-pool-private.h"
 #include "lv-libssh2-fileinfo-private.h"
 
 lv_libssh2_status_t
@@ -57,16 +58,23 @@ lv_libssh2_scp_send(
     if (path == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(session);
+    if (lv_libssh2_channel_pool_settle(session) == LIBSSH2_ERROR_EAGAIN) {
+        lv_libssh2_session_unlock(session);
+        return LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN;
+    }
     LIBSSH2_CHANNEL* inner = libssh2_scp_send64(session->inner, path, permissions, file_size, 0, 0);
+    lv_libssh2_session_unlock(session);
     if (inner == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
-    lv_libssh2_channel_t* channel = malloc(sizeof(lv_libssh2_channel_t));
+    lv_libssh2_channel_t* channel = lv_libssh2_channel_alloc(session, inner);
     if (channel == NULL) {
+        lv_libssh2_session_lock(session);
         libssh2_channel_free(inner);
+        lv_libssh2_session_unlock(session);
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
-    channel->inner = inner;
     *handle = channel;
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -88,16 +96,23 @@ lv_libssh2_scp_receive(
     if (file_info == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(session);
+    if (lv_libssh2_channel_pool_settle(session) == LIBSSH2_ERROR_EAGAIN) {
+        lv_libssh2_session_unlock(session);
+        return LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN;
+    }
     LIBSSH2_CHANNEL* inner = libssh2_scp_recv2(session->inner, path, file_info->inner);
+    lv_libssh2_session_unlock(session);
     if (inner == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
-    lv_libssh2_channel_t* channel = malloc(sizeof(lv_libssh2_channel_t));
+    lv_libssh2_channel_t* channel = lv_libssh2_channel_alloc(session, inner);
     if (channel == NULL) {
+        lv_libssh2_session_lock(session);
         libssh2_channel_free(inner);
+        lv_libssh2_session_unlock(session);
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
-    channel->inner = inner;
     *handle = channel;
     return LV_LIBSSH2_STATUS_OK;
 }
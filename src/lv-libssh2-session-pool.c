@@ -0,0 +1,479 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-status-private.h"
+#include "lv-libssh2-session-private.h"
+#include "lv-libssh2-session-pool-private.h"
+#include "lv-libssh2-socket-private.h"
+#include "lv-libssh2-thread-private.h"
+#include "lv-libssh2-time-private.h"
+
+#define DEFAULT_MAX_PER_KEY 4
+#define DEFAULT_IDLE_TIMEOUT_US 300000000
+#define PROBE_INTERVAL_S 2
+#define PORT_DIGITS 5
+
+typedef struct _lv_libssh2_session_pool_entry {
+    lv_libssh2_session_t* session;
+    uint64_t released_us;
+} lv_libssh2_session_pool_entry_t;
+
+/**
+ * The key of a session that was taken from the pool, or is being connected for
+ * it, which is the same string as the pool key of the session.
+ */
+typedef struct _lv_libssh2_session_pool_active {
+    const char* key;
+    size_t key_len;
+} lv_libssh2_session_pool_active_t;
+
+static lv_libssh2_mutex_t pool_mutex = LV_LIBSSH2_MUTEX_INITIALIZER;
+static lv_libssh2_cond_t pool_released = LV_LIBSSH2_COND_INITIALIZER;
+static lv_libssh2_session_pool_entry_t* pool_entries = NULL;
+static size_t pool_count = 0;
+static size_t pool_capacity = 0;
+static lv_libssh2_session_pool_active_t* pool_active = NULL;
+static size_t pool_active_count = 0;
+static size_t pool_active_capacity = 0;
+static size_t pool_max_per_key = DEFAULT_MAX_PER_KEY;
+static uint64_t pool_idle_timeout_us = DEFAULT_IDLE_TIMEOUT_US;
+
+/**
+ * Builds the key as the host, port, user, and credential identifier, each
+ * terminated by a null character so no combination of fields is ambiguous.
+ */
+static char*
+lv_libssh2_session_pool_key(
+    const char* host,
+    const uint16_t port,
+    const char* user,
+    const char* credential_id,
+    size_t* key_len
+) {
+    size_t host_len = strlen(host) + 1;
+    size_t user_len = strlen(user) + 1;
+    size_t credential_id_len = strlen(credential_id) + 1;
+    char* key = malloc(host_len + PORT_DIGITS + 1 + user_len + credential_id_len);
+    if (key == NULL) {
+        return NULL;
+    }
+    size_t len = 0;
+    memcpy(key, host, host_len);
+    len += host_len;
+    len += (size_t)sprintf(key + len, "%u", (unsigned int)port) + 1;
+    memcpy(key + len, user, user_len);
+    len += user_len;
+    memcpy(key + len, credential_id, credential_id_len);
+    len += credential_id_len;
+    *key_len = len;
+    return key;
+}
+
+static bool
+lv_libssh2_session_pool_key_equals(
+    const lv_libssh2_session_t* session,
+    const char* key,
+    const size_t key_len
+) {
+    return session->pool_key_len == key_len && memcmp(session->pool_key, key, key_len) == 0;
+}
+
+/**
+ * Counts the sessions for the key that are idle in the pool or in use. The pool
+ * lock must be held.
+ */
+static size_t
+lv_libssh2_session_pool_key_count(
+    const char* key,
+    const size_t key_len
+) {
+    size_t count = 0;
+    for (size_t i = 0; i < pool_count; i++) {
+        if (lv_libssh2_session_pool_key_equals(pool_entries[i].session, key, key_len)) {
+            count++;
+        }
+    }
+    for (size_t i = 0; i < pool_active_count; i++) {
+        if (pool_active[i].key_len == key_len && memcmp(pool_active[i].key, key, key_len) == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Counts a session for the key as in use. The pool lock must be held.
+ */
+static lv_libssh2_status_t
+lv_libssh2_session_pool_activate(
+    const char* key,
+    const size_t key_len
+) {
+    if (pool_active_count == pool_active_capacity) {
+        size_t capacity = pool_active_capacity == 0 ? DEFAULT_MAX_PER_KEY : pool_active_capacity * 2;
+        lv_libssh2_session_pool_active_t* active = realloc(pool_active, capacity * sizeof(lv_libssh2_session_pool_active_t));
+        if (active == NULL) {
+            return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+        }
+        pool_active = active;
+        pool_active_capacity = capacity;
+    }
+    pool_active[pool_active_count].key = key;
+    pool_active[pool_active_count].key_len = key_len;
+    pool_active_count++;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+/**
+ * Stops counting the session with the key as in use and wakes the callers
+ * waiting for room under the maximum. The pool lock must be held.
+ */
+static void
+lv_libssh2_session_pool_deactivate(
+    const char* key
+) {
+    for (size_t i = 0; i < pool_active_count; i++) {
+        if (pool_active[i].key == key) {
+            pool_active[i] = pool_active[pool_active_count - 1];
+            pool_active_count--;
+            lv_libssh2_cond_broadcast(&pool_released);
+            return;
+        }
+    }
+}
+
+static void
+lv_libssh2_session_pool_remove(
+    const size_t index
+) {
+    memmove(
+        pool_entries + index,
+        pool_entries + index + 1,
+        (pool_count - index - 1) * sizeof(lv_libssh2_session_pool_entry_t)
+    );
+    pool_count--;
+}
+
+/**
+ * Moves the idle sessions that have been in the pool longer than the idle
+ * timeout to the front of the `evicted` array, which must have room for every
+ * pooled session. The pool lock must be held.
+ */
+static size_t
+lv_libssh2_session_pool_take_expired(
+    lv_libssh2_session_t** evicted
+) {
+    size_t evicted_count = 0;
+    uint64_t now = lv_libssh2_time_now_us();
+    size_t i = 0;
+    while (i < pool_count) {
+        if (now - pool_entries[i].released_us >= pool_idle_timeout_us) {
+            evicted[evicted_count++] = pool_entries[i].session;
+            lv_libssh2_session_pool_remove(i);
+        } else {
+            i++;
+        }
+    }
+    return evicted_count;
+}
+
+static void
+lv_libssh2_session_pool_close(
+    lv_libssh2_session_t** sessions,
+    const size_t session_count
+) {
+    for (size_t i = 0; i < session_count; i++) {
+        if (lv_libssh2_status_is_err(lv_libssh2_session_destroy_async(sessions[i], "Idle session closed"))) {
+            lv_libssh2_session_disconnect(sessions[i], "Idle session closed");
+            lv_libssh2_session_destroy(sessions[i]);
+        }
+    }
+}
+
+/**
+ * Checks that an idle session is still usable by looking for a closed socket
+ * and sending a keepalive request, which fails if the connection was reset.
+ * The reply is processed by libssh2 during the next read. A session with its
+ * own keepalive interval is only sent a request if one is due, and one that
+ * the keepalive scheduler found dead is not probed at all.
+ */
+static bool
+lv_libssh2_session_pool_probe(
+    lv_libssh2_session_t* session
+) {
+    lv_libssh2_session_states_t state = LV_LIBSSH2_SESSION_STATE_ALIVE;
+    lv_libssh2_session_state(session, &state);
+    if (state == LV_LIBSSH2_SESSION_STATE_DEAD) {
+        return false;
+    }
+    if (lv_libssh2_socket_is_closed(session->socket)) {
+        return false;
+    }
+    int seconds_to_next = 0;
+    lv_libssh2_session_lock(session);
+    if (session->keepalive_interval_s == 0) {
+        libssh2_keepalive_config(session->inner, 1, PROBE_INTERVAL_S);
+    }
+    int result = libssh2_keepalive_send(session->inner, &seconds_to_next);
+    if (session->keepalive_interval_s == 0) {
+        libssh2_keepalive_config(session->inner, 0, 0);
+    }
+    lv_libssh2_session_unlock(session);
+    return result == 0 || result == LIBSSH2_ERROR_EAGAIN;
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_pool_configure(
+    const size_t max_per_key,
+    const int32_t idle_timeout_ms
+) {
+    lv_libssh2_mutex_lock(&pool_mutex);
+    pool_max_per_key = max_per_key;
+    pool_idle_timeout_us = idle_timeout_ms < 0 ? LV_LIBSSH2_TIME_NO_DEADLINE : (uint64_t)idle_timeout_ms * 1000;
+    lv_libssh2_mutex_unlock(&pool_mutex);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_pool_acquire(
+    const char* host,
+    const uint16_t port,
+    const char* user,
+    const char* credential_id,
+    const int32_t timeout_ms,
+    const lv_libssh2_socket_options_t* options,
+    lv_libssh2_session_t** handle,
+    uint8_t* reused
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *handle = NULL;
+    if (host == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (user == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (reused == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *reused = 0;
+    size_t key_len = 0;
+    char* key = lv_libssh2_session_pool_key(host, port, user, credential_id == NULL ? "" : credential_id, &key_len);
+    if (key == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    uint64_t deadline_us = lv_libssh2_time_deadline_us(timeout_ms);
+    lv_libssh2_status_t status = LV_LIBSSH2_STATUS_OK;
+    for (;;) {
+        lv_libssh2_mutex_lock(&pool_mutex);
+        lv_libssh2_session_t** evicted = malloc((pool_count + 1) * sizeof(lv_libssh2_session_t*));
+        if (evicted == NULL) {
+            lv_libssh2_mutex_unlock(&pool_mutex);
+            free(key);
+            return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+        }
+        size_t evicted_count = lv_libssh2_session_pool_take_expired(evicted);
+        lv_libssh2_session_t* session = NULL;
+        for (size_t i = pool_count; i > 0; i--) {
+            if (lv_libssh2_session_pool_key_equals(pool_entries[i - 1].session, key, key_len)) {
+                session = pool_entries[i - 1].session;
+                lv_libssh2_session_pool_remove(i - 1);
+                break;
+            }
+        }
+        bool full = false;
+        if (session != NULL) {
+            status = lv_libssh2_session_pool_activate(session->pool_key, session->pool_key_len);
+        } else if (pool_max_per_key > 0 && lv_libssh2_session_pool_key_count(key, key_len) >= pool_max_per_key) {
+            full = true;
+            if (evicted_count == 0) {
+                // Wait for a session with the key to be released or destroyed.
+                if (lv_libssh2_time_now_us() >= deadline_us) {
+                    status = LV_LIBSSH2_STATUS_ERROR_TIMEOUT;
+                } else {
+                    lv_libssh2_cond_wait(&pool_released, &pool_mutex, deadline_us);
+                }
+            }
+        } else if (pool_max_per_key > 0) {
+            status = lv_libssh2_session_pool_activate(key, key_len);
+        }
+        lv_libssh2_mutex_unlock(&pool_mutex);
+        lv_libssh2_session_pool_close(evicted, evicted_count);
+        free(evicted);
+        if (lv_libssh2_status_is_err(status)) {
+            if (session != NULL) {
+                lv_libssh2_session_pool_close(&session, 1);
+            }
+            free(key);
+            return status;
+        }
+        if (full) {
+            continue;
+        }
+        if (session == NULL) {
+            break;
+        }
+        if (lv_libssh2_session_pool_probe(session)) {
+            free(key);
+            *handle = session;
+            *reused = 1;
+            return LV_LIBSSH2_STATUS_OK;
+        }
+        lv_libssh2_session_pool_detach(session);
+        lv_libssh2_session_pool_close(&session, 1);
+    }
+    lv_libssh2_session_t* session = NULL;
+    status = lv_libssh2_session_create(&session);
+    if (lv_libssh2_status_is_err(status)) {
+        lv_libssh2_mutex_lock(&pool_mutex);
+        lv_libssh2_session_pool_deactivate(key);
+        lv_libssh2_mutex_unlock(&pool_mutex);
+        free(key);
+        return status;
+    }
+    // The session takes over the key, so it is counted against the maximum
+    // until it is released or destroyed.
+    session->pool_key = key;
+    session->pool_key_len = key_len;
+    status = lv_libssh2_session_connect_host(session, host, port, timeout_ms, options);
+    if (lv_libssh2_status_is_err(status)) {
+        lv_libssh2_session_destroy(session);
+        return status;
+    }
+    *handle = session;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_pool_release(
+    lv_libssh2_session_t* handle
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (handle->pool_key == NULL) {
+        return lv_libssh2_session_destroy(handle);
+    }
+    // A session that never finished authenticating, or that the keepalive
+    // scheduler found dead, cannot be handed out again.
+    lv_libssh2_session_states_t state = LV_LIBSSH2_SESSION_STATE_ALIVE;
+    lv_libssh2_session_state(handle, &state);
+    lv_libssh2_session_lock(handle);
+    bool reusable = state == LV_LIBSSH2_SESSION_STATE_ALIVE && libssh2_userauth_authenticated(handle->inner) != 0;
+    lv_libssh2_session_unlock(handle);
+    lv_libssh2_mutex_lock(&pool_mutex);
+    lv_libssh2_session_pool_deactivate(handle->pool_key);
+    lv_libssh2_session_t** evicted = malloc((pool_count + 1) * sizeof(lv_libssh2_session_t*));
+    if (evicted == NULL) {
+        lv_libssh2_mutex_unlock(&pool_mutex);
+        lv_libssh2_session_pool_close(&handle, 1);
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    size_t evicted_count = lv_libssh2_session_pool_take_expired(evicted);
+    size_t key_count = lv_libssh2_session_pool_key_count(handle->pool_key, handle->pool_key_len);
+    size_t i = 0;
+    while (i < pool_count && key_count >= pool_max_per_key) {
+        if (lv_libssh2_session_pool_key_equals(pool_entries[i].session, handle->pool_key, handle->pool_key_len)) {
+            evicted[evicted_count++] = pool_entries[i].session;
+            lv_libssh2_session_pool_remove(i);
+            key_count--;
+        } else {
+            i++;
+        }
+    }
+    if (!reusable || key_count >= pool_max_per_key) {
+        evicted[evicted_count++] = handle;
+    } else {
+        if (pool_count == pool_capacity) {
+            size_t capacity = pool_capacity == 0 ? DEFAULT_MAX_PER_KEY : pool_capacity * 2;
+            lv_libssh2_session_pool_entry_t* entries = realloc(pool_entries, capacity * sizeof(lv_libssh2_session_pool_entry_t));
+            if (entries == NULL) {
+                lv_libssh2_mutex_unlock(&pool_mutex);
+                lv_libssh2_session_pool_close(evicted, evicted_count);
+                free(evicted);
+                lv_libssh2_session_pool_close(&handle, 1);
+                return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+            }
+            pool_entries = entries;
+            pool_capacity = capacity;
+        }
+        pool_entries[pool_count].session = handle;
+        pool_entries[pool_count].released_us = lv_libssh2_time_now_us();
+        pool_count++;
+    }
+    lv_libssh2_mutex_unlock(&pool_mutex);
+    lv_libssh2_session_pool_close(evicted, evicted_count);
+    free(evicted);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+void
+lv_libssh2_session_pool_detach(
+    lv_libssh2_session_t* session
+) {
+    lv_libssh2_mutex_lock(&pool_mutex);
+    lv_libssh2_session_pool_deactivate(session->pool_key);
+    lv_libssh2_mutex_unlock(&pool_mutex);
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_pool_clear()
+{
+    lv_libssh2_mutex_lock(&pool_mutex);
+    lv_libssh2_session_pool_entry_t* entries = pool_entries;
+    size_t count = pool_count;
+    pool_entries = NULL;
+    pool_count = 0;
+    pool_capacity = 0;
+    if (pool_active_count == 0) {
+        free(pool_active);
+        pool_active = NULL;
+        pool_active_capacity = 0;
+    }
+    lv_libssh2_mutex_unlock(&pool_mutex);
+    for (size_t i = 0; i < count; i++) {
+        lv_libssh2_session_pool_close(&entries[i].session, 1);
+    }
+    free(entries);
+    return LV_LIBSSH2_STATUS_OK;
+}
@@ -34,11 +34,187 @@
 #ifndef LV_LIBSSH2_SESSION_PRIVATE_H
 #define LV_LIBSSH2_SESSION_PRIVATE_H
 
+#include <stdbool.h>
+
 #include "lv-libssh2.h"
+#include "lv-libssh2-jump-private.h"
+#include "lv-libssh2-memory-private.h"
+#include "lv-libssh2-profile-private.h"
+#include "lv-libssh2-thread-private.h"
+
+typedef ssize_t (*lv_libssh2_session_recv_func_t)(
+    libssh2_socket_t socket,
+    void* buffer,
+    size_t length,
+    int flags,
+    void** abstract
+);
 
 struct _lv_libssh2_session {
     LIBSSH2_SESSION* inner;
+    libssh2_socket_t socket;
+    bool owns_socket;
+    char* pool_key;
+    size_t pool_key_len;
+    lv_libssh2_mutex_t lock;
+    bool scheduled;
+    bool locking;
+    uint32_t keepalive_interval_s;
+    lv_libssh2_session_states_t state;
+    bool reactor_active;
+    char* host;
+    uint32_t method_prefs;
+    lv_libssh2_compression_policies_t compression_policy;
+    lv_libssh2_profile_sample_t profile_sample;
+    bool thread_safe;
+    int blocking;
+    int call_blocking;
+    lv_libssh2_session_recv_func_t recv;
+    uint64_t received;
+    uint64_t received_at_lock;
+    uint64_t generation;
+    uint32_t waiters;
+    bool polling;
+    libssh2_socket_t wake[2];
+    lv_libssh2_cond_t progress;
+    lv_libssh2_jump_t* jump;
+    lv_libssh2_channel_pool_t* opening_pool;
+    char* auth_list;
+    lv_libssh2_memory_t* memory;
+    lv_libssh2_memory_modes_t memory_mode;
+    uint32_t window_size;
+    uint32_t packet_size;
+    uint32_t window_max_factor;
 };
 
+/**
+ * Takes the session lock around direct libssh2 calls while another thread can
+ * use the session, which is once the session has been given to the keepalive
+ * scheduler or while it is thread safe, and otherwise does nothing. A session
+ * that was scheduled once keeps locking for good, so a call never sees the
+ * lock appear or disappear between its lock and unlock. The lock is not
+ * recursive, so it must never be held across a call to another library
+ * function that takes it.
+ *
+ * In thread safe mode, the lock also puts libssh2 into the mode of the caller,
+ * and the unlock wakes the threads waiting for the socket if the call received
+ * any data, since it may have queued packets for their channels.
+ */
+void
+lv_libssh2_session_lock(
+    lv_libssh2_session_t* handle
+);
+
+void
+lv_libssh2_session_unlock(
+    lv_libssh2_session_t* handle
+);
+
+/**
+ * Takes the session lock for a background thread only if no other thread
+ * holds it, and returns whether it was taken. It is released with
+ * lv_libssh2_session_unlock().
+ */
+bool
+lv_libssh2_session_try_lock(
+    lv_libssh2_session_t* handle
+);
+
+/**
+ * Takes the session lock around a single non-blocking libssh2 call on the data
+ * path, such as a channel read or write, which is retried while
+ * lv_libssh2_session_unlock_io() returns `true`:
+ *
+ *     do {
+ *         lv_libssh2_session_lock_io(session);
+ *         result = libssh2_channel_read_ex(...);
+ *     } while (lv_libssh2_session_unlock_io(session, &result, &deadline));
+ *
+ * The deadline starts at zero and is set from the session timeout on the first
+ * wait. Outside thread safe mode, this is lv_libssh2_session_lock() and the
+ * call runs in the mode of the session. In thread safe mode, libssh2 never
+ * blocks with the lock held for a blocking caller; the lock is released while
+ * waiting for data, so other threads can use their channels in the meantime.
+ * A packet that was partially sent is always finished before the lock is
+ * released, because libssh2 cannot interleave another packet with it.
+ */
+void
+lv_libssh2_session_lock_io(
+    lv_libssh2_session_t* handle
+);
+
+bool
+lv_libssh2_session_unlock_io(
+    lv_libssh2_session_t* handle,
+    ssize_t* result,
+    uint64_t* deadline_us
+);
+
+/**
+ * Switches the session to non-blocking mode for the calling thread until the
+ * matching lv_libssh2_session_end_nonblocking(), for operations that loop over
+ * several library calls with waits on the socket in between. Returns the
+ * previous mode of libssh2 to restore. Both are called with the session lock
+ * held and must be called from the same thread.
+ */
+int
+lv_libssh2_session_begin_nonblocking(
+    lv_libssh2_session_t* handle
+);
+
+void
+lv_libssh2_session_end_nonblocking(
+    lv_libssh2_session_t* handle,
+    const int blocking
+);
+
+/**
+ * Sets the mode that the caller sees, which is the mode of libssh2 except in
+ * thread safe mode, where it is applied by lv_libssh2_session_lock().
+ */
+void
+lv_libssh2_session_apply_mode(
+    lv_libssh2_session_t* handle,
+    const int blocking
+);
+
+/**
+ * Waits until the socket is ready in the directions libssh2 is blocked on,
+ * after an operation in non-blocking mode returned LIBSSH2_ERROR_EAGAIN.
+ *
+ * The deadline is from lv_libssh2_time_deadline_us(), and the
+ * ::LV_LIBSSH2_STATUS_ERROR_TIMEOUT status is returned if it passes first.
+ *
+ * In thread safe mode, only one thread polls the socket for reading at a time
+ * and the others wait for it, and the wait returns early when another thread
+ * has received data since the last call of this thread released the lock.
+ */
+lv_libssh2_status_t
+lv_libssh2_session_wait_socket(
+    lv_libssh2_session_t* handle,
+    const uint64_t deadline_us
+);
+
+/**
+ * Waits like lv_libssh2_session_wait_socket() but with the session lock held,
+ * for a setup call retried in non-blocking mode that no other thread may
+ * resume between its retries. The other threads wait for the lock meanwhile,
+ * as they do for a setup call in blocking mode.
+ */
+lv_libssh2_status_t
+lv_libssh2_session_wait_socket_locked(
+    lv_libssh2_session_t* handle,
+    const uint64_t deadline_us
+);
+
+/**
+ * Starts counting the bytes received from the socket in the received field,
+ * unless they are counted already. The lock must be held.
+ */
+void
+lv_libssh2_session_count_received(
+    lv_libssh2_session_t* handle
+);
+
 #endif
 
@@ -31,32 +31,223 @@
  *   Christopher R. Field <chris@fieldrndservices.com>
  */
 
+#include <errno.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/socket.h>
+#endif
 
 #include "libssh2.h"
 
 #include "lv-libssh2.h"
+#include "lv-libssh2-jump-private.h"
+#include "lv-libssh2-keepalive-private.h"
+#include "lv-libssh2-profile-private.h"
 #include "lv-libssh2-status-private.h"
 #include "lv-libssh2-session-private.h"
+#include "lv-libssh2-session-pool-private.h"
+#include "lv-libssh2-socket-private.h"
+#include "lv-libssh2-time-private.h"
 
 #define BLOCK_DIRECTIONS_BOTH 3
+#define WAKE_DRAIN_SIZE 64
+#define DEFAULT_WINDOW_MAX_FACTOR 16
+#define LOW_MEMORY_WINDOW_SIZE 65536
+#define LOW_MEMORY_PACKET_SIZE 16384
+#define LOW_MEMORY_WINDOW_MAX_FACTOR 4
+#define LOW_MEMORY_RETAIN_LIMIT 262144
+#define ARENA_BASE_SIZE 1048576
+#define ARENA_WINDOW_FACTOR 2
+#define POOL_RETAIN_LIMIT 1048576
+
+// The state of the calling thread, which lets a thread safe wait tell whether
+// another thread has made progress since this thread last held the lock.
+static LV_LIBSSH2_THREAD_LOCAL uint32_t nonblocking_depth = 0;
+static LV_LIBSSH2_THREAD_LOCAL lv_libssh2_session_t* held_session = NULL;
+static LV_LIBSSH2_THREAD_LOCAL lv_libssh2_session_t* last_session = NULL;
+static LV_LIBSSH2_THREAD_LOCAL uint64_t last_generation = 0;
+static LV_LIBSSH2_THREAD_LOCAL int last_directions = 0;
+
+/**
+ * Allocates the wrapper of a session with the defaults of every field, but
+ * without the libssh2 session.
+ */
+static lv_libssh2_session_t*
+lv_libssh2_session_alloc()
+{
+    lv_libssh2_session_t* session = malloc(sizeof(lv_libssh2_session_t));
+    if (session == NULL) {
+        return NULL;
+    }
+    session->inner = NULL;
+    session->socket = LIBSSH2_INVALID_SOCKET;
+    session->owns_socket = false;
+    session->pool_key = NULL;
+    session->pool_key_len = 0;
+    lv_libssh2_mutex_init(&session->lock);
+    session->scheduled = false;
+    session->locking = false;
+    session->keepalive_interval_s = 0;
+    session->state = LV_LIBSSH2_SESSION_STATE_ALIVE;
+    session->reactor_active = false;
+    session->host = NULL;
+    session->method_prefs = 0;
+    session->compression_policy = LV_LIBSSH2_COMPRESSION_POLICY_MANUAL;
+    memset(&session->profile_sample, 0, sizeof(lv_libssh2_profile_sample_t));
+    session->thread_safe = false;
+    session->blocking = 1;
+    session->call_blocking = 1;
+    session->recv = NULL;
+    session->received = 0;
+    session->received_at_lock = 0;
+    session->generation = 0;
+    session->waiters = 0;
+    session->polling = false;
+    session->wake[0] = LIBSSH2_INVALID_SOCKET;
+    session->wake[1] = LIBSSH2_INVALID_SOCKET;
+    session->jump = NULL;
+    session->opening_pool = NULL;
+    session->auth_list = NULL;
+    session->memory = NULL;
+    session->memory_mode = LV_LIBSSH2_MEMORY_MODE_DEFAULT;
+    session->window_size = LIBSSH2_CHANNEL_WINDOW_DEFAULT;
+    session->packet_size = LIBSSH2_CHANNEL_PACKET_DEFAULT;
+    session->window_max_factor = DEFAULT_WINDOW_MAX_FACTOR;
+    return session;
+}
+
+static void
+lv_libssh2_session_free(
+    lv_libssh2_session_t* session
+) {
+    if (session->memory != NULL) {
+        lv_libssh2_memory_destroy(session->memory);
+    }
+    lv_libssh2_mutex_destroy(&session->lock);
+    free(session);
+}
 
 lv_libssh2_status_t
 lv_libssh2_session_create(
     lv_libssh2_session_t** handle
 ) {
     *handle = NULL;
-    LIBSSH2_SESSION* inner = libssh2_session_init_ex(NULL, NULL, NULL, NULL);
-    if (inner == NULL) {
+    lv_libssh2_session_t* session = lv_libssh2_session_alloc();
+    if (session == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
-    lv_libssh2_session_t* session = malloc(sizeof(lv_libssh2_session_t));
+    session->inner = libssh2_session_init_ex(NULL, NULL, NULL, NULL);
+    if (session->inner == NULL) {
+        lv_libssh2_session_free(session);
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    *handle = session;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_create_ex(
+    const lv_libssh2_session_config_t* config,
+    lv_libssh2_session_t** handle
+) {
+    *handle = NULL;
+    lv_libssh2_session_config_t defaults;
+    memset(&defaults, 0, sizeof(lv_libssh2_session_config_t));
+    if (config == NULL) {
+        config = &defaults;
+    }
+    if (config->packet_size > LIBSSH2_CHANNEL_PACKET_DEFAULT) {
+        return LV_LIBSSH2_STATUS_ERROR_INVALID_PACKET_SIZE;
+    }
+    lv_libssh2_session_t* session = lv_libssh2_session_alloc();
     if (session == NULL) {
-        libssh2_session_free(inner);
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
-    session->inner = inner;
+    int32_t allocator = config->allocator;
+    size_t retain_limit = POOL_RETAIN_LIMIT;
+    switch (config->memory_mode) {
+        case LV_LIBSSH2_MEMORY_MODE_DEFAULT:
+            if (allocator == LV_LIBSSH2_ALLOCATOR_DEFAULT) {
+                allocator = LV_LIBSSH2_ALLOCATOR_SYSTEM;
+            }
+            break;
+        case LV_LIBSSH2_MEMORY_MODE_LOW:
+            session->window_size = LOW_MEMORY_WINDOW_SIZE;
+            session->packet_size = LOW_MEMORY_PACKET_SIZE;
+            session->window_max_factor = LOW_MEMORY_WINDOW_MAX_FACTOR;
+            retain_limit = LOW_MEMORY_RETAIN_LIMIT;
+            if (allocator == LV_LIBSSH2_ALLOCATOR_DEFAULT) {
+                allocator = LV_LIBSSH2_ALLOCATOR_POOL;
+            }
+            break;
+        case LV_LIBSSH2_MEMORY_MODE_REAL_TIME:
+            session->window_size = LOW_MEMORY_WINDOW_SIZE;
+            session->packet_size = LOW_MEMORY_PACKET_SIZE;
+            session->window_max_factor = LOW_MEMORY_WINDOW_MAX_FACTOR;
+            if (allocator == LV_LIBSSH2_ALLOCATOR_DEFAULT) {
+                allocator = LV_LIBSSH2_ALLOCATOR_ARENA;
+            }
+            break;
+        default:
+            lv_libssh2_session_free(session);
+            return LV_LIBSSH2_STATUS_ERROR_UNKNOWN_MEMORY_MODE;
+    }
+    session->memory_mode = config->memory_mode;
+    if (config->window_size != 0) {
+        session->window_size = config->window_size;
+    }
+    if (config->packet_size != 0) {
+        session->packet_size = config->packet_size;
+    }
+    bool pooled = false;
+    size_t arena_size = 0;
+    switch (allocator) {
+        case LV_LIBSSH2_ALLOCATOR_SYSTEM:
+            break;
+        case LV_LIBSSH2_ALLOCATOR_POOL:
+            pooled = true;
+            break;
+        case LV_LIBSSH2_ALLOCATOR_ARENA:
+            arena_size = config->arena_size;
+            if (arena_size == 0) {
+                // The adaptive window mode can grow the window of a channel to
+                // its maximum, so the arena must hold that much in flight.
+                uint64_t window_max = (uint64_t)session->window_size * session->window_max_factor;
+                uint64_t size = ARENA_BASE_SIZE + ARENA_WINDOW_FACTOR * window_max;
+                arena_size = size > SIZE_MAX ? SIZE_MAX : (size_t)size;
+            }
+            break;
+        default:
+            lv_libssh2_session_free(session);
+            return LV_LIBSSH2_STATUS_ERROR_UNKNOWN_ALLOCATOR;
+    }
+    lv_libssh2_status_t status = lv_libssh2_memory_create(
+        pooled,
+        retain_limit,
+        arena_size,
+        config->memory_limit,
+        &session->memory
+    );
+    if (lv_libssh2_status_is_err(status)) {
+        lv_libssh2_session_free(session);
+        return status;
+    }
+    session->inner = libssh2_session_init_ex(
+        lv_libssh2_memory_alloc,
+        lv_libssh2_memory_free,
+        lv_libssh2_memory_realloc,
+        session
+    );
+    if (session->inner == NULL) {
+        lv_libssh2_session_free(session);
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
     *handle = session;
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -68,13 +259,57 @@ lv_libssh2_session_destroy(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_jump_stop(handle);
+    lv_libssh2_keepalive_unregister(handle);
+    lv_libssh2_profile_commit(handle);
     libssh2_session_set_blocking(handle->inner, LV_LIBSSH2_SESSION_MODE_BLOCKING);
     int result = libssh2_session_free(handle->inner);
     if (result != 0) {
         return LV_LIBSSH2_STATUS_ERROR_FREE;
     }
     handle->inner = NULL;
-    free(handle);
+    if (handle->owns_socket) {
+        lv_libssh2_socket_close(handle->socket);
+    }
+    if (handle->pool_key != NULL) {
+        lv_libssh2_session_pool_detach(handle);
+    }
+    free(handle->pool_key);
+    handle->pool_key = NULL;
+    free(handle->host);
+    handle->host = NULL;
+    free(handle->auth_list);
+    handle->auth_list = NULL;
+    if (handle->thread_safe) {
+        lv_libssh2_socket_close(handle->wake[0]);
+        lv_libssh2_socket_close(handle->wake[1]);
+        lv_libssh2_cond_destroy(&handle->progress);
+    }
+    lv_libssh2_session_free(handle);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_memory_usage(
+    lv_libssh2_session_t* handle,
+    uint64_t* current,
+    uint64_t* peak
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (current == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (peak == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (handle->memory == NULL) {
+        *current = 0;
+        *peak = 0;
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    lv_libssh2_memory_usage(handle->memory, current, peak);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -86,10 +321,102 @@ lv_libssh2_session_connect(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
-    int result = libssh2_session_handshake(handle->inner, socket);
+    handle->socket = (libssh2_socket_t)socket;
+    lv_libssh2_profile_apply(handle);
+    int result = libssh2_session_handshake(handle->inner, handle->socket);
     return lv_libssh2_status_from_result(result);
 }
 
+/**
+ * Takes ownership of a connected socket and runs the handshake on it in
+ * non-blocking mode, so it is bounded by the deadline.
+ */
+static lv_libssh2_status_t
+lv_libssh2_session_handshake_owned(
+    lv_libssh2_session_t* handle,
+    const libssh2_socket_t socket,
+    const uint64_t deadline_us
+) {
+    if (handle->owns_socket) {
+        lv_libssh2_socket_close(handle->socket);
+    }
+    handle->socket = socket;
+    handle->owns_socket = true;
+    lv_libssh2_profile_apply(handle);
+    int blocking = libssh2_session_get_blocking(handle->inner);
+    libssh2_session_set_blocking(handle->inner, LV_LIBSSH2_SESSION_MODE_NONBLOCKING);
+    lv_libssh2_status_t status = LV_LIBSSH2_STATUS_OK;
+    int result = 0;
+    while ((result = libssh2_session_handshake(handle->inner, socket)) == LIBSSH2_ERROR_EAGAIN) {
+        status = lv_libssh2_session_wait_socket(handle, deadline_us);
+        if (lv_libssh2_status_is_err(status)) {
+            break;
+        }
+    }
+    libssh2_session_set_blocking(handle->inner, blocking);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    return lv_libssh2_status_from_result(result);
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_connect_host(
+    lv_libssh2_session_t* handle,
+    const char* host,
+    const uint16_t port,
+    const int32_t timeout_ms,
+    const lv_libssh2_socket_options_t* options
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (host == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_status_t status = lv_libssh2_session_set_host(handle, host, port);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    uint64_t deadline = lv_libssh2_time_deadline_us(timeout_ms);
+    libssh2_socket_t socket = LIBSSH2_INVALID_SOCKET;
+    status = lv_libssh2_socket_connect(host, port, options, deadline, &socket);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    return lv_libssh2_session_handshake_owned(handle, socket, deadline);
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_connect_jump(
+    lv_libssh2_session_t* handle,
+    lv_libssh2_session_t* jump_session,
+    const char* host,
+    const uint16_t port,
+    const int32_t timeout_ms
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (jump_session == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (host == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    lv_libssh2_status_t status = lv_libssh2_session_set_host(handle, host, port);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    uint64_t deadline = lv_libssh2_time_deadline_us(timeout_ms);
+    libssh2_socket_t socket = LIBSSH2_INVALID_SOCKET;
+    status = lv_libssh2_jump_open(jump_session, host, port, deadline, &socket);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    return lv_libssh2_session_handshake_owned(handle, socket, deadline);
+}
+
 lv_libssh2_status_t
 lv_libssh2_session_disconnect(
     lv_libssh2_session_t* handle,
@@ -98,8 +425,11 @@ lv_libssh2_session_disconnect(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_profile_commit(handle);
+    lv_libssh2_session_lock(handle);
     libssh2_session_set_blocking(handle->inner, LV_LIBSSH2_SESSION_MODE_BLOCKING);
     libssh2_session_disconnect_ex(handle->inner, SSH_DISCONNECT_BY_APPLICATION, description, "");
+    lv_libssh2_session_unlock(handle);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -125,7 +455,9 @@ lv_libssh2_session_hostkey_hash(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     const char* hash = libssh2_hostkey_hash(handle->inner, type);
+    lv_libssh2_session_unlock(handle);
     if (hash == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_HASH_UNAVAILABLE;
     }
@@ -147,13 +479,26 @@ lv_libssh2_session_hostkey_len(
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
     int type = 0;
+    lv_libssh2_session_lock(handle);
     const char* result = libssh2_session_hostkey(handle->inner, len, &type);
+    lv_libssh2_session_unlock(handle);
     if (result == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_GENERIC;
     }
     return LV_LIBSSH2_STATUS_OK;
 }
 
+static lv_libssh2_hostkey_types_t
+lv_libssh2_session_hostkey_type(
+    const int libssh2_type
+) {
+    switch (libssh2_type) {
+        case LIBSSH2_HOSTKEY_TYPE_RSA: return LV_LIBSSH2_HOSTKEY_TYPE_RSA;
+        case LIBSSH2_HOSTKEY_TYPE_DSS: return LV_LIBSSH2_HOSTKEY_TYPE_DSS;
+        default: return LV_LIBSSH2_HOSTKEY_TYPE_UNKNOWN;
+    }
+}
+
 lv_libssh2_status_t
 lv_libssh2_session_hostkey(
     lv_libssh2_session_t* handle,
@@ -165,15 +510,13 @@ lv_libssh2_session_hostkey(
     }
     size_t len = 0;
     int libssh2_type = 0;
+    lv_libssh2_session_lock(handle);
     const char* hostkey = libssh2_session_hostkey(handle->inner, &len, &libssh2_type);
+    lv_libssh2_session_unlock(handle);
     if (hostkey == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_GENERIC;
     }
-    switch (libssh2_type) {
-        case LIBSSH2_HOSTKEY_TYPE_RSA: *type = LV_LIBSSH2_HOSTKEY_TYPE_RSA; break;
-        case LIBSSH2_HOSTKEY_TYPE_DSS: *type = LV_LIBSSH2_HOSTKEY_TYPE_DSS; break;
-        default: *type = LV_LIBSSH2_HOSTKEY_TYPE_UNKNOWN;
-    }
+    *type = lv_libssh2_session_hostkey_type(libssh2_type);
     memcpy(buffer, hostkey, len);
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -186,7 +529,9 @@ lv_libssh2_session_mode(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
-    int result = libssh2_session_get_blocking(handle->inner);
+    lv_libssh2_session_lock(handle);
+    int result = handle->thread_safe ? handle->blocking : libssh2_session_get_blocking(handle->inner);
+    lv_libssh2_session_unlock(handle);
     switch (result) {
         case 0: *mode = LV_LIBSSH2_SESSION_MODE_NONBLOCKING; break;
         case 1: *mode = LV_LIBSSH2_SESSION_MODE_BLOCKING; break;
@@ -203,11 +548,13 @@ lv_libssh2_session_set_mode(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    int blocking = 0;
     switch (mode) {
-        case LV_LIBSSH2_SESSION_MODE_NONBLOCKING: libssh2_session_set_blocking(handle->inner, 0); break;
-        case LV_LIBSSH2_SESSION_MODE_BLOCKING: libssh2_session_set_blocking(handle->inner, 1); break;
+        case LV_LIBSSH2_SESSION_MODE_NONBLOCKING: blocking = 0; break;
+        case LV_LIBSSH2_SESSION_MODE_BLOCKING: blocking = 1; break;
         default: return LV_LIBSSH2_STATUS_ERROR_UNKNOWN_SESSION_MODE;
     }
+    lv_libssh2_session_apply_mode(handle, blocking);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -219,7 +566,9 @@ lv_libssh2_session_banner_len(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     const char* result = libssh2_session_banner_get(handle->inner);
+    lv_libssh2_session_unlock(handle);
     if (result == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_GENERIC;
     }
@@ -235,7 +584,9 @@ lv_libssh2_session_banner(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     const char* banner = libssh2_session_banner_get(handle->inner);
+    lv_libssh2_session_unlock(handle);
     if (banner == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_GENERIC;
     }
@@ -254,7 +605,9 @@ lv_libssh2_session_set_banner(
     if (banner == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     int result = libssh2_session_banner_set(handle->inner, banner);
+    lv_libssh2_session_unlock(handle);
     return lv_libssh2_status_from_result(result);
 }
 
@@ -266,7 +619,9 @@ lv_libssh2_session_block_directions(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     int result = libssh2_session_block_directions(handle->inner);
+    lv_libssh2_session_unlock(handle);
     switch (result) {
         case BLOCK_DIRECTIONS_BOTH:
             *directions = LV_LIBSSH2_SESSION_BLOCK_DIRECTIONS_BOTH;
@@ -283,6 +638,415 @@ lv_libssh2_session_block_directions(
     return LV_LIBSSH2_STATUS_OK;
 }
 
+void
+lv_libssh2_session_lock(
+    lv_libssh2_session_t* handle
+) {
+    if (handle->thread_safe) {
+        lv_libssh2_mutex_lock(&handle->lock);
+        handle->call_blocking = handle->blocking && nonblocking_depth == 0;
+        libssh2_session_set_blocking(handle->inner, handle->call_blocking);
+        handle->received_at_lock = handle->received;
+    } else if (handle->locking) {
+        lv_libssh2_mutex_lock(&handle->lock);
+    }
+}
+
+bool
+lv_libssh2_session_try_lock(
+    lv_libssh2_session_t* handle
+) {
+    if (!lv_libssh2_mutex_try_lock(&handle->lock)) {
+        return false;
+    }
+    if (handle->thread_safe) {
+        handle->received_at_lock = handle->received;
+    }
+    return true;
+}
+
+/**
+ * Tells the threads waiting on the session that a call received data, which
+ * is called with the lock held.
+ */
+static void
+lv_libssh2_session_notify(
+    lv_libssh2_session_t* handle
+) {
+    handle->generation++;
+    if (handle->waiters > 0) {
+        lv_libssh2_cond_broadcast(&handle->progress);
+    }
+    if (handle->polling) {
+        char byte = 0;
+        send(handle->wake[1], &byte, 1, 0);
+    }
+    if (handle->jump != NULL) {
+        lv_libssh2_jump_wake(handle->jump);
+    }
+}
+
+void
+lv_libssh2_session_unlock(
+    lv_libssh2_session_t* handle
+) {
+    if (handle->thread_safe) {
+        if (handle->received != handle->received_at_lock) {
+            lv_libssh2_session_notify(handle);
+        }
+        last_session = handle;
+        last_generation = handle->generation;
+        last_directions = libssh2_session_block_directions(handle->inner);
+        lv_libssh2_mutex_unlock(&handle->lock);
+    } else if (handle->locking) {
+        lv_libssh2_mutex_unlock(&handle->lock);
+    }
+}
+
+void
+lv_libssh2_session_lock_io(
+    lv_libssh2_session_t* handle
+) {
+    if (held_session == handle) {
+        held_session = NULL;
+        return;
+    }
+    lv_libssh2_session_lock(handle);
+    if (handle->thread_safe) {
+        libssh2_session_set_blocking(handle->inner, 0);
+    }
+}
+
+/**
+ * Waits with poll() until the socket is ready in the given directions or,
+ * if the wake socket is valid, a byte arrives on it.
+ */
+static lv_libssh2_status_t
+lv_libssh2_session_poll(
+    libssh2_socket_t socket,
+    libssh2_socket_t wake,
+    const int directions,
+    const uint64_t deadline_us
+) {
+    for (;;) {
+        if (deadline_us != LV_LIBSSH2_TIME_NO_DEADLINE && lv_libssh2_time_now_us() >= deadline_us) {
+            return LV_LIBSSH2_STATUS_ERROR_TIMEOUT;
+        }
+        lv_libssh2_pollfd_t fds[2];
+        size_t count = 1;
+        fds[0].fd = socket;
+        fds[0].events = 0;
+        fds[0].revents = 0;
+        if (directions & LIBSSH2_SESSION_BLOCK_INBOUND) {
+            fds[0].events |= POLLIN;
+        }
+        if (directions & LIBSSH2_SESSION_BLOCK_OUTBOUND) {
+            fds[0].events |= POLLOUT;
+        }
+        if (wake != LIBSSH2_INVALID_SOCKET) {
+            fds[1].fd = wake;
+            fds[1].events = POLLIN;
+            fds[1].revents = 0;
+            count = 2;
+        }
+        int result = lv_libssh2_poll(fds, count, lv_libssh2_time_remaining_ms(deadline_us));
+        if (result > 0) {
+            return LV_LIBSSH2_STATUS_OK;
+        }
+        if (result == 0) {
+            return LV_LIBSSH2_STATUS_ERROR_TIMEOUT;
+        }
+#ifdef _WIN32
+        if (WSAGetLastError() != WSAEINTR) {
+            return LV_LIBSSH2_STATUS_ERROR_BAD_SOCKET;
+        }
+#else
+        if (errno != EINTR) {
+            return LV_LIBSSH2_STATUS_ERROR_BAD_SOCKET;
+        }
+#endif
+    }
+}
+
+bool
+lv_libssh2_session_unlock_io(
+    lv_libssh2_session_t* handle,
+    ssize_t* result,
+    uint64_t* deadline_us
+) {
+    if (!handle->thread_safe || *result != LIBSSH2_ERROR_EAGAIN) {
+        lv_libssh2_session_unlock(handle);
+        return false;
+    }
+    int directions = libssh2_session_block_directions(handle->inner);
+    bool outbound = (directions & LIBSSH2_SESSION_BLOCK_OUTBOUND) != 0;
+    if (!outbound && !handle->call_blocking) {
+        lv_libssh2_session_unlock(handle);
+        return false;
+    }
+    if (*deadline_us == 0) {
+        long timeout_ms = libssh2_session_get_timeout(handle->inner);
+        *deadline_us = timeout_ms > 0 ? lv_libssh2_time_deadline_us((int32_t)timeout_ms) : LV_LIBSSH2_TIME_NO_DEADLINE;
+    }
+    lv_libssh2_status_t status = LV_LIBSSH2_STATUS_OK;
+    if (outbound) {
+        status = lv_libssh2_session_poll(
+            handle->socket,
+            LIBSSH2_INVALID_SOCKET,
+            LIBSSH2_SESSION_BLOCK_OUTBOUND,
+            *deadline_us
+        );
+        if (!lv_libssh2_status_is_err(status)) {
+            held_session = handle;
+            return true;
+        }
+        lv_libssh2_session_unlock(handle);
+    } else {
+        lv_libssh2_session_unlock(handle);
+        status = lv_libssh2_session_wait_socket(handle, *deadline_us);
+    }
+    if (status == LV_LIBSSH2_STATUS_ERROR_TIMEOUT) {
+        *result = LIBSSH2_ERROR_TIMEOUT;
+        return false;
+    }
+    if (lv_libssh2_status_is_err(status)) {
+        *result = LIBSSH2_ERROR_SOCKET_RECV;
+        return false;
+    }
+    return true;
+}
+
+int
+lv_libssh2_session_begin_nonblocking(
+    lv_libssh2_session_t* handle
+) {
+    nonblocking_depth++;
+    int blocking = libssh2_session_get_blocking(handle->inner);
+    libssh2_session_set_blocking(handle->inner, 0);
+    return blocking;
+}
+
+void
+lv_libssh2_session_end_nonblocking(
+    lv_libssh2_session_t* handle,
+    const int blocking
+) {
+    nonblocking_depth--;
+    libssh2_session_set_blocking(handle->inner, blocking);
+}
+
+void
+lv_libssh2_session_apply_mode(
+    lv_libssh2_session_t* handle,
+    const int blocking
+) {
+    lv_libssh2_session_lock(handle);
+    if (handle->thread_safe) {
+        handle->blocking = blocking;
+    } else {
+        libssh2_session_set_blocking(handle->inner, blocking);
+    }
+    lv_libssh2_session_unlock(handle);
+}
+
+/**
+ * Waits for the socket to become readable in thread safe mode, where several
+ * threads can be waiting at once. The first one polls the socket together with
+ * the wake socket, and the others wait until it returns or a call receives
+ * data, either of which starts a new generation.
+ */
+static lv_libssh2_status_t
+lv_libssh2_session_wait_shared(
+    lv_libssh2_session_t* handle,
+    const uint64_t deadline_us
+) {
+    lv_libssh2_mutex_lock(&handle->lock);
+    uint64_t generation = last_session == handle ? last_generation : handle->generation;
+    lv_libssh2_status_t status = LV_LIBSSH2_STATUS_OK;
+    while (handle->generation == generation) {
+        if (!handle->polling) {
+            handle->polling = true;
+            lv_libssh2_mutex_unlock(&handle->lock);
+            status = lv_libssh2_session_poll(
+                handle->socket,
+                handle->wake[0],
+                LIBSSH2_SESSION_BLOCK_INBOUND,
+                deadline_us
+            );
+            lv_libssh2_mutex_lock(&handle->lock);
+            char buffer[WAKE_DRAIN_SIZE];
+            while (recv(handle->wake[0], buffer, sizeof(buffer), 0) > 0) {}
+            handle->polling = false;
+            // Whatever woke the poller, the waiting threads retry their calls,
+            // and one of them takes over polling if there is still nothing.
+            handle->generation++;
+            if (handle->waiters > 0) {
+                lv_libssh2_cond_broadcast(&handle->progress);
+            }
+            break;
+        }
+        if (deadline_us != LV_LIBSSH2_TIME_NO_DEADLINE && lv_libssh2_time_now_us() >= deadline_us) {
+            status = LV_LIBSSH2_STATUS_ERROR_TIMEOUT;
+            break;
+        }
+        handle->waiters++;
+        lv_libssh2_cond_wait(&handle->progress, &handle->lock, deadline_us);
+        handle->waiters--;
+    }
+    lv_libssh2_mutex_unlock(&handle->lock);
+    return status;
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_wait_socket(
+    lv_libssh2_session_t* handle,
+    const uint64_t deadline_us
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (handle->socket == LIBSSH2_INVALID_SOCKET) {
+        return LV_LIBSSH2_STATUS_ERROR_SOCKET_NONE;
+    }
+    int directions = 0;
+    if (handle->thread_safe && last_session == handle) {
+        directions = last_directions;
+    } else {
+        lv_libssh2_session_lock(handle);
+        directions = libssh2_session_block_directions(handle->inner);
+        lv_libssh2_session_unlock(handle);
+    }
+    if (directions == 0) {
+        directions = LIBSSH2_SESSION_BLOCK_INBOUND;
+    }
+    if (handle->thread_safe && directions == LIBSSH2_SESSION_BLOCK_INBOUND) {
+        return lv_libssh2_session_wait_shared(handle, deadline_us);
+    }
+    return lv_libssh2_session_poll(handle->socket, LIBSSH2_INVALID_SOCKET, directions, deadline_us);
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_wait_socket_locked(
+    lv_libssh2_session_t* handle,
+    const uint64_t deadline_us
+) {
+    if (handle->socket == LIBSSH2_INVALID_SOCKET) {
+        return LV_LIBSSH2_STATUS_ERROR_SOCKET_NONE;
+    }
+    int directions = libssh2_session_block_directions(handle->inner);
+    if (directions == 0) {
+        directions = LIBSSH2_SESSION_BLOCK_INBOUND;
+    }
+    return lv_libssh2_session_poll(handle->socket, LIBSSH2_INVALID_SOCKET, directions, deadline_us);
+}
+
+/**
+ * Counts the bytes received from the socket, so the unlock can tell in thread
+ * safe mode whether a call may have queued packets for other channels, and the
+ * keepalive scheduler whether the peer answered.
+ */
+static ssize_t
+lv_libssh2_session_counting_recv(
+    libssh2_socket_t socket,
+    void* buffer,
+    size_t length,
+    int flags,
+    void** abstract
+) {
+    lv_libssh2_session_t* handle = *abstract;
+    ssize_t result = handle->recv(socket, buffer, length, flags, abstract);
+    if (result > 0) {
+        handle->received += result;
+    }
+    return result;
+}
+
+static lv_libssh2_session_recv_func_t
+lv_libssh2_session_set_recv(
+    lv_libssh2_session_t* handle,
+    lv_libssh2_session_recv_func_t recv_func
+) {
+#if LIBSSH2_VERSION_NUM >= 0x010b01
+    return (lv_libssh2_session_recv_func_t)libssh2_session_callback_set2(
+        handle->inner,
+        LIBSSH2_CALLBACK_RECV,
+        (libssh2_cb_generic*)recv_func
+    );
+#else
+    return (lv_libssh2_session_recv_func_t)libssh2_session_callback_set(
+        handle->inner,
+        LIBSSH2_CALLBACK_RECV,
+        (void*)recv_func
+    );
+#endif
+}
+
+void
+lv_libssh2_session_count_received(
+    lv_libssh2_session_t* handle
+) {
+    if (handle->recv != NULL) {
+        return;
+    }
+    handle->received = 0;
+    *libssh2_session_abstract(handle->inner) = handle;
+    handle->recv = lv_libssh2_session_set_recv(handle, lv_libssh2_session_counting_recv);
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_set_thread_safe(
+    lv_libssh2_session_t* handle,
+    const bool enabled
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (handle->thread_safe == enabled) {
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    if (!enabled && handle->jump != NULL) {
+        // The pump of the tunnels shares the session with the caller for as
+        // long as the session exists.
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    if (enabled) {
+        libssh2_socket_t wake[2];
+        lv_libssh2_status_t status = lv_libssh2_socket_pair(wake);
+        if (lv_libssh2_status_is_err(status)) {
+            return status;
+        }
+        lv_libssh2_socket_set_nonblocking(wake[0], true);
+        lv_libssh2_socket_set_nonblocking(wake[1], true);
+        lv_libssh2_mutex_lock(&handle->lock);
+        handle->wake[0] = wake[0];
+        handle->wake[1] = wake[1];
+        lv_libssh2_cond_init(&handle->progress);
+        handle->blocking = libssh2_session_get_blocking(handle->inner);
+        handle->generation = 0;
+        handle->waiters = 0;
+        handle->polling = false;
+        lv_libssh2_session_count_received(handle);
+        handle->thread_safe = true;
+        lv_libssh2_mutex_unlock(&handle->lock);
+    } else {
+        lv_libssh2_mutex_lock(&handle->lock);
+        handle->thread_safe = false;
+        // The keepalive scheduler keeps counting for as long as it locks.
+        if (!handle->locking) {
+            lv_libssh2_session_set_recv(handle, handle->recv);
+            handle->recv = NULL;
+        }
+        libssh2_session_set_blocking(handle->inner, handle->blocking);
+        lv_libssh2_socket_close(handle->wake[0]);
+        lv_libssh2_socket_close(handle->wake[1]);
+        handle->wake[0] = LIBSSH2_INVALID_SOCKET;
+        handle->wake[1] = LIBSSH2_INVALID_SOCKET;
+        lv_libssh2_cond_destroy(&handle->progress);
+        lv_libssh2_mutex_unlock(&handle->lock);
+    }
+    return LV_LIBSSH2_STATUS_OK;
+}
+
 lv_libssh2_status_t
 lv_libssh2_session_enable_option(
     lv_libssh2_session_t* handle,
@@ -295,7 +1059,9 @@ lv_libssh2_session_enable_option(
     switch (option) {
         case LV_LIBSSH2_SESSION_OPTIONS_SIGPIPE:
         case LV_LIBSSH2_SESSION_OPTIONS_COMPRESS:
+            lv_libssh2_session_lock(handle);
             result = libssh2_session_flag(handle->inner, option, 1);
+            lv_libssh2_session_unlock(handle);
             return lv_libssh2_status_from_result(result);
         default:
             return LV_LIBSSH2_STATUS_ERROR_UNKNOWN_SESSION_OPTION;
@@ -314,7 +1080,9 @@ lv_libssh2_session_disable_option(
     switch (option) {
         case LV_LIBSSH2_SESSION_OPTIONS_SIGPIPE:
         case LV_LIBSSH2_SESSION_OPTIONS_COMPRESS:
+            lv_libssh2_session_lock(handle);
             result = libssh2_session_flag(handle->inner, option, 0);
+            lv_libssh2_session_unlock(handle);
             return lv_libssh2_status_from_result(result);
         default:
             return LV_LIBSSH2_STATUS_ERROR_UNKNOWN_SESSION_OPTION;
@@ -329,7 +1097,9 @@ lv_libssh2_session_timeout(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     *milliseconds = libssh2_session_get_timeout(handle->inner);
+    lv_libssh2_session_unlock(handle);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -341,7 +1111,9 @@ lv_libssh2_session_set_timeout(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     libssh2_session_set_timeout(handle->inner, milliseconds);
+    lv_libssh2_session_unlock(handle);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -353,7 +1125,9 @@ lv_libssh2_session_last_error_code(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     *code = libssh2_session_last_errno(handle->inner);
+    lv_libssh2_session_unlock(handle);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -365,7 +1139,9 @@ lv_libssh2_session_last_error_len(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     libssh2_session_last_error(handle->inner, NULL, len, 0);
+    lv_libssh2_session_unlock(handle);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -377,7 +1153,9 @@ lv_libssh2_session_last_error(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     libssh2_session_last_error(handle->inner, &buffer, NULL, 1);
+    lv_libssh2_session_unlock(handle);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -390,7 +1168,9 @@ lv_libssh2_session_set_last_error(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     int result = libssh2_session_set_last_error(handle->inner, code, message);
+    lv_libssh2_session_unlock(handle);
     return lv_libssh2_status_from_result(result);
 }
 
@@ -406,7 +1186,12 @@ lv_libssh2_session_set_method_pref(
     if (prefs == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     int result = libssh2_session_method_pref(handle->inner, method, prefs);
+    lv_libssh2_session_unlock(handle);
+    if (result == 0 && method < 32) {
+        handle->method_prefs |= 1u << method;
+    }
     return lv_libssh2_status_from_result(result);
 }
 
@@ -419,7 +1204,9 @@ lv_libssh2_session_method_len(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     const char* actual = libssh2_session_methods(handle->inner, method);
+    lv_libssh2_session_unlock(handle);
     if (actual == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_SESSION_NOT_STARTED;
     }
@@ -436,7 +1223,9 @@ lv_libssh2_session_method(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     const char* actual = libssh2_session_methods(handle->inner, method);
+    lv_libssh2_session_unlock(handle);
     if (actual == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_SESSION_NOT_STARTED;
     }
@@ -444,3 +1233,82 @@ lv_libssh2_session_method(
     return LV_LIBSSH2_STATUS_OK;
 }
 
+/**
+ * Copies a string into a fixed-size field, truncating it to leave room for the
+ * NUL terminator, and returns the copied length.
+ */
+static size_t
+lv_libssh2_session_copy_string(
+    char* buffer,
+    const size_t size,
+    const char* value
+) {
+    if (value == NULL) {
+        return 0;
+    }
+    size_t len = strlen(value);
+    if (len >= size) {
+        len = size - 1;
+    }
+    memcpy(buffer, value, len);
+    buffer[len] = '\0';
+    return len;
+}
+
+lv_libssh2_status_t
+lv_libssh2_session_info(
+    lv_libssh2_session_t* handle,
+    lv_libssh2_session_info_t* info
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (info == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    memset(info, 0, sizeof(lv_libssh2_session_info_t));
+    lv_libssh2_session_lock(handle);
+    size_t hostkey_len = 0;
+    int hostkey_type = 0;
+    const char* hostkey = libssh2_session_hostkey(handle->inner, &hostkey_len, &hostkey_type);
+    if (hostkey == NULL) {
+        lv_libssh2_session_unlock(handle);
+        return LV_LIBSSH2_STATUS_ERROR_SESSION_NOT_STARTED;
+    }
+    if (hostkey_len > sizeof(info->hostkey)) {
+        lv_libssh2_session_unlock(handle);
+        return LV_LIBSSH2_STATUS_ERROR_OUT_OF_BOUNDARY;
+    }
+    memcpy(info->hostkey, hostkey, hostkey_len);
+    info->hostkey_len = (uint32_t)hostkey_len;
+    info->hostkey_type = lv_libssh2_session_hostkey_type(hostkey_type);
+    const char* hash = libssh2_hostkey_hash(handle->inner, LIBSSH2_HOSTKEY_HASH_MD5);
+    if (hash != NULL) {
+        memcpy(info->hostkey_md5, hash, sizeof(info->hostkey_md5));
+    }
+    hash = libssh2_hostkey_hash(handle->inner, LIBSSH2_HOSTKEY_HASH_SHA1);
+    if (hash != NULL) {
+        memcpy(info->hostkey_sha1, hash, sizeof(info->hostkey_sha1));
+    }
+    info->banner_len = (uint32_t)lv_libssh2_session_copy_string(
+        info->banner,
+        sizeof(info->banner),
+        libssh2_session_banner_get(handle->inner)
+    );
+    for (int method = 0; method < LV_LIBSSH2_SESSION_INFO_METHOD_COUNT; method++) {
+        lv_libssh2_session_copy_string(
+            info->methods[method],
+            sizeof(info->methods[method]),
+            libssh2_session_methods(handle->inner, method)
+        );
+    }
+    info->auth_list_len = (uint32_t)lv_libssh2_session_copy_string(
+        info->auth_list,
+        sizeof(info->auth_list),
+        handle->auth_list
+    );
+    info->authenticated = libssh2_userauth_authenticated(handle->inner) ? 1 : 0;
+    lv_libssh2_session_unlock(handle);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
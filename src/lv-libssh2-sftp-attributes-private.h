@@ -36,8 +36,13 @@
 
 #include "lv-libssh2.h"
 
+/**
+ * The attributes are stored with the wrapper, so creating attributes is a
+ * single allocation, and `inner` points to the `attributes` field.
+ */
 struct _lv_libssh2_sftp_attributes {
     LIBSSH2_SFTP_ATTRIBUTES* inner;
+    LIBSSH2_SFTP_ATTRIBUTES attributes;
 };
 
 #endif
@@ -48,12 +48,7 @@ lv_libssh2_sftp_attributes_create(
     if (attributes == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
-    LIBSSH2_SFTP_ATTRIBUTES* inner = malloc(sizeof(LIBSSH2_SFTP_ATTRIBUTES));
-    if (inner == NULL) {
-        free(attributes);
-        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
-    }
-    attributes->inner = inner;
+    attributes->inner = &attributes->attributes;
     *handle = attributes;
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -65,7 +60,6 @@ lv_libssh2_sftp_attributes_destroy(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
-    free(handle->inner);
     handle->inner = NULL;
     free(handle);
     return LV_LIBSSH2_STATUS_OK;
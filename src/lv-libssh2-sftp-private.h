@@ -38,17 +38,19 @@
 
 struct _lv_libssh2_sftp {
     LIBSSH2_SFTP* inner;
-    LIBSSH2_SESSION* session;
+    lv_libssh2_session_t* session;
 };
 
 struct _lv_libssh2_sftp_file {
     LIBSSH2_SFTP_HANDLE* inner;
     LIBSSH2_SFTP* sftp;
+    lv_libssh2_session_t* session;
 };
 
 struct _lv_libssh2_sftp_directory {
     LIBSSH2_SFTP_HANDLE* inner;
     LIBSSH2_SFTP* sftp;
+    lv_libssh2_session_t* session;
 };
 
 #endif
@@ -39,9 +39,13 @@
 
 #include "lv-libssh2.h"
 #include "lv-libssh2-status-private.h"
+#include "lv-libssh2-channel-pool-private.h"
+#include "lv-libssh2-memory-private.h"
+#include "lv-libssh2-profile-private.h"
 #include "lv-libssh2-session-private.h"
 #include "lv-libssh2-sftp-private.h"
 #include "lv-libssh2-sftp-attributes-private.h"
+#include "lv-libssh2-time-private.h"
 
 static lv_libssh2_status_t
 lv_libssh2_sftp_status_from_result(LIBSSH2_SFTP* sftp, int result) {
@@ -58,17 +62,26 @@ lv_libssh2_sftp_create(
     lv_libssh2_sftp_t** handle
 ) {
     *handle = NULL;
-    LIBSSH2_SFTP* inner = libssh2_sftp_init(session->inner);
+    lv_libssh2_session_lock(session);
+    LIBSSH2_SFTP* inner = NULL;
+    int error_code = lv_libssh2_channel_pool_settle(session);
+    if (error_code == 0) {
+        inner = libssh2_sftp_init(session->inner);
+        error_code = inner == NULL ? libssh2_session_last_errno(session->inner) : 0;
+    }
+    lv_libssh2_session_unlock(session);
     if (inner == NULL) {
-        return lv_libssh2_status_from_result(libssh2_session_last_errno(session->inner));
+        return lv_libssh2_status_from_result(error_code);
     }
-    lv_libssh2_sftp_t* sftp = malloc(sizeof(lv_libssh2_sftp_t));
+    lv_libssh2_sftp_t* sftp = lv_libssh2_memory_session_alloc(session, sizeof(lv_libssh2_sftp_t));
     if (sftp == NULL) {
+        lv_libssh2_session_lock(session);
         libssh2_sftp_shutdown(inner);
+        lv_libssh2_session_unlock(session);
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
     sftp->inner = inner;
-    sftp->session = session->inner;
+    sftp->session = session;
     *handle = sftp;
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -80,13 +93,16 @@ lv_libssh2_sftp_destroy(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_sftp_shutdown(handle->inner);
+    lv_libssh2_session_unlock(handle->session);
     if (result != 0) {
         return lv_libssh2_status_from_result(result);
     }
+    lv_libssh2_session_t* session = handle->session;
     handle->inner = NULL;
     handle->session = NULL;
-    free(handle);
+    lv_libssh2_memory_session_free(session, handle);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -117,6 +133,7 @@ lv_libssh2_sftp_open_file(
     if (path == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(sftp->session);
     LIBSSH2_SFTP_HANDLE* inner = libssh2_sftp_open_ex(
         sftp->inner,
         path,
@@ -125,16 +142,21 @@ lv_libssh2_sftp_open_file(
         (long)permissions,
         LIBSSH2_SFTP_OPENFILE
     );
+    int error_code = inner == NULL ? libssh2_session_last_errno(sftp->session->inner) : 0;
+    lv_libssh2_session_unlock(sftp->session);
     if (inner == NULL) {
-        int error_code = libssh2_session_last_errno(sftp->session);
         return lv_libssh2_sftp_status_from_result(sftp->inner, error_code);
     }
-    lv_libssh2_sftp_file_t* file = malloc(sizeof(lv_libssh2_sftp_file_t));
+    lv_libssh2_sftp_file_t* file = lv_libssh2_memory_session_alloc(sftp->session, sizeof(lv_libssh2_sftp_file_t));
     if (file == NULL) {
+        lv_libssh2_session_lock(sftp->session);
         libssh2_sftp_close_handle(inner);
+        lv_libssh2_session_unlock(sftp->session);
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
     file->inner = inner;
+    file->sftp = sftp->inner;
+    file->session = sftp->session;
     *handle = file;
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -146,12 +168,14 @@ lv_libssh2_sftp_close_file(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_sftp_close_handle(handle->inner);
+    lv_libssh2_session_unlock(handle->session);
     if (result != 0) {
         return lv_libssh2_sftp_status_from_result(handle->sftp, result);
     }
     handle->inner = NULL;
-    free(handle);
+    lv_libssh2_memory_session_free(handle->session, handle);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -168,6 +192,7 @@ lv_libssh2_sftp_open_directory(
     if (path == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(sftp->session);
     LIBSSH2_SFTP_HANDLE* inner = libssh2_sftp_open_ex(
         sftp->inner,
         path,
@@ -176,16 +201,21 @@ lv_libssh2_sftp_open_directory(
         0,
         LIBSSH2_SFTP_OPENDIR
     );
+    int error_code = inner == NULL ? libssh2_session_last_errno(sftp->session->inner) : 0;
+    lv_libssh2_session_unlock(sftp->session);
     if (inner == NULL) {
-        int error_code = libssh2_session_last_errno(sftp->session);
         return lv_libssh2_sftp_status_from_result(sftp->inner, error_code);
     }
-    lv_libssh2_sftp_directory_t* directory = malloc(sizeof(lv_libssh2_sftp_directory_t));
+    lv_libssh2_sftp_directory_t* directory = lv_libssh2_memory_session_alloc(sftp->session, sizeof(lv_libssh2_sftp_directory_t));
     if (directory == NULL) {
+        lv_libssh2_session_lock(sftp->session);
         libssh2_sftp_close_handle(inner);
+        lv_libssh2_session_unlock(sftp->session);
         return LV_LIBSSH2_STATUS_ERROR_MALLOC;
     }
     directory->inner = inner;
+    directory->sftp = sftp->inner;
+    directory->session = sftp->session;
     *handle = directory;
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -197,13 +227,15 @@ lv_libssh2_sftp_close_directory(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_sftp_close_handle(handle->inner);
+    lv_libssh2_session_unlock(handle->session);
     if (result != 0) {
         return lv_libssh2_sftp_status_from_result(handle->sftp, result);
     }
     handle->inner = NULL;
     handle->sftp = NULL;
-    free(handle);
+    lv_libssh2_memory_session_free(handle->session, handle);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -223,7 +255,16 @@ lv_libssh2_sftp_read_file(
     if (read_count == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
-    ssize_t count = libssh2_sftp_read(handle->inner, (char*)buffer, buffer_max_length);
+    uint64_t start = lv_libssh2_time_now_us();
+    uint64_t deadline = 0;
+    ssize_t count = 0;
+    do {
+        lv_libssh2_session_lock_io(handle->session);
+        count = libssh2_sftp_read(handle->inner, (char*)buffer, buffer_max_length);
+        if (count > 0) {
+            lv_libssh2_profile_record(handle->session, buffer, (size_t)count, start);
+        }
+    } while (lv_libssh2_session_unlock_io(handle->session, &count, &deadline));
     if (count < 0) {
         return lv_libssh2_sftp_status_from_result(handle->sftp, (int)count);
     }
@@ -251,6 +292,7 @@ lv_libssh2_sftp_read_directory(
     if (read_count == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     ssize_t count = libssh2_sftp_readdir_ex(
         handle->inner,
         (char*)buffer,
@@ -259,6 +301,7 @@ lv_libssh2_sftp_read_directory(
         0,
         attributes->inner
     );
+    lv_libssh2_session_unlock(handle->session);
     if (count < 0) {
         return lv_libssh2_sftp_status_from_result(handle->sftp, (int)count);
     }
@@ -279,11 +322,20 @@ lv_libssh2_sftp_write_file(
     if (buffer == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
-    ssize_t count = libssh2_sftp_write(
-        handle->inner,
-        (char*)buffer,
-        buffer_length
-    );
+    uint64_t start = lv_libssh2_time_now_us();
+    uint64_t deadline = 0;
+    ssize_t count = 0;
+    do {
+        lv_libssh2_session_lock_io(handle->session);
+        count = libssh2_sftp_write(
+            handle->inner,
+            (char*)buffer,
+            buffer_length
+        );
+        if (count > 0) {
+            lv_libssh2_profile_record(handle->session, buffer, (size_t)count, start);
+        }
+    } while (lv_libssh2_session_unlock_io(handle->session, &count, &deadline));
     if (count < 0) {
         return lv_libssh2_sftp_status_from_result(handle->sftp, (int)count);
     }
@@ -298,7 +350,9 @@ lv_libssh2_sftp_file_sync(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_sftp_fsync(handle->inner);
+    lv_libssh2_session_unlock(handle->session);
     return lv_libssh2_sftp_status_from_result(handle->sftp, result);
 }
 
@@ -310,7 +364,9 @@ lv_libssh2_sftp_file_seek(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     libssh2_sftp_seek64(handle->inner, offset);
+    lv_libssh2_session_unlock(handle->session);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -321,7 +377,9 @@ lv_libssh2_sftp_file_rewind(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     libssh2_sftp_seek64(handle->inner, 0);
+    lv_libssh2_session_unlock(handle->session);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -349,7 +407,9 @@ lv_libssh2_sftp_file_status(
     if (attributes == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_sftp_fstat_ex(handle->inner, attributes->inner, 0);
+    lv_libssh2_session_unlock(handle->session);
     return lv_libssh2_sftp_status_from_result(handle->sftp, result);
 }
 
@@ -364,7 +424,9 @@ lv_libssh2_sftp_file_set_status(
     if (attributes == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_sftp_fstat_ex(handle->inner, attributes->inner, 1);
+    lv_libssh2_session_unlock(handle->session);
     return lv_libssh2_sftp_status_from_result(handle->sftp, result);
 }
 
@@ -383,6 +445,7 @@ lv_libssh2_sftp_link_status(
     if (attributes == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_sftp_stat_ex(
         handle->inner,
         path,
@@ -390,6 +453,7 @@ lv_libssh2_sftp_link_status(
         LIBSSH2_SFTP_LSTAT,
         attributes->inner
     );
+    lv_libssh2_session_unlock(handle->session);
     if (result != 0) {
         return lv_libssh2_sftp_status_from_result(handle->inner, result);
     }
@@ -412,6 +476,7 @@ lv_libssh2_sftp_file_rename(
     if (destination_path == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_sftp_rename_ex(
         handle->inner,
         source_path,
@@ -420,6 +485,7 @@ lv_libssh2_sftp_file_rename(
         (unsigned int)strlen(destination_path),
         (long)options
     );
+    lv_libssh2_session_unlock(handle->session);
     if (result != 0) {
         return lv_libssh2_sftp_status_from_result(handle->inner, result);
     }
@@ -437,11 +503,13 @@ lv_libssh2_sftp_delete_file(
     if (file_path == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_sftp_unlink_ex(
         handle->inner,
         file_path,
         (unsigned int)strlen(file_path)
     );
+    lv_libssh2_session_unlock(handle->session);
     if (result != 0) {
         return lv_libssh2_sftp_status_from_result(handle->inner, result);
     }
@@ -460,12 +528,14 @@ lv_libssh2_sftp_create_directory(
     if (directory_path == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_sftp_mkdir_ex(
         handle->inner,
         directory_path,
         (unsigned int)strlen(directory_path),
         permissions
     );
+    lv_libssh2_session_unlock(handle->session);
     if (result != 0) {
         return lv_libssh2_sftp_status_from_result(handle->inner, result);
     }
@@ -483,11 +553,13 @@ lv_libssh2_sftp_delete_directory(
     if (directory_path == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_sftp_rmdir_ex(
         handle->inner,
         directory_path,
         (unsigned int)strlen(directory_path)
     );
+    lv_libssh2_session_unlock(handle->session);
     if (result != 0) {
         return lv_libssh2_sftp_status_from_result(handle->inner, result);
     }
@@ -509,6 +581,7 @@ lv_libssh2_sftp_create_link(
     if (link_path == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_sftp_symlink_ex(
         handle->inner,
         source_path,
@@ -517,6 +590,7 @@ lv_libssh2_sftp_create_link(
         (unsigned int)strlen(link_path),
         LIBSSH2_SFTP_SYMLINK
     );
+    lv_libssh2_session_unlock(handle->session);
     if (result != 0) {
         return lv_libssh2_sftp_status_from_result(handle->inner, result);
     }
@@ -544,6 +618,7 @@ lv_libssh2_sftp_resolve_symbolic_link(
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
     *read_count = 0;
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_sftp_symlink_ex(
         handle->inner,
         link_path,
@@ -552,6 +627,7 @@ lv_libssh2_sftp_resolve_symbolic_link(
         (unsigned int)source_path_max_length,
         LIBSSH2_SFTP_READLINK
     );
+    lv_libssh2_session_unlock(handle->session);
     if (result < 0) {
         return lv_libssh2_sftp_status_from_result(handle->inner, result);
     }
@@ -580,6 +656,7 @@ lv_libssh2_sftp_resolve_real_link(
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
     *read_count = 0;
+    lv_libssh2_session_lock(handle->session);
     int result = libssh2_sftp_symlink_ex(
         handle->inner,
         link_path,
@@ -588,6 +665,7 @@ lv_libssh2_sftp_resolve_real_link(
         (unsigned int)source_path_max_length,
         LIBSSH2_SFTP_REALPATH
     );
+    lv_libssh2_session_unlock(handle->session);
     if (result < 0) {
         return lv_libssh2_sftp_status_from_result(handle->inner, result);
     }
@@ -0,0 +1,186 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#ifndef LV_LIBSSH2_SOCKET_PRIVATE_H
+#define LV_LIBSSH2_SOCKET_PRIVATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <poll.h>
+#endif
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+
+/**
+ * poll() on every platform, which unlike select() works for any socket
+ * number. The timeout is in milliseconds, where -1 waits forever.
+ */
+#ifdef _WIN32
+typedef WSAPOLLFD lv_libssh2_pollfd_t;
+#define lv_libssh2_poll(fds, count, timeout) WSAPoll((fds), (ULONG)(count), (timeout))
+#else
+typedef struct pollfd lv_libssh2_pollfd_t;
+#define lv_libssh2_poll(fds, count, timeout) poll((fds), (nfds_t)(count), (timeout))
+#endif
+
+/**
+ * Opens a TCP connection to the host.
+ *
+ * The host name is resolved through a small process-wide cache. When it has
+ * both IPv4 and IPv6 addresses, the families are interleaved and a new
+ * attempt is started every `attempt_delay_ms` while earlier attempts are still
+ * pending, so an unreachable family does not stall the connection. The first
+ * attempt to complete wins and the rest are closed. The options are applied
+ * before connecting, so the buffer sizes are used for the TCP window scale.
+ *
+ * The returned socket is in blocking mode. A NULL `options` enables
+ * `TCP_NODELAY` and keepalive with the system defaults for everything else.
+ */
+lv_libssh2_status_t
+lv_libssh2_socket_connect(
+    const char* host,
+    const uint16_t port,
+    const lv_libssh2_socket_options_t* options,
+    const uint64_t deadline_us,
+    libssh2_socket_t* handle
+);
+
+void
+lv_libssh2_socket_close(
+    libssh2_socket_t handle
+);
+
+void
+lv_libssh2_socket_set_nonblocking(
+    libssh2_socket_t handle,
+    const bool nonblocking
+);
+
+/**
+ * Creates a pair of connected stream sockets in blocking mode. On Windows,
+ * which has no socket pairs, the pair is a TCP connection over the loopback
+ * interface.
+ */
+lv_libssh2_status_t
+lv_libssh2_socket_pair(
+    libssh2_socket_t pair[2]
+);
+
+/**
+ * Gets the number of bytes from the peer that are waiting to be read, or zero
+ * if that cannot be determined.
+ */
+size_t
+lv_libssh2_socket_pending(
+    libssh2_socket_t handle
+);
+
+/**
+ * Checks without blocking whether the socket can take more data to send.
+ */
+bool
+lv_libssh2_socket_is_writable(
+    libssh2_socket_t handle
+);
+
+/**
+ * Checks without blocking whether the peer has closed or reset the connection.
+ * A connection that failed counts as closed even with unread data on the
+ * socket, whereas an orderly close only counts once that data has been read.
+ */
+bool
+lv_libssh2_socket_is_closed(
+    libssh2_socket_t handle
+);
+
+/**
+ * Sets how long sent data may remain unacknowledged before the connection is
+ * dropped, so a dead peer is detected after a few unanswered keepalives rather
+ * than the system retransmission timeout. A timeout of zero restores the system
+ * default. This is skipped on platforms without a socket option for it.
+ */
+void
+lv_libssh2_socket_set_user_timeout(
+    libssh2_socket_t handle,
+    const uint32_t timeout_ms
+);
+
+/**
+ * Shuts down both directions of the connection without closing the socket, so
+ * any blocked or later operations on it fail immediately.
+ */
+void
+lv_libssh2_socket_shutdown(
+    libssh2_socket_t handle
+);
+
+/**
+ * Shuts down the sending direction of the connection, so the peer reads the
+ * end of the stream once it has read everything sent before.
+ */
+void
+lv_libssh2_socket_shutdown_send(
+    libssh2_socket_t handle
+);
+
+/**
+ * Sends without raising SIGPIPE if the peer has closed the connection, which
+ * fails with an error instead.
+ */
+ssize_t
+lv_libssh2_socket_send(
+    libssh2_socket_t handle,
+    const char* buffer,
+    const size_t len
+);
+
+/**
+ * Gets whether the last failed send or receive only failed because the socket
+ * is non-blocking and not ready, or was interrupted, rather than broken.
+ */
+bool
+lv_libssh2_socket_would_block();
+
+/**
+ * Forgets all of the cached host name resolutions.
+ */
+void
+lv_libssh2_socket_clear_cache();
+
+#endif
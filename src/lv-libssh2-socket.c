@@ -0,0 +1,630 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "libssh2.h"
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-status-private.h"
+#include "lv-libssh2-socket-private.h"
+#include "lv-libssh2-thread-private.h"
+#include "lv-libssh2-time-private.h"
+
+#define DNS_CACHE_SIZE 16
+#define DNS_CACHE_TTL_US 60000000
+#define MAX_ADDRESSES 8
+#define MAX_HOST_LEN 255
+#define DEFAULT_ATTEMPT_DELAY_MS 250
+
+typedef struct _lv_libssh2_socket_address {
+    struct sockaddr_storage storage;
+    socklen_t len;
+} lv_libssh2_socket_address_t;
+
+typedef struct _lv_libssh2_dns_entry {
+    char host[MAX_HOST_LEN + 1];
+    uint64_t expires_us;
+    uint64_t used_us;
+    size_t address_count;
+    lv_libssh2_socket_address_t addresses[MAX_ADDRESSES];
+} lv_libssh2_dns_entry_t;
+
+static const lv_libssh2_socket_options_t DEFAULT_OPTIONS = {
+    .send_buffer_size = 0,
+    .receive_buffer_size = 0,
+    .keepalive_idle_s = 0,
+    .keepalive_interval_s = 0,
+    .attempt_delay_ms = 0,
+    .no_delay = 1,
+    .keepalive = 1,
+};
+
+static lv_libssh2_dns_entry_t dns_cache[DNS_CACHE_SIZE];
+static lv_libssh2_mutex_t dns_cache_mutex = LV_LIBSSH2_MUTEX_INITIALIZER;
+
+static bool
+lv_libssh2_socket_cache_get(
+    const char* host,
+    lv_libssh2_socket_address_t* addresses,
+    size_t* address_count
+) {
+    bool found = false;
+    uint64_t now = lv_libssh2_time_now_us();
+    lv_libssh2_mutex_lock(&dns_cache_mutex);
+    for (size_t i = 0; i < DNS_CACHE_SIZE; i++) {
+        lv_libssh2_dns_entry_t* entry = &dns_cache[i];
+        if (entry->address_count > 0 && entry->expires_us > now && strcmp(entry->host, host) == 0) {
+            memcpy(addresses, entry->addresses, entry->address_count * sizeof(lv_libssh2_socket_address_t));
+            *address_count = entry->address_count;
+            entry->used_us = now;
+            found = true;
+            break;
+        }
+    }
+    lv_libssh2_mutex_unlock(&dns_cache_mutex);
+    return found;
+}
+
+/**
+ * Stores the addresses for the host, replacing an entry for the same host, an
+ * expired entry, or the least recently used entry, in that order.
+ */
+static void
+lv_libssh2_socket_cache_put(
+    const char* host,
+    const lv_libssh2_socket_address_t* addresses,
+    const size_t address_count
+) {
+    uint64_t now = lv_libssh2_time_now_us();
+    lv_libssh2_mutex_lock(&dns_cache_mutex);
+    lv_libssh2_dns_entry_t* slot = &dns_cache[0];
+    for (size_t i = 0; i < DNS_CACHE_SIZE; i++) {
+        lv_libssh2_dns_entry_t* entry = &dns_cache[i];
+        if (entry->address_count > 0 && strcmp(entry->host, host) == 0) {
+            slot = entry;
+            break;
+        }
+        if (entry->address_count == 0 || entry->expires_us <= now) {
+            slot = entry;
+        } else if (slot->address_count > 0 && slot->expires_us > now && entry->used_us < slot->used_us) {
+            slot = entry;
+        }
+    }
+    strcpy(slot->host, host);
+    memcpy(slot->addresses, addresses, address_count * sizeof(lv_libssh2_socket_address_t));
+    slot->address_count = address_count;
+    slot->expires_us = now + DNS_CACHE_TTL_US;
+    slot->used_us = now;
+    lv_libssh2_mutex_unlock(&dns_cache_mutex);
+}
+
+static void
+lv_libssh2_socket_cache_remove(
+    const char* host
+) {
+    lv_libssh2_mutex_lock(&dns_cache_mutex);
+    for (size_t i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (dns_cache[i].address_count > 0 && strcmp(dns_cache[i].host, host) == 0) {
+            dns_cache[i].address_count = 0;
+        }
+    }
+    lv_libssh2_mutex_unlock(&dns_cache_mutex);
+}
+
+void
+lv_libssh2_socket_clear_cache()
+{
+    lv_libssh2_mutex_lock(&dns_cache_mutex);
+    memset(dns_cache, 0, sizeof(dns_cache));
+    lv_libssh2_mutex_unlock(&dns_cache_mutex);
+}
+
+/**
+ * Resolves the host, ordering the addresses so the families alternate,
+ * starting with the family the system resolver prefers.
+ */
+static lv_libssh2_status_t
+lv_libssh2_socket_resolve(
+    const char* host,
+    lv_libssh2_socket_address_t* addresses,
+    size_t* address_count
+) {
+    bool cacheable = strlen(host) <= MAX_HOST_LEN;
+    if (cacheable && lv_libssh2_socket_cache_get(host, addresses, address_count)) {
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+    struct addrinfo* results = NULL;
+    if (getaddrinfo(host, NULL, &hints, &results) != 0 || results == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_HOST_NOT_FOUND;
+    }
+    const struct addrinfo* preferred[MAX_ADDRESSES];
+    const struct addrinfo* others[MAX_ADDRESSES];
+    size_t preferred_count = 0;
+    size_t other_count = 0;
+    for (const struct addrinfo* result = results; result != NULL; result = result->ai_next) {
+        if (result->ai_addrlen > sizeof(struct sockaddr_storage)) {
+            continue;
+        }
+        if (result->ai_family == results->ai_family) {
+            if (preferred_count < MAX_ADDRESSES) {
+                preferred[preferred_count++] = result;
+            }
+        } else if (other_count < MAX_ADDRESSES) {
+            others[other_count++] = result;
+        }
+    }
+    size_t count = 0;
+    for (size_t i = 0; count < MAX_ADDRESSES && (i < preferred_count || i < other_count); i++) {
+        if (i < preferred_count) {
+            memcpy(&addresses[count].storage, preferred[i]->ai_addr, preferred[i]->ai_addrlen);
+            addresses[count].len = (socklen_t)preferred[i]->ai_addrlen;
+            count++;
+        }
+        if (i < other_count && count < MAX_ADDRESSES) {
+            memcpy(&addresses[count].storage, others[i]->ai_addr, others[i]->ai_addrlen);
+            addresses[count].len = (socklen_t)others[i]->ai_addrlen;
+            count++;
+        }
+    }
+    freeaddrinfo(results);
+    if (count == 0) {
+        return LV_LIBSSH2_STATUS_ERROR_HOST_NOT_FOUND;
+    }
+    if (cacheable) {
+        lv_libssh2_socket_cache_put(host, addresses, count);
+    }
+    *address_count = count;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+void
+lv_libssh2_socket_set_nonblocking(
+    libssh2_socket_t handle,
+    const bool nonblocking
+) {
+#ifdef _WIN32
+    u_long mode = nonblocking ? 1 : 0;
+    ioctlsocket(handle, FIONBIO, &mode);
+#else
+    int flags = fcntl(handle, F_GETFL, 0);
+    fcntl(handle, F_SETFL, nonblocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK);
+#endif
+}
+
+static void
+lv_libssh2_socket_set_option(
+    libssh2_socket_t handle,
+    const int level,
+    const int name,
+    const int value
+) {
+    setsockopt(handle, level, name, (const char*)&value, sizeof(value));
+}
+
+/**
+ * Applies the options to a socket that is not yet connected. The options are
+ * only hints, so failures are ignored, and keepalive times are skipped on
+ * platforms without a socket option for them.
+ */
+static void
+lv_libssh2_socket_configure(
+    libssh2_socket_t handle,
+    const lv_libssh2_socket_options_t* options
+) {
+    lv_libssh2_socket_set_option(handle, IPPROTO_TCP, TCP_NODELAY, options->no_delay ? 1 : 0);
+    if (options->send_buffer_size > 0) {
+        lv_libssh2_socket_set_option(handle, SOL_SOCKET, SO_SNDBUF, options->send_buffer_size);
+    }
+    if (options->receive_buffer_size > 0) {
+        lv_libssh2_socket_set_option(handle, SOL_SOCKET, SO_RCVBUF, options->receive_buffer_size);
+    }
+    if (!options->keepalive) {
+        return;
+    }
+    lv_libssh2_socket_set_option(handle, SOL_SOCKET, SO_KEEPALIVE, 1);
+    if (options->keepalive_idle_s > 0) {
+#if defined(TCP_KEEPIDLE)
+        lv_libssh2_socket_set_option(handle, IPPROTO_TCP, TCP_KEEPIDLE, options->keepalive_idle_s);
+#elif defined(TCP_KEEPALIVE)
+        lv_libssh2_socket_set_option(handle, IPPROTO_TCP, TCP_KEEPALIVE, options->keepalive_idle_s);
+#endif
+    }
+    if (options->keepalive_interval_s > 0) {
+#if defined(TCP_KEEPINTVL)
+        lv_libssh2_socket_set_option(handle, IPPROTO_TCP, TCP_KEEPINTVL, options->keepalive_interval_s);
+#endif
+    }
+}
+
+/**
+ * Starts a non-blocking connect to the address. An invalid socket is returned
+ * if the attempt failed immediately.
+ */
+static libssh2_socket_t
+lv_libssh2_socket_start(
+    lv_libssh2_socket_address_t* address,
+    const uint16_t port,
+    const lv_libssh2_socket_options_t* options,
+    bool* connected
+) {
+    *connected = false;
+    if (address->storage.ss_family == AF_INET6) {
+        ((struct sockaddr_in6*)&address->storage)->sin6_port = htons(port);
+    } else {
+        ((struct sockaddr_in*)&address->storage)->sin_port = htons(port);
+    }
+    libssh2_socket_t handle = socket(address->storage.ss_family, SOCK_STREAM, IPPROTO_TCP);
+    if (handle == LIBSSH2_INVALID_SOCKET) {
+        return LIBSSH2_INVALID_SOCKET;
+    }
+    lv_libssh2_socket_configure(handle, options);
+    lv_libssh2_socket_set_nonblocking(handle, true);
+    if (connect(handle, (struct sockaddr*)&address->storage, address->len) == 0) {
+        *connected = true;
+        return handle;
+    }
+#ifdef _WIN32
+    bool pending = WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    bool pending = errno == EINPROGRESS || errno == EINTR;
+#endif
+    if (!pending) {
+        lv_libssh2_socket_close(handle);
+        return LIBSSH2_INVALID_SOCKET;
+    }
+    return handle;
+}
+
+lv_libssh2_status_t
+lv_libssh2_socket_connect(
+    const char* host,
+    const uint16_t port,
+    const lv_libssh2_socket_options_t* options,
+    const uint64_t deadline_us,
+    libssh2_socket_t* handle
+) {
+    *handle = LIBSSH2_INVALID_SOCKET;
+    if (options == NULL) {
+        options = &DEFAULT_OPTIONS;
+    }
+    lv_libssh2_socket_address_t addresses[MAX_ADDRESSES];
+    size_t address_count = 0;
+    lv_libssh2_status_t status = lv_libssh2_socket_resolve(host, addresses, &address_count);
+    if (lv_libssh2_status_is_err(status)) {
+        return status;
+    }
+    uint64_t attempt_delay_us = (uint64_t)(options->attempt_delay_ms > 0 ? options->attempt_delay_ms : DEFAULT_ATTEMPT_DELAY_MS) * 1000;
+    libssh2_socket_t attempts[MAX_ADDRESSES];
+    size_t started = 0;
+    uint64_t next_attempt_us = 0;
+    libssh2_socket_t winner = LIBSSH2_INVALID_SOCKET;
+    status = LV_LIBSSH2_STATUS_ERROR_CONNECT_FAILED;
+    for (;;) {
+        uint64_t now = lv_libssh2_time_now_us();
+        size_t pending = 0;
+        for (size_t i = 0; i < started; i++) {
+            if (attempts[i] != LIBSSH2_INVALID_SOCKET) {
+                pending++;
+            }
+        }
+        if (started < address_count && (pending == 0 || now >= next_attempt_us)) {
+            bool connected = false;
+            attempts[started] = lv_libssh2_socket_start(&addresses[started], port, options, &connected);
+            started++;
+            next_attempt_us = now + attempt_delay_us;
+            if (connected) {
+                winner = attempts[started - 1];
+                attempts[started - 1] = LIBSSH2_INVALID_SOCKET;
+                break;
+            }
+            continue;
+        }
+        if (pending == 0) {
+            break;
+        }
+        if (now >= deadline_us) {
+            status = LV_LIBSSH2_STATUS_ERROR_TIMEOUT;
+            break;
+        }
+        uint64_t wake_us = deadline_us;
+        if (started < address_count && next_attempt_us < wake_us) {
+            wake_us = next_attempt_us;
+        }
+        lv_libssh2_pollfd_t fds[MAX_ADDRESSES];
+        size_t indices[MAX_ADDRESSES];
+        size_t count = 0;
+        for (size_t i = 0; i < started; i++) {
+            if (attempts[i] != LIBSSH2_INVALID_SOCKET) {
+                fds[count].fd = attempts[i];
+                fds[count].events = POLLOUT;
+                fds[count].revents = 0;
+                indices[count] = i;
+                count++;
+            }
+        }
+        int ready = lv_libssh2_poll(fds, count, lv_libssh2_time_remaining_ms(wake_us));
+        if (ready < 0) {
+#ifndef _WIN32
+            if (errno == EINTR) {
+                continue;
+            }
+#endif
+            break;
+        }
+        for (size_t j = 0; j < count && winner == LIBSSH2_INVALID_SOCKET; j++) {
+            if (fds[j].revents == 0) {
+                continue;
+            }
+            size_t i = indices[j];
+            int error = 0;
+            socklen_t error_len = sizeof(error);
+            if (getsockopt(attempts[i], SOL_SOCKET, SO_ERROR, (char*)&error, &error_len) == 0
+                && error == 0 && (fds[j].revents & (POLLERR | POLLHUP)) == 0) {
+                winner = attempts[i];
+            } else {
+                lv_libssh2_socket_close(attempts[i]);
+                next_attempt_us = now;
+            }
+            attempts[i] = LIBSSH2_INVALID_SOCKET;
+        }
+        if (winner != LIBSSH2_INVALID_SOCKET) {
+            break;
+        }
+    }
+    for (size_t i = 0; i < started; i++) {
+        if (attempts[i] != LIBSSH2_INVALID_SOCKET) {
+            lv_libssh2_socket_close(attempts[i]);
+        }
+    }
+    if (winner == LIBSSH2_INVALID_SOCKET) {
+        if (status == LV_LIBSSH2_STATUS_ERROR_CONNECT_FAILED) {
+            lv_libssh2_socket_cache_remove(host);
+        }
+        return status;
+    }
+    lv_libssh2_socket_set_nonblocking(winner, false);
+    *handle = winner;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+void
+lv_libssh2_socket_close(
+    libssh2_socket_t handle
+) {
+#ifdef _WIN32
+    closesocket(handle);
+#else
+    close(handle);
+#endif
+}
+
+size_t
+lv_libssh2_socket_pending(
+    libssh2_socket_t handle
+) {
+    if (handle == LIBSSH2_INVALID_SOCKET) {
+        return 0;
+    }
+#ifdef _WIN32
+    u_long pending = 0;
+    if (ioctlsocket(handle, FIONREAD, &pending) != 0) {
+        return 0;
+    }
+#else
+    int pending = 0;
+    if (ioctl(handle, FIONREAD, &pending) != 0 || pending < 0) {
+        return 0;
+    }
+#endif
+    return (size_t)pending;
+}
+
+bool
+lv_libssh2_socket_is_writable(
+    libssh2_socket_t handle
+) {
+    if (handle == LIBSSH2_INVALID_SOCKET) {
+        return false;
+    }
+    lv_libssh2_pollfd_t fd;
+    fd.fd = handle;
+    fd.events = POLLOUT;
+    fd.revents = 0;
+    return lv_libssh2_poll(&fd, 1, 0) > 0 && (fd.revents & POLLOUT) != 0;
+}
+
+bool
+lv_libssh2_socket_is_closed(
+    libssh2_socket_t handle
+) {
+    if (handle == LIBSSH2_INVALID_SOCKET) {
+        return true;
+    }
+    lv_libssh2_pollfd_t fd;
+    fd.fd = handle;
+    fd.events = POLLIN;
+    fd.revents = 0;
+    int ready = lv_libssh2_poll(&fd, 1, 0);
+    if (ready <= 0) {
+        return ready < 0;
+    }
+    // A reset or timed out connection still reports its unread data to a peek,
+    // so the error has to be taken from the poll instead.
+    if (fd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        return true;
+    }
+    char byte = 0;
+    int result = (int)recv(handle, &byte, 1, MSG_PEEK);
+    if (result > 0) {
+        return false;
+    }
+    if (result == 0) {
+        return true;
+    }
+    return !lv_libssh2_socket_would_block();
+}
+
+bool
+lv_libssh2_socket_would_block()
+{
+#ifdef _WIN32
+    int error = WSAGetLastError();
+    return error == WSAEWOULDBLOCK || error == WSAEINTR;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+lv_libssh2_status_t
+lv_libssh2_socket_pair(
+    libssh2_socket_t pair[2]
+) {
+#ifdef _WIN32
+    // There are no socket pairs on Windows, so a connection is made through a
+    // listener on the loopback interface that only exists for this purpose.
+    pair[0] = LIBSSH2_INVALID_SOCKET;
+    pair[1] = LIBSSH2_INVALID_SOCKET;
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener == INVALID_SOCKET) {
+        return LV_LIBSSH2_STATUS_ERROR_BAD_SOCKET;
+    }
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    int address_len = sizeof(address);
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0
+        || getsockname(listener, (struct sockaddr*)&address, &address_len) != 0
+        || listen(listener, 1) != 0) {
+        closesocket(listener);
+        return LV_LIBSSH2_STATUS_ERROR_BAD_SOCKET;
+    }
+    pair[0] = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (pair[0] == INVALID_SOCKET || connect(pair[0], (struct sockaddr*)&address, sizeof(address)) != 0) {
+        if (pair[0] != INVALID_SOCKET) {
+            closesocket(pair[0]);
+        }
+        closesocket(listener);
+        return LV_LIBSSH2_STATUS_ERROR_BAD_SOCKET;
+    }
+    pair[1] = accept(listener, NULL, NULL);
+    closesocket(listener);
+    if (pair[1] == INVALID_SOCKET) {
+        closesocket(pair[0]);
+        return LV_LIBSSH2_STATUS_ERROR_BAD_SOCKET;
+    }
+    lv_libssh2_socket_set_option(pair[0], IPPROTO_TCP, TCP_NODELAY, 1);
+    lv_libssh2_socket_set_option(pair[1], IPPROTO_TCP, TCP_NODELAY, 1);
+#else
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return LV_LIBSSH2_STATUS_ERROR_BAD_SOCKET;
+    }
+    pair[0] = fds[0];
+    pair[1] = fds[1];
+#endif
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+void
+lv_libssh2_socket_set_user_timeout(
+    libssh2_socket_t handle,
+    const uint32_t timeout_ms
+) {
+#if defined(TCP_USER_TIMEOUT)
+    lv_libssh2_socket_set_option(handle, IPPROTO_TCP, TCP_USER_TIMEOUT, (int)timeout_ms);
+#elif defined(TCP_MAXRT)
+    lv_libssh2_socket_set_option(handle, IPPROTO_TCP, TCP_MAXRT, (int)((timeout_ms + 999) / 1000));
+#elif defined(TCP_RXT_CONNDROPTIME)
+    lv_libssh2_socket_set_option(handle, IPPROTO_TCP, TCP_RXT_CONNDROPTIME, (int)((timeout_ms + 999) / 1000));
+#endif
+}
+
+void
+lv_libssh2_socket_shutdown(
+    libssh2_socket_t handle
+) {
+#ifdef _WIN32
+    shutdown(handle, SD_BOTH);
+#else
+    shutdown(handle, SHUT_RDWR);
+#endif
+}
+
+void
+lv_libssh2_socket_shutdown_send(
+    libssh2_socket_t handle
+) {
+#ifdef _WIN32
+    shutdown(handle, SD_SEND);
+#else
+    shutdown(handle, SHUT_WR);
+#endif
+}
+
+ssize_t
+lv_libssh2_socket_send(
+    libssh2_socket_t handle,
+    const char* buffer,
+    const size_t len
+) {
+#ifdef _WIN32
+    return send(handle, buffer, (int)len, 0);
+#elif defined(MSG_NOSIGNAL)
+    return send(handle, buffer, len, MSG_NOSIGNAL);
+#else
+    return send(handle, buffer, len, 0);
+#endif
+}
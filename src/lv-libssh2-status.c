@@ -139,6 +139,20 @@ lv_libssh2_status_string(
         case LV_LIBSSH2_STATUS_ERROR_SFTP_NOT_A_DIRECTORY: return "SFTP Not a Directory Error";
         case LV_LIBSSH2_STATUS_ERROR_SFTP_INVALID_FILENAME: return "SFTP Invalid File Name Error";
         case LV_LIBSSH2_STATUS_ERROR_SFTP_LINK_LOOP: return "SFTP Link Loop Error";
+        case LV_LIBSSH2_STATUS_ERROR_UNKNOWN_WINDOW_MODE: return "Unknown Window Mode Error";
+        case LV_LIBSSH2_STATUS_ERROR_INVALID_PACKET_SIZE: return "Invalid Packet Size Error";
+        case LV_LIBSSH2_STATUS_ERROR_INVALID_PATTERN: return "Invalid Pattern Error";
+        case LV_LIBSSH2_STATUS_ERROR_INVALID_MESSAGE_LENGTH: return "Invalid Message Length Error";
+        case LV_LIBSSH2_STATUS_ERROR_OUTPUT_LIMIT_EXCEEDED: return "Output Limit Exceeded Error";
+        case LV_LIBSSH2_STATUS_ERROR_INVALID_TERMINAL_SIZE: return "Invalid Terminal Size Error";
+        case LV_LIBSSH2_STATUS_ERROR_HOST_NOT_FOUND: return "Host Not Found Error";
+        case LV_LIBSSH2_STATUS_ERROR_CONNECT_FAILED: return "Connect Failed Error";
+        case LV_LIBSSH2_STATUS_ERROR_CANCELED: return "Canceled Error";
+        case LV_LIBSSH2_STATUS_ERROR_UNKNOWN_COMPRESSION_POLICY: return "Unknown Compression Policy Error";
+        case LV_LIBSSH2_STATUS_ERROR_HOSTKEY_REJECTED: return "Host Key Rejected Error";
+        case LV_LIBSSH2_STATUS_ERROR_UNKNOWN_MEMORY_MODE: return "Unknown Memory Mode Error";
+        case LV_LIBSSH2_STATUS_ERROR_UNKNOWN_ALLOCATOR: return "Unknown Allocator Error";
+        case LV_LIBSSH2_STATUS_ERROR_INVALID_WINDOW_SIZE: return "Invalid Window Size Error";
         default: return UNKNOWN_STATUS;
     }
 }
@@ -231,6 +245,20 @@ case LV_LIBSSH2_STATUS_ERROR_UNKNOWN_HASH_ALGORITHM: return "Only the MD5 and SH
         case LV_LIBSSH2_STATUS_ERROR_SFTP_NOT_A_DIRECTORY: return "";
         case LV_LIBSSH2_STATUS_ERROR_SFTP_INVALID_FILENAME: return "";
         case LV_LIBSSH2_STATUS_ERROR_SFTP_LINK_LOOP: return "";
+        case LV_LIBSSH2_STATUS_ERROR_UNKNOWN_WINDOW_MODE: return "The channel window mode is unknown.";
+        case LV_LIBSSH2_STATUS_ERROR_INVALID_PACKET_SIZE: return "The channel packet size cannot be larger than the libssh2 default of 32768 bytes.";
+        case LV_LIBSSH2_STATUS_ERROR_INVALID_PATTERN: return "A pattern cannot be empty, and at least one pattern must be added before searching.";
+        case LV_LIBSSH2_STATUS_ERROR_INVALID_MESSAGE_LENGTH: return "The length of a message exceeds the maximum of 16 MiB, or the received data is not length-prefixed.";
+        case LV_LIBSSH2_STATUS_ERROR_OUTPUT_LIMIT_EXCEEDED: return "More data was received than the maximum length of the output.";
+        case LV_LIBSSH2_STATUS_ERROR_INVALID_TERMINAL_SIZE: return "The number of columns and rows of a terminal must be between 1 and 4096.";
+        case LV_LIBSSH2_STATUS_ERROR_HOST_NOT_FOUND: return "The host name could not be resolved to an address.";
+        case LV_LIBSSH2_STATUS_ERROR_CONNECT_FAILED: return "A TCP connection could not be established to any address of the host.";
+        case LV_LIBSSH2_STATUS_ERROR_CANCELED: return "The operation was canceled before it completed.";
+        case LV_LIBSSH2_STATUS_ERROR_UNKNOWN_COMPRESSION_POLICY: return "The session compression policy is unknown.";
+        case LV_LIBSSH2_STATUS_ERROR_HOSTKEY_REJECTED: return "The host key was not found in the known hosts or does not match.";
+        case LV_LIBSSH2_STATUS_ERROR_UNKNOWN_MEMORY_MODE: return "The session memory mode is unknown.";
+        case LV_LIBSSH2_STATUS_ERROR_UNKNOWN_ALLOCATOR: return "The session allocator is unknown.";
+        case LV_LIBSSH2_STATUS_ERROR_INVALID_WINDOW_SIZE: return "The channel window size cannot be smaller than the packet size.";
         default: return UNKNOWN_STATUS;
     }
 }
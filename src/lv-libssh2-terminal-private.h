@@ -0,0 +1,74 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#ifndef LV_LIBSSH2_TERMINAL_PRIVATE_H
+#define LV_LIBSSH2_TERMINAL_PRIVATE_H
+
+#include "lv-libssh2.h"
+
+#define LV_LIBSSH2_TERMINAL_MAX_PARAMS 16
+
+typedef enum _lv_libssh2_terminal_states {
+    LV_LIBSSH2_TERMINAL_STATE_GROUND = 0,
+    LV_LIBSSH2_TERMINAL_STATE_ESCAPE = 1,
+    LV_LIBSSH2_TERMINAL_STATE_ESCAPE_INTERMEDIATE = 2,
+    LV_LIBSSH2_TERMINAL_STATE_CSI = 3,
+    LV_LIBSSH2_TERMINAL_STATE_STRING = 4,
+    LV_LIBSSH2_TERMINAL_STATE_STRING_ESCAPE = 5
+} lv_libssh2_terminal_states_t;
+
+struct _lv_libssh2_terminal {
+    uint32_t columns;
+    uint32_t rows;
+    uint8_t* cells;
+    uint32_t cursor_column;
+    uint32_t cursor_row;
+    uint32_t saved_column;
+    uint32_t saved_row;
+    bool wrap_pending;
+    uint32_t scroll_top;
+    uint32_t scroll_bottom;
+    lv_libssh2_terminal_states_t state;
+    uint32_t params[LV_LIBSSH2_TERMINAL_MAX_PARAMS];
+    size_t param_count;
+    bool private_mode;
+    uint32_t utf8_remaining;
+    bool dirty;
+    uint32_t dirty_left;
+    uint32_t dirty_top;
+    uint32_t dirty_right;
+    uint32_t dirty_bottom;
+};
+
+#endif
+
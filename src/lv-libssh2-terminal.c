@@ -0,0 +1,860 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lv-libssh2.h"
+#include "lv-libssh2-status-private.h"
+#include "lv-libssh2-terminal-private.h"
+
+#define MAX_DIMENSION 4096
+#define MAX_PARAM_VALUE 65535
+#define TAB_WIDTH 8
+#define BLANK ' '
+#define REPLACEMENT '?'
+
+static void
+lv_libssh2_terminal_mark_dirty(
+    lv_libssh2_terminal_t* handle,
+    const uint32_t left,
+    const uint32_t top,
+    const uint32_t right,
+    const uint32_t bottom
+) {
+    if (!handle->dirty) {
+        handle->dirty = true;
+        handle->dirty_left = left;
+        handle->dirty_top = top;
+        handle->dirty_right = right;
+        handle->dirty_bottom = bottom;
+        return;
+    }
+    if (left < handle->dirty_left) {
+        handle->dirty_left = left;
+    }
+    if (top < handle->dirty_top) {
+        handle->dirty_top = top;
+    }
+    if (right > handle->dirty_right) {
+        handle->dirty_right = right;
+    }
+    if (bottom > handle->dirty_bottom) {
+        handle->dirty_bottom = bottom;
+    }
+}
+
+static uint8_t*
+lv_libssh2_terminal_cell(
+    lv_libssh2_terminal_t* handle,
+    const uint32_t column,
+    const uint32_t row
+) {
+    return handle->cells + (size_t)row * handle->columns + column;
+}
+
+/**
+ * Blanks the cells from `column` to `end_column`, inclusive, in one row.
+ */
+static void
+lv_libssh2_terminal_erase(
+    lv_libssh2_terminal_t* handle,
+    const uint32_t row,
+    const uint32_t column,
+    const uint32_t end_column
+) {
+    memset(lv_libssh2_terminal_cell(handle, column, row), BLANK, end_column - column + 1);
+    lv_libssh2_terminal_mark_dirty(handle, column, row, end_column, row);
+}
+
+/**
+ * Moves the rows from `top` to `bottom`, inclusive, up by `count` rows, or down
+ * if `count` is negative, and blanks the rows that are uncovered.
+ */
+static void
+lv_libssh2_terminal_scroll(
+    lv_libssh2_terminal_t* handle,
+    const uint32_t top,
+    const uint32_t bottom,
+    int64_t count
+) {
+    uint32_t height = bottom - top + 1;
+    uint32_t distance = (uint32_t)(count < 0 ? -count : count);
+    if (distance > height) {
+        distance = height;
+    }
+    size_t row_size = handle->columns;
+    size_t moved = (size_t)(height - distance) * row_size;
+    if (count > 0) {
+        memmove(
+            lv_libssh2_terminal_cell(handle, 0, top),
+            lv_libssh2_terminal_cell(handle, 0, top + distance),
+            moved
+        );
+        memset(lv_libssh2_terminal_cell(handle, 0, bottom - distance + 1), BLANK, distance * row_size);
+    } else {
+        memmove(
+            lv_libssh2_terminal_cell(handle, 0, top + distance),
+            lv_libssh2_terminal_cell(handle, 0, top),
+            moved
+        );
+        memset(lv_libssh2_terminal_cell(handle, 0, top), BLANK, distance * row_size);
+    }
+    lv_libssh2_terminal_mark_dirty(handle, 0, top, handle->columns - 1, bottom);
+}
+
+static void
+lv_libssh2_terminal_line_feed(
+    lv_libssh2_terminal_t* handle
+) {
+    handle->wrap_pending = false;
+    if (handle->cursor_row == handle->scroll_bottom) {
+        lv_libssh2_terminal_scroll(handle, handle->scroll_top, handle->scroll_bottom, 1);
+    } else if (handle->cursor_row < handle->rows - 1) {
+        handle->cursor_row++;
+    }
+}
+
+static void
+lv_libssh2_terminal_reverse_line_feed(
+    lv_libssh2_terminal_t* handle
+) {
+    handle->wrap_pending = false;
+    if (handle->cursor_row == handle->scroll_top) {
+        lv_libssh2_terminal_scroll(handle, handle->scroll_top, handle->scroll_bottom, -1);
+    } else if (handle->cursor_row > 0) {
+        handle->cursor_row--;
+    }
+}
+
+static void
+lv_libssh2_terminal_move_to(
+    lv_libssh2_terminal_t* handle,
+    int64_t column,
+    int64_t row
+) {
+    if (column < 0) {
+        column = 0;
+    } else if (column >= handle->columns) {
+        column = handle->columns - 1;
+    }
+    if (row < 0) {
+        row = 0;
+    } else if (row >= handle->rows) {
+        row = handle->rows - 1;
+    }
+    handle->cursor_column = (uint32_t)column;
+    handle->cursor_row = (uint32_t)row;
+    handle->wrap_pending = false;
+}
+
+static void
+lv_libssh2_terminal_put(
+    lv_libssh2_terminal_t* handle,
+    const uint8_t c
+) {
+    if (handle->wrap_pending) {
+        handle->cursor_column = 0;
+        lv_libssh2_terminal_line_feed(handle);
+    }
+    *lv_libssh2_terminal_cell(handle, handle->cursor_column, handle->cursor_row) = c;
+    lv_libssh2_terminal_mark_dirty(
+        handle,
+        handle->cursor_column,
+        handle->cursor_row,
+        handle->cursor_column,
+        handle->cursor_row
+    );
+    if (handle->cursor_column == handle->columns - 1) {
+        handle->wrap_pending = true;
+    } else {
+        handle->cursor_column++;
+    }
+}
+
+static void
+lv_libssh2_terminal_reset(
+    lv_libssh2_terminal_t* handle
+) {
+    memset(handle->cells, BLANK, (size_t)handle->columns * handle->rows);
+    handle->cursor_column = 0;
+    handle->cursor_row = 0;
+    handle->saved_column = 0;
+    handle->saved_row = 0;
+    handle->wrap_pending = false;
+    handle->scroll_top = 0;
+    handle->scroll_bottom = handle->rows - 1;
+    handle->state = LV_LIBSSH2_TERMINAL_STATE_GROUND;
+    handle->param_count = 0;
+    handle->private_mode = false;
+    handle->utf8_remaining = 0;
+    lv_libssh2_terminal_mark_dirty(handle, 0, 0, handle->columns - 1, handle->rows - 1);
+}
+
+/**
+ * Executes a C0 control character, which is also done in the middle of an
+ * escape sequence.
+ */
+static void
+lv_libssh2_terminal_control(
+    lv_libssh2_terminal_t* handle,
+    const uint8_t c
+) {
+    switch (c) {
+        case '\b':
+            if (handle->cursor_column > 0) {
+                handle->cursor_column--;
+            }
+            handle->wrap_pending = false;
+            break;
+        case '\t':
+            lv_libssh2_terminal_move_to(
+                handle,
+                (handle->cursor_column / TAB_WIDTH + 1) * TAB_WIDTH,
+                handle->cursor_row
+            );
+            break;
+        case '\n':
+        case '\v':
+        case '\f':
+            lv_libssh2_terminal_line_feed(handle);
+            break;
+        case '\r':
+            handle->cursor_column = 0;
+            handle->wrap_pending = false;
+            break;
+        default:
+            break;
+    }
+}
+
+static uint32_t
+lv_libssh2_terminal_param(
+    lv_libssh2_terminal_t* handle,
+    const size_t index,
+    const uint32_t default_value
+) {
+    if (index >= handle->param_count || handle->params[index] == 0) {
+        return default_value;
+    }
+    return handle->params[index];
+}
+
+static void
+lv_libssh2_terminal_erase_display(
+    lv_libssh2_terminal_t* handle,
+    const uint32_t mode
+) {
+    uint32_t last_column = handle->columns - 1;
+    uint32_t last_row = handle->rows - 1;
+    switch (mode) {
+        case 0:
+            lv_libssh2_terminal_erase(handle, handle->cursor_row, handle->cursor_column, last_column);
+            for (uint32_t row = handle->cursor_row + 1; row <= last_row; row++) {
+                lv_libssh2_terminal_erase(handle, row, 0, last_column);
+            }
+            break;
+        case 1:
+            for (uint32_t row = 0; row < handle->cursor_row; row++) {
+                lv_libssh2_terminal_erase(handle, row, 0, last_column);
+            }
+            lv_libssh2_terminal_erase(handle, handle->cursor_row, 0, handle->cursor_column);
+            break;
+        case 2:
+        case 3:
+            for (uint32_t row = 0; row <= last_row; row++) {
+                lv_libssh2_terminal_erase(handle, row, 0, last_column);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void
+lv_libssh2_terminal_erase_line(
+    lv_libssh2_terminal_t* handle,
+    const uint32_t mode
+) {
+    uint32_t last_column = handle->columns - 1;
+    switch (mode) {
+        case 0:
+            lv_libssh2_terminal_erase(handle, handle->cursor_row, handle->cursor_column, last_column);
+            break;
+        case 1:
+            lv_libssh2_terminal_erase(handle, handle->cursor_row, 0, handle->cursor_column);
+            break;
+        case 2:
+            lv_libssh2_terminal_erase(handle, handle->cursor_row, 0, last_column);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Inserts blank cells at the cursor, or deletes cells at the cursor if `count`
+ * is negative, shifting the rest of the row.
+ */
+static void
+lv_libssh2_terminal_shift_row(
+    lv_libssh2_terminal_t* handle,
+    int64_t count
+) {
+    uint32_t remaining = handle->columns - handle->cursor_column;
+    uint32_t distance = (uint32_t)(count < 0 ? -count : count);
+    if (distance > remaining) {
+        distance = remaining;
+    }
+    uint8_t* cursor = lv_libssh2_terminal_cell(handle, handle->cursor_column, handle->cursor_row);
+    if (count > 0) {
+        memmove(cursor + distance, cursor, remaining - distance);
+        memset(cursor, BLANK, distance);
+    } else {
+        memmove(cursor, cursor + distance, remaining - distance);
+        memset(cursor + remaining - distance, BLANK, distance);
+    }
+    lv_libssh2_terminal_mark_dirty(
+        handle,
+        handle->cursor_column,
+        handle->cursor_row,
+        handle->columns - 1,
+        handle->cursor_row
+    );
+    handle->wrap_pending = false;
+}
+
+static void
+lv_libssh2_terminal_dispatch_csi(
+    lv_libssh2_terminal_t* handle,
+    const uint8_t final
+) {
+    int64_t column = handle->cursor_column;
+    int64_t row = handle->cursor_row;
+    uint32_t n = lv_libssh2_terminal_param(handle, 0, 1);
+    if (handle->private_mode) {
+        return;
+    }
+    switch (final) {
+        case '@':
+            lv_libssh2_terminal_shift_row(handle, n);
+            break;
+        case 'A':
+            lv_libssh2_terminal_move_to(handle, column, row - n);
+            break;
+        case 'B':
+        case 'e':
+            lv_libssh2_terminal_move_to(handle, column, row + n);
+            break;
+        case 'C':
+        case 'a':
+            lv_libssh2_terminal_move_to(handle, column + n, row);
+            break;
+        case 'D':
+            lv_libssh2_terminal_move_to(handle, column - n, row);
+            break;
+        case 'E':
+            lv_libssh2_terminal_move_to(handle, 0, row + n);
+            break;
+        case 'F':
+            lv_libssh2_terminal_move_to(handle, 0, row - n);
+            break;
+        case 'G':
+        case '`':
+            lv_libssh2_terminal_move_to(handle, (int64_t)n - 1, row);
+            break;
+        case 'H':
+        case 'f':
+            lv_libssh2_terminal_move_to(
+                handle,
+                (int64_t)lv_libssh2_terminal_param(handle, 1, 1) - 1,
+                (int64_t)n - 1
+            );
+            break;
+        case 'd':
+            lv_libssh2_terminal_move_to(handle, column, (int64_t)n - 1);
+            break;
+        case 'J':
+            lv_libssh2_terminal_erase_display(handle, lv_libssh2_terminal_param(handle, 0, 0));
+            break;
+        case 'K':
+            lv_libssh2_terminal_erase_line(handle, lv_libssh2_terminal_param(handle, 0, 0));
+            break;
+        case 'L':
+            if (row >= handle->scroll_top && row <= handle->scroll_bottom) {
+                lv_libssh2_terminal_scroll(handle, (uint32_t)row, handle->scroll_bottom, -(int64_t)n);
+                handle->cursor_column = 0;
+                handle->wrap_pending = false;
+            }
+            break;
+        case 'M':
+            if (row >= handle->scroll_top && row <= handle->scroll_bottom) {
+                lv_libssh2_terminal_scroll(handle, (uint32_t)row, handle->scroll_bottom, n);
+                handle->cursor_column = 0;
+                handle->wrap_pending = false;
+            }
+            break;
+        case 'P':
+            lv_libssh2_terminal_shift_row(handle, -(int64_t)n);
+            break;
+        case 'S':
+            lv_libssh2_terminal_scroll(handle, handle->scroll_top, handle->scroll_bottom, n);
+            break;
+        case 'T':
+            lv_libssh2_terminal_scroll(handle, handle->scroll_top, handle->scroll_bottom, -(int64_t)n);
+            break;
+        case 'X': {
+            uint32_t end = handle->cursor_column + n - 1;
+            if (end >= handle->columns || end < handle->cursor_column) {
+                end = handle->columns - 1;
+            }
+            lv_libssh2_terminal_erase(handle, handle->cursor_row, handle->cursor_column, end);
+            handle->wrap_pending = false;
+            break;
+        }
+        case 'r': {
+            uint32_t top = lv_libssh2_terminal_param(handle, 0, 1) - 1;
+            uint32_t bottom = lv_libssh2_terminal_param(handle, 1, handle->rows) - 1;
+            if (bottom >= handle->rows) {
+                bottom = handle->rows - 1;
+            }
+            if (top < bottom) {
+                handle->scroll_top = top;
+                handle->scroll_bottom = bottom;
+                lv_libssh2_terminal_move_to(handle, 0, 0);
+            }
+            break;
+        }
+        case 's':
+            handle->saved_column = handle->cursor_column;
+            handle->saved_row = handle->cursor_row;
+            break;
+        case 'u':
+            lv_libssh2_terminal_move_to(handle, handle->saved_column, handle->saved_row);
+            break;
+        default:
+            break;
+    }
+}
+
+static void
+lv_libssh2_terminal_dispatch_escape(
+    lv_libssh2_terminal_t* handle,
+    const uint8_t c
+) {
+    handle->state = LV_LIBSSH2_TERMINAL_STATE_GROUND;
+    switch (c) {
+        case '[':
+            handle->state = LV_LIBSSH2_TERMINAL_STATE_CSI;
+            handle->param_count = 0;
+            handle->private_mode = false;
+            memset(handle->params, 0, sizeof(handle->params));
+            break;
+        case ']':
+        case 'P':
+        case 'X':
+        case '^':
+        case '_':
+            handle->state = LV_LIBSSH2_TERMINAL_STATE_STRING;
+            break;
+        case '(':
+        case ')':
+        case '*':
+        case '+':
+        case '#':
+        case '%':
+            handle->state = LV_LIBSSH2_TERMINAL_STATE_ESCAPE_INTERMEDIATE;
+            break;
+        case '7':
+            handle->saved_column = handle->cursor_column;
+            handle->saved_row = handle->cursor_row;
+            break;
+        case '8':
+            lv_libssh2_terminal_move_to(handle, handle->saved_column, handle->saved_row);
+            break;
+        case 'D':
+            lv_libssh2_terminal_line_feed(handle);
+            break;
+        case 'E':
+            handle->cursor_column = 0;
+            lv_libssh2_terminal_line_feed(handle);
+            break;
+        case 'M':
+            lv_libssh2_terminal_reverse_line_feed(handle);
+            break;
+        case 'c':
+            lv_libssh2_terminal_reset(handle);
+            break;
+        default:
+            break;
+    }
+}
+
+static void
+lv_libssh2_terminal_parse_csi(
+    lv_libssh2_terminal_t* handle,
+    const uint8_t c
+) {
+    if (c >= '0' && c <= '9') {
+        if (handle->param_count == 0) {
+            handle->param_count = 1;
+        }
+        uint32_t* param = &handle->params[handle->param_count - 1];
+        *param = *param * 10 + (c - '0');
+        if (*param > MAX_PARAM_VALUE) {
+            *param = MAX_PARAM_VALUE;
+        }
+    } else if (c == ';') {
+        if (handle->param_count == 0) {
+            handle->param_count = 1;
+        }
+        if (handle->param_count < LV_LIBSSH2_TERMINAL_MAX_PARAMS) {
+            handle->param_count++;
+        }
+    } else if (c >= '<' && c <= '?') {
+        handle->private_mode = true;
+    } else if (c >= 0x40 && c <= 0x7E) {
+        handle->state = LV_LIBSSH2_TERMINAL_STATE_GROUND;
+        lv_libssh2_terminal_dispatch_csi(handle, c);
+    }
+}
+
+static void
+lv_libssh2_terminal_parse(
+    lv_libssh2_terminal_t* handle,
+    const uint8_t c
+) {
+    if (c == 0x1B) {
+        handle->state = handle->state == LV_LIBSSH2_TERMINAL_STATE_STRING ?
+            LV_LIBSSH2_TERMINAL_STATE_STRING_ESCAPE :
+            LV_LIBSSH2_TERMINAL_STATE_ESCAPE;
+        handle->utf8_remaining = 0;
+        return;
+    }
+    if (c == 0x18 || c == 0x1A) {
+        handle->state = LV_LIBSSH2_TERMINAL_STATE_GROUND;
+        return;
+    }
+    switch (handle->state) {
+        case LV_LIBSSH2_TERMINAL_STATE_STRING:
+            if (c == 0x07) {
+                handle->state = LV_LIBSSH2_TERMINAL_STATE_GROUND;
+            }
+            return;
+        case LV_LIBSSH2_TERMINAL_STATE_STRING_ESCAPE:
+            handle->state = c == '\\' ?
+                LV_LIBSSH2_TERMINAL_STATE_GROUND :
+                LV_LIBSSH2_TERMINAL_STATE_STRING;
+            return;
+        default:
+            break;
+    }
+    if (c < 0x20 || c == 0x7F) {
+        lv_libssh2_terminal_control(handle, c);
+        return;
+    }
+    switch (handle->state) {
+        case LV_LIBSSH2_TERMINAL_STATE_ESCAPE:
+            lv_libssh2_terminal_dispatch_escape(handle, c);
+            return;
+        case LV_LIBSSH2_TERMINAL_STATE_ESCAPE_INTERMEDIATE:
+            handle->state = LV_LIBSSH2_TERMINAL_STATE_GROUND;
+            return;
+        case LV_LIBSSH2_TERMINAL_STATE_CSI:
+            lv_libssh2_terminal_parse_csi(handle, c);
+            return;
+        default:
+            break;
+    }
+    if (c < 0x80) {
+        handle->utf8_remaining = 0;
+        lv_libssh2_terminal_put(handle, c);
+    } else if (c < 0xC0 && handle->utf8_remaining > 0) {
+        handle->utf8_remaining--;
+    } else {
+        if (c >= 0xF0) {
+            handle->utf8_remaining = 3;
+        } else if (c >= 0xE0) {
+            handle->utf8_remaining = 2;
+        } else if (c >= 0xC0) {
+            handle->utf8_remaining = 1;
+        } else {
+            handle->utf8_remaining = 0;
+        }
+        lv_libssh2_terminal_put(handle, REPLACEMENT);
+    }
+}
+
+lv_libssh2_status_t
+lv_libssh2_terminal_create(
+    const uint32_t columns,
+    const uint32_t rows,
+    lv_libssh2_terminal_t** handle
+) {
+    *handle = NULL;
+    if (columns == 0 || rows == 0 || columns > MAX_DIMENSION || rows > MAX_DIMENSION) {
+        return LV_LIBSSH2_STATUS_ERROR_INVALID_TERMINAL_SIZE;
+    }
+    lv_libssh2_terminal_t* terminal = malloc(sizeof(lv_libssh2_terminal_t));
+    if (terminal == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    terminal->cells = malloc((size_t)columns * rows);
+    if (terminal->cells == NULL) {
+        free(terminal);
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    terminal->columns = columns;
+    terminal->rows = rows;
+    terminal->dirty = false;
+    lv_libssh2_terminal_reset(terminal);
+    *handle = terminal;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_terminal_destroy(
+    lv_libssh2_terminal_t* handle
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    free(handle->cells);
+    handle->cells = NULL;
+    free(handle);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_terminal_feed(
+    lv_libssh2_terminal_t* handle,
+    const uint8_t* data,
+    const size_t data_len
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (data == NULL && data_len > 0) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    for (size_t i = 0; i < data_len; i++) {
+        lv_libssh2_terminal_parse(handle, data[i]);
+    }
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_terminal_resize(
+    lv_libssh2_terminal_t* handle,
+    const uint32_t columns,
+    const uint32_t rows
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (columns == 0 || rows == 0 || columns > MAX_DIMENSION || rows > MAX_DIMENSION) {
+        return LV_LIBSSH2_STATUS_ERROR_INVALID_TERMINAL_SIZE;
+    }
+    if (columns == handle->columns && rows == handle->rows) {
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    uint8_t* cells = malloc((size_t)columns * rows);
+    if (cells == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_MALLOC;
+    }
+    memset(cells, BLANK, (size_t)columns * rows);
+    uint32_t copy_columns = columns < handle->columns ? columns : handle->columns;
+    uint32_t copy_rows = rows < handle->rows ? rows : handle->rows;
+    for (uint32_t row = 0; row < copy_rows; row++) {
+        memcpy(cells + (size_t)row * columns, lv_libssh2_terminal_cell(handle, 0, row), copy_columns);
+    }
+    free(handle->cells);
+    handle->cells = cells;
+    handle->columns = columns;
+    handle->rows = rows;
+    handle->scroll_top = 0;
+    handle->scroll_bottom = rows - 1;
+    lv_libssh2_terminal_move_to(handle, handle->cursor_column, handle->cursor_row);
+    if (handle->saved_column >= columns) {
+        handle->saved_column = columns - 1;
+    }
+    if (handle->saved_row >= rows) {
+        handle->saved_row = rows - 1;
+    }
+    handle->dirty = false;
+    lv_libssh2_terminal_mark_dirty(handle, 0, 0, columns - 1, rows - 1);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_terminal_size(
+    lv_libssh2_terminal_t* handle,
+    uint32_t* columns,
+    uint32_t* rows
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (columns == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (rows == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *columns = handle->columns;
+    *rows = handle->rows;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_terminal_cursor(
+    lv_libssh2_terminal_t* handle,
+    uint32_t* column,
+    uint32_t* row
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (column == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (row == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *column = handle->cursor_column;
+    *row = handle->cursor_row;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_terminal_snapshot_len(
+    lv_libssh2_terminal_t* handle,
+    size_t* len
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (len == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *len = ((size_t)handle->columns + 1) * handle->rows;
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_terminal_snapshot(
+    lv_libssh2_terminal_t* handle,
+    uint8_t* buffer,
+    const size_t buffer_len
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (buffer == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    size_t line_len = (size_t)handle->columns + 1;
+    if (buffer_len < line_len * handle->rows) {
+        return LV_LIBSSH2_STATUS_ERROR_BUFFER_TOO_SMALL;
+    }
+    for (uint32_t row = 0; row < handle->rows; row++) {
+        memcpy(buffer + row * line_len, lv_libssh2_terminal_cell(handle, 0, row), handle->columns);
+        buffer[row * line_len + handle->columns] = '\n';
+    }
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_terminal_row(
+    lv_libssh2_terminal_t* handle,
+    const uint32_t row,
+    uint8_t* buffer,
+    const size_t buffer_len
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (buffer == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (row >= handle->rows) {
+        return LV_LIBSSH2_STATUS_ERROR_OUT_OF_BOUNDARY;
+    }
+    if (buffer_len < handle->columns) {
+        return LV_LIBSSH2_STATUS_ERROR_BUFFER_TOO_SMALL;
+    }
+    memcpy(buffer, lv_libssh2_terminal_cell(handle, 0, row), handle->columns);
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_terminal_dirty_region(
+    lv_libssh2_terminal_t* handle,
+    bool* dirty,
+    uint32_t* left,
+    uint32_t* top,
+    uint32_t* right,
+    uint32_t* bottom
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    if (dirty == NULL || left == NULL || top == NULL || right == NULL || bottom == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    *dirty = handle->dirty;
+    if (handle->dirty) {
+        *left = handle->dirty_left;
+        *top = handle->dirty_top;
+        *right = handle->dirty_right;
+        *bottom = handle->dirty_bottom;
+    } else {
+        *left = 0;
+        *top = 0;
+        *right = 0;
+        *bottom = 0;
+    }
+    return LV_LIBSSH2_STATUS_OK;
+}
+
+lv_libssh2_status_t
+lv_libssh2_terminal_clear_dirty(
+    lv_libssh2_terminal_t* handle
+) {
+    if (handle == NULL) {
+        return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
+    }
+    handle->dirty = false;
+    return LV_LIBSSH2_STATUS_OK;
+}
@@ -0,0 +1,153 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#ifndef LV_LIBSSH2_THREAD_PRIVATE_H
+#define LV_LIBSSH2_THREAD_PRIVATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+typedef SRWLOCK lv_libssh2_mutex_t;
+typedef CONDITION_VARIABLE lv_libssh2_cond_t;
+typedef HANDLE lv_libssh2_thread_t;
+#define LV_LIBSSH2_MUTEX_INITIALIZER SRWLOCK_INIT
+#define LV_LIBSSH2_COND_INITIALIZER CONDITION_VARIABLE_INIT
+#define LV_LIBSSH2_THREAD_LOCAL __declspec(thread)
+#else
+#include <pthread.h>
+typedef pthread_mutex_t lv_libssh2_mutex_t;
+typedef pthread_cond_t lv_libssh2_cond_t;
+typedef pthread_t lv_libssh2_thread_t;
+#define LV_LIBSSH2_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define LV_LIBSSH2_COND_INITIALIZER PTHREAD_COND_INITIALIZER
+#define LV_LIBSSH2_THREAD_LOCAL __thread
+#endif
+
+typedef void (*lv_libssh2_thread_func_t)(void* arg);
+
+/**
+ * Initializes a mutex that was not statically initialized with
+ * LV_LIBSSH2_MUTEX_INITIALIZER.
+ */
+void
+lv_libssh2_mutex_init(
+    lv_libssh2_mutex_t* mutex
+);
+
+void
+lv_libssh2_mutex_destroy(
+    lv_libssh2_mutex_t* mutex
+);
+
+void
+lv_libssh2_mutex_lock(
+    lv_libssh2_mutex_t* mutex
+);
+
+/**
+ * Locks the mutex only if it is not already locked, returning `true` if the
+ * lock was acquired.
+ */
+bool
+lv_libssh2_mutex_try_lock(
+    lv_libssh2_mutex_t* mutex
+);
+
+void
+lv_libssh2_mutex_unlock(
+    lv_libssh2_mutex_t* mutex
+);
+
+/**
+ * Initializes a condition variable that was not statically initialized with
+ * LV_LIBSSH2_COND_INITIALIZER.
+ */
+void
+lv_libssh2_cond_init(
+    lv_libssh2_cond_t* cond
+);
+
+void
+lv_libssh2_cond_destroy(
+    lv_libssh2_cond_t* cond
+);
+
+/**
+ * Atomically releases the locked mutex and waits until the condition is
+ * signaled or the deadline from lv_libssh2_time_deadline_us() passes, then
+ * locks the mutex again. Spurious wakeups are possible, so the caller must
+ * check its condition in a loop.
+ */
+void
+lv_libssh2_cond_wait(
+    lv_libssh2_cond_t* cond,
+    lv_libssh2_mutex_t* mutex,
+    const uint64_t deadline_us
+);
+
+void
+lv_libssh2_cond_broadcast(
+    lv_libssh2_cond_t* cond
+);
+
+/**
+ * Starts a thread running `func` with `arg`, returning `false` if the thread
+ * could not be created.
+ */
+bool
+lv_libssh2_thread_start(
+    lv_libssh2_thread_t* thread,
+    lv_libssh2_thread_func_t func,
+    void* arg
+);
+
+/**
+ * Waits for the thread to return and releases its resources.
+ */
+void
+lv_libssh2_thread_join(
+    lv_libssh2_thread_t thread
+);
+
+/**
+ * Gets the number of processors that are online, or one if it is unknown.
+ */
+uint32_t
+lv_libssh2_thread_processor_count();
+
+#endif
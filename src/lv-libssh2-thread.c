@@ -0,0 +1,233 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "lv-libssh2-thread-private.h"
+#include "lv-libssh2-time-private.h"
+
+typedef struct _lv_libssh2_thread_start {
+    lv_libssh2_thread_func_t func;
+    void* arg;
+} lv_libssh2_thread_start_t;
+
+void
+lv_libssh2_mutex_init(
+    lv_libssh2_mutex_t* mutex
+) {
+#ifdef _WIN32
+    InitializeSRWLock(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+void
+lv_libssh2_mutex_destroy(
+    lv_libssh2_mutex_t* mutex
+) {
+#ifndef _WIN32
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+void
+lv_libssh2_mutex_lock(
+    lv_libssh2_mutex_t* mutex
+) {
+#ifdef _WIN32
+    AcquireSRWLockExclusive(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+bool
+lv_libssh2_mutex_try_lock(
+    lv_libssh2_mutex_t* mutex
+) {
+#ifdef _WIN32
+    return TryAcquireSRWLockExclusive(mutex) != 0;
+#else
+    return pthread_mutex_trylock(mutex) == 0;
+#endif
+}
+
+void
+lv_libssh2_mutex_unlock(
+    lv_libssh2_mutex_t* mutex
+) {
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+void
+lv_libssh2_cond_init(
+    lv_libssh2_cond_t* cond
+) {
+#ifdef _WIN32
+    InitializeConditionVariable(cond);
+#else
+    pthread_cond_init(cond, NULL);
+#endif
+}
+
+void
+lv_libssh2_cond_destroy(
+    lv_libssh2_cond_t* cond
+) {
+#ifndef _WIN32
+    pthread_cond_destroy(cond);
+#endif
+}
+
+void
+lv_libssh2_cond_wait(
+    lv_libssh2_cond_t* cond,
+    lv_libssh2_mutex_t* mutex,
+    const uint64_t deadline_us
+) {
+    uint64_t now = lv_libssh2_time_now_us();
+    uint64_t remaining_us = deadline_us > now ? deadline_us - now : 0;
+#ifdef _WIN32
+    DWORD timeout_ms = INFINITE;
+    if (deadline_us != LV_LIBSSH2_TIME_NO_DEADLINE) {
+        timeout_ms = remaining_us / 1000 >= INFINITE ? INFINITE - 1 : (DWORD)((remaining_us + 999) / 1000);
+    }
+    SleepConditionVariableSRW(cond, mutex, timeout_ms, 0);
+#else
+    if (deadline_us == LV_LIBSSH2_TIME_NO_DEADLINE) {
+        pthread_cond_wait(cond, mutex);
+        return;
+    }
+    // The condition variable uses the realtime clock, so the remaining time on
+    // the monotonic clock is added to the current realtime.
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += (time_t)(remaining_us / 1000000);
+    deadline.tv_nsec += (long)(remaining_us % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait(cond, mutex, &deadline);
+#endif
+}
+
+void
+lv_libssh2_cond_broadcast(
+    lv_libssh2_cond_t* cond
+) {
+#ifdef _WIN32
+    WakeAllConditionVariable(cond);
+#else
+    pthread_cond_broadcast(cond);
+#endif
+}
+
+#ifdef _WIN32
+static DWORD WINAPI
+lv_libssh2_thread_main(
+    LPVOID param
+) {
+#else
+static void*
+lv_libssh2_thread_main(
+    void* param
+) {
+#endif
+    lv_libssh2_thread_start_t start = *(lv_libssh2_thread_start_t*)param;
+    free(param);
+    start.func(start.arg);
+    return 0;
+}
+
+bool
+lv_libssh2_thread_start(
+    lv_libssh2_thread_t* thread,
+    lv_libssh2_thread_func_t func,
+    void* arg
+) {
+    lv_libssh2_thread_start_t* start = malloc(sizeof(lv_libssh2_thread_start_t));
+    if (start == NULL) {
+        return false;
+    }
+    start->func = func;
+    start->arg = arg;
+#ifdef _WIN32
+    *thread = CreateThread(NULL, 0, lv_libssh2_thread_main, start, 0, NULL);
+    if (*thread == NULL) {
+        free(start);
+        return false;
+    }
+#else
+    if (pthread_create(thread, NULL, lv_libssh2_thread_main, start) != 0) {
+        free(start);
+        return false;
+    }
+#endif
+    return true;
+}
+
+void
+lv_libssh2_thread_join(
+    lv_libssh2_thread_t thread
+) {
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+uint32_t
+lv_libssh2_thread_processor_count()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    long count = (long)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return count > 0 ? (uint32_t)count : 1;
+}
@@ -0,0 +1,74 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#ifndef LV_LIBSSH2_TIME_PRIVATE_H
+#define LV_LIBSSH2_TIME_PRIVATE_H
+
+#include <stdint.h>
+
+/**
+ * Gets a monotonic timestamp in microseconds.
+ *
+ * The epoch is unspecified, so the value is only meaningful when compared to
+ * another timestamp from the same function.
+ */
+uint64_t
+lv_libssh2_time_now_us();
+
+#define LV_LIBSSH2_TIME_NO_DEADLINE UINT64_MAX
+
+/**
+ * Converts a timeout in milliseconds from now to a deadline comparable to
+ * lv_libssh2_time_now_us().
+ *
+ * A negative timeout never expires and returns LV_LIBSSH2_TIME_NO_DEADLINE.
+ */
+uint64_t
+lv_libssh2_time_deadline_us(
+    const int32_t timeout_ms
+);
+
+/**
+ * Gets the milliseconds left until a deadline for a poll() timeout, rounded up
+ * so the wait does not end before the deadline.
+ *
+ * LV_LIBSSH2_TIME_NO_DEADLINE returns -1, which waits forever, and a deadline
+ * that has passed returns zero.
+ */
+int
+lv_libssh2_time_remaining_ms(
+    const uint64_t deadline_us
+);
+
+#endif
+
@@ -0,0 +1,86 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include <limits.h>
+
+#include "lv-libssh2-time-private.h"
+
+#define MICROSECONDS_PER_SECOND 1000000
+
+uint64_t
+lv_libssh2_time_now_us()
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * MICROSECONDS_PER_SECOND +
+        (uint64_t)(counter.QuadPart % frequency.QuadPart) * MICROSECONDS_PER_SECOND / frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * MICROSECONDS_PER_SECOND + (uint64_t)now.tv_nsec / 1000;
+#endif
+}
+
+uint64_t
+lv_libssh2_time_deadline_us(
+    const int32_t timeout_ms
+) {
+    if (timeout_ms < 0) {
+        return LV_LIBSSH2_TIME_NO_DEADLINE;
+    }
+    return lv_libssh2_time_now_us() + (uint64_t)timeout_ms * 1000;
+}
+
+int
+lv_libssh2_time_remaining_ms(
+    const uint64_t deadline_us
+) {
+    if (deadline_us == LV_LIBSSH2_TIME_NO_DEADLINE) {
+        return -1;
+    }
+    uint64_t now = lv_libssh2_time_now_us();
+    if (now >= deadline_us) {
+        return 0;
+    }
+    uint64_t remaining_ms = (deadline_us - now + 999) / 1000;
+    return remaining_ms > INT_MAX ? INT_MAX : (int)remaining_ms;
+}
@@ -33,13 +33,38 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "libssh2.h"
 
 #include "lv-libssh2.h"
+#include "lv-libssh2-profile-private.h"
 #include "lv-libssh2-status-private.h"
 #include "lv-libssh2-session-private.h"
 
+/**
+ * Keeps a copy of the listed authentication methods in the session for
+ * lv_libssh2_session_info(). The copy is only informational, so it is skipped
+ * if it cannot be allocated.
+ */
+static void
+lv_libssh2_userauth_remember(
+    lv_libssh2_session_t* handle,
+    const char* list
+) {
+    size_t len = strlen(list) + 1;
+    char* copy = malloc(len);
+    if (copy == NULL) {
+        return;
+    }
+    memcpy(copy, list, len);
+    lv_libssh2_session_lock(handle);
+    char* previous = handle->auth_list;
+    handle->auth_list = copy;
+    lv_libssh2_session_unlock(handle);
+    free(previous);
+}
+
 lv_libssh2_status_t
 lv_libssh2_userauth_list_len(
     lv_libssh2_session_t* handle,
@@ -55,10 +80,22 @@ lv_libssh2_userauth_list_len(
     if (len == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    char* cached = lv_libssh2_profile_auth_list(handle, username);
+    if (cached != NULL) {
+        *len = strlen(cached);
+        lv_libssh2_userauth_remember(handle, cached);
+        free(cached);
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    lv_libssh2_session_lock(handle);
     char* list = libssh2_userauth_list(handle->inner, username, (unsigned int)strlen(username));
+    int error_code = list == NULL ? libssh2_session_last_errno(handle->inner) : 0;
+    lv_libssh2_session_unlock(handle);
     if (list == NULL) {
-        return lv_libssh2_status_from_result(libssh2_session_last_errno(handle->inner));
+        return lv_libssh2_status_from_result(error_code);
     }
+    lv_libssh2_profile_auth_listed(handle, username, list);
+    lv_libssh2_userauth_remember(handle, list);
     *len = strlen(list);
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -78,10 +115,22 @@ lv_libssh2_userauth_list(
     if (buffer == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    char* cached = lv_libssh2_profile_auth_list(handle, username);
+    if (cached != NULL) {
+        memcpy(buffer, cached, strlen(cached));
+        lv_libssh2_userauth_remember(handle, cached);
+        free(cached);
+        return LV_LIBSSH2_STATUS_OK;
+    }
+    lv_libssh2_session_lock(handle);
     char* list = libssh2_userauth_list(handle->inner, username, (unsigned int)strlen(username));
+    int error_code = list == NULL ? libssh2_session_last_errno(handle->inner) : 0;
+    lv_libssh2_session_unlock(handle);
     if (list == NULL) {
-        return lv_libssh2_status_from_result(libssh2_session_last_errno(handle->inner));
+        return lv_libssh2_status_from_result(error_code);
     }
+    lv_libssh2_profile_auth_listed(handle, username, list);
+    lv_libssh2_userauth_remember(handle, list);
     memcpy(buffer, list, strlen(list));
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -94,7 +143,9 @@ lv_libssh2_userauth_authenticated(
     if (handle == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     *authenticated = libssh2_userauth_authenticated(handle->inner);
+    lv_libssh2_session_unlock(handle);
     return LV_LIBSSH2_STATUS_OK;
 }
 
@@ -122,6 +173,7 @@ lv_libssh2_userauth_hostbased_from_file(
     if (hostname == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     int result = libssh2_userauth_hostbased_fromfile_ex(
         handle->inner,
         username,
@@ -134,6 +186,10 @@ lv_libssh2_userauth_hostbased_from_file(
         username,
         (unsigned int)strlen(username)
     );
+    lv_libssh2_session_unlock(handle);
+    if (result == 0) {
+        lv_libssh2_profile_authenticated(handle, username, "hostbased");
+    }
     return lv_libssh2_status_from_result(result);
 }
 
@@ -152,6 +208,7 @@ lv_libssh2_userauth_password(
     if (password == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     int result = libssh2_userauth_password_ex(
         handle->inner,
         username,
@@ -160,6 +217,10 @@ lv_libssh2_userauth_password(
         (unsigned int)strlen(password),
         NULL
     );
+    lv_libssh2_session_unlock(handle);
+    if (result == 0) {
+        lv_libssh2_profile_authenticated(handle, username, "password");
+    }
     return lv_libssh2_status_from_result(result);
 }
 
@@ -183,6 +244,7 @@ lv_libssh2_userauth_publickey_from_file(
     if (private_key_path == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     int result = libssh2_userauth_publickey_fromfile_ex(
         handle->inner,
         username,
@@ -191,6 +253,10 @@ lv_libssh2_userauth_publickey_from_file(
         private_key_path,
         passphrase
     );
+    lv_libssh2_session_unlock(handle);
+    if (result == 0) {
+        lv_libssh2_profile_authenticated(handle, username, "publickey");
+    }
     return lv_libssh2_status_from_result(result);
 }
 
@@ -216,6 +282,7 @@ lv_libssh2_userauth_publickey_from_memory(
     if (private_key_data == NULL) {
         return LV_LIBSSH2_STATUS_ERROR_NULL_VALUE;
     }
+    lv_libssh2_session_lock(handle);
     int result = libssh2_userauth_publickey_frommemory(
         handle->inner,
         username,
@@ -226,5 +293,9 @@ lv_libssh2_userauth_publickey_from_memory(
         private_key_data_len,
         passphrase
     );
+    lv_libssh2_session_unlock(handle);
+    if (result == 0) {
+        lv_libssh2_profile_authenticated(handle, username, "publickey");
+    }
     return lv_libssh2_status_from_result(result);
 }
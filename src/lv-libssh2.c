@@ -31,13 +31,26 @@
  *   Christopher R. Field <chris@fieldrndservices.com>
  */
 
+#ifdef _WIN32
+#include <winsock2.h>
+#endif
+
 #include "libssh2.h"
 
 #include "lv-libssh2.h"
+#include "lv-libssh2-keepalive-private.h"
+#include "lv-libssh2-reaper-private.h"
+#include "lv-libssh2-socket-private.h"
 
 lv_libssh2_status_t
 lv_libssh2_initialize()
 {
+#ifdef _WIN32
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+        return LV_LIBSSH2_STATUS_ERROR_GENERIC;
+    }
+#endif
     libssh2_init(0);
     return LV_LIBSSH2_STATUS_OK;
 }
@@ -45,7 +58,16 @@ lv_libssh2_initialize()
 lv_libssh2_status_t
 lv_libssh2_shutdown()
 {
+    lv_libssh2_session_pool_clear();
+    lv_libssh2_reaper_shutdown();
+    lv_libssh2_benchmark_clear();
+    lv_libssh2_profile_clear();
+    lv_libssh2_keepalive_shutdown();
     libssh2_exit();
+    lv_libssh2_socket_clear_cache();
+#ifdef _WIN32
+    WSACleanup();
+#endif
     return LV_LIBSSH2_STATUS_OK;
 }
 
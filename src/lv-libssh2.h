@@ -156,7 +156,21 @@ typedef enum _lv_libssh2_status {
     LV_LIBSSH2_STATUS_ERROR_SFTP_DIR_NOT_EMPTY = -79,
     LV_LIBSSH2_STATUS_ERROR_SFTP_NOT_A_DIRECTORY = -80,
     LV_LIBSSH2_STATUS_ERROR_SFTP_INVALID_FILENAME = -81,
-    LV_LIBSSH2_STATUS_ERROR_SFTP_LINK_LOOP = -82
+    LV_LIBSSH2_STATUS_ERROR_SFTP_LINK_LOOP = -82,
+    LV_LIBSSH2_STATUS_ERROR_UNKNOWN_WINDOW_MODE = -83,
+    LV_LIBSSH2_STATUS_ERROR_INVALID_PACKET_SIZE = -84,
+    LV_LIBSSH2_STATUS_ERROR_INVALID_PATTERN = -85,
+    LV_LIBSSH2_STATUS_ERROR_INVALID_MESSAGE_LENGTH = -86,
+    LV_LIBSSH2_STATUS_ERROR_OUTPUT_LIMIT_EXCEEDED = -87,
+    LV_LIBSSH2_STATUS_ERROR_INVALID_TERMINAL_SIZE = -88,
+    LV_LIBSSH2_STATUS_ERROR_HOST_NOT_FOUND = -89,
+    LV_LIBSSH2_STATUS_ERROR_CONNECT_FAILED = -90,
+    LV_LIBSSH2_STATUS_ERROR_CANCELED = -91,
+    LV_LIBSSH2_STATUS_ERROR_UNKNOWN_COMPRESSION_POLICY = -92,
+    LV_LIBSSH2_STATUS_ERROR_HOSTKEY_REJECTED = -93,
+    LV_LIBSSH2_STATUS_ERROR_UNKNOWN_MEMORY_MODE = -94,
+    LV_LIBSSH2_STATUS_ERROR_UNKNOWN_ALLOCATOR = -95,
+    LV_LIBSSH2_STATUS_ERROR_INVALID_WINDOW_SIZE = -96
 } lv_libssh2_status_t;
 
 typedef enum _lv_libssh2_session_modes {
@@ -164,6 +178,16 @@ typedef enum _lv_libssh2_session_modes {
     LV_LIBSSH2_SESSION_MODE_BLOCKING = 1
 } lv_libssh2_session_modes_t;
 
+typedef enum _lv_libssh2_session_states {
+    LV_LIBSSH2_SESSION_STATE_ALIVE = 0,
+    LV_LIBSSH2_SESSION_STATE_DEAD = 1
+} lv_libssh2_session_states_t;
+
+typedef enum _lv_libssh2_compression_policies {
+    LV_LIBSSH2_COMPRESSION_POLICY_MANUAL = 0,
+    LV_LIBSSH2_COMPRESSION_POLICY_LEARNED = 1
+} lv_libssh2_compression_policies_t;
+
 typedef enum _lv_libssh2_hostkey_hash_types {
     LV_LIBSSH2_HOSTKEY_HASH_TYPE_MD5 = LIBSSH2_HOSTKEY_HASH_MD5,
     LV_LIBSSH2_HOSTKEY_HASH_TYPE_SHA1 = LIBSSH2_HOSTKEY_HASH_SHA1,
@@ -240,8 +264,8 @@ typedef enum _lv_libssh2_methods {
 
 typedef enum _lv_libssh2_ignore_modes {
     LV_LIBSSH2_IGNORE_MODES_NORMAL = LIBSSH2_CHANNEL_EXTENDED_DATA_NORMAL,
-    LV_LIBSSH2_IGNORE_MODES_MERGE = LIBSSH2_CHANNEL_EXTENDED_DATA_IGNORE,
-    LV_LIBSSH2_IGNORE_MODES_IGNORE = LIBSSH2_CHANNEL_EXTENDED_DATA_MERGE,
+    LV_LIBSSH2_IGNORE_MODES_MERGE = LIBSSH2_CHANNEL_EXTENDED_DATA_MERGE,
+    LV_LIBSSH2_IGNORE_MODES_IGNORE = LIBSSH2_CHANNEL_EXTENDED_DATA_IGNORE,
 } lv_libssh2_ignore_modes_t;
 
 typedef enum _lv_libssh2_channel_modes {
@@ -249,6 +273,11 @@ typedef enum _lv_libssh2_channel_modes {
     LV_LIBSSH2_CHANNEL_MODE_BLOCKING = 1,
 } lv_libssh2_channel_modes_t;
 
+typedef enum _lv_libssh2_channel_window_modes {
+    LV_LIBSSH2_CHANNEL_WINDOW_MODE_FIXED = 0,
+    LV_LIBSSH2_CHANNEL_WINDOW_MODE_ADAPTIVE = 1,
+} lv_libssh2_channel_window_modes_t;
+
 typedef enum _lv_libssh2_channel_flush_groups {
     LV_LIBSSH2_CHANNEL_FLUSH_GROUPS_EXTENDED_DATA = LIBSSH2_CHANNEL_FLUSH_EXTENDED_DATA,
     LV_LIBSSH2_CHANNEL_FLUSH_GROUPS_ALL = LIBSSH2_CHANNEL_FLUSH_ALL,
@@ -324,6 +353,120 @@ typedef enum _lv_libssh2_sftp_file_modes {
  */
 typedef struct _lv_libssh2_session lv_libssh2_session_t;
 
+/**
+ * Options for the TCP connection opened by lv_libssh2_session_connect_host().
+ *
+ * A buffer size, keepalive time, or attempt delay of zero uses the default.
+ */
+typedef struct _lv_libssh2_socket_options {
+    int32_t send_buffer_size;
+    int32_t receive_buffer_size;
+    int32_t keepalive_idle_s;
+    int32_t keepalive_interval_s;
+    int32_t attempt_delay_ms;
+    uint8_t no_delay;
+    uint8_t keepalive;
+} lv_libssh2_socket_options_t;
+
+/**
+ * How a session created by lv_libssh2_session_create_ex() uses memory.
+ *
+ * The low memory mode is meant for small targets, such as NI Linux RT
+ * controllers, that run several sessions next to other applications. Channels
+ * are opened with a 64 KB receive window and 16 KB packets instead of the
+ * libssh2 defaults of 2 MB and 32 KB, which bounds what the peer can make the
+ * session buffer, the adaptive window mode grows to at most 4 times the
+ * window, and the allocations of libssh2 are pooled.
+ *
+ * The real-time mode is meant for deterministic loops. It uses the windows and
+ * packets of the low memory mode, but the session allocates one arena when it
+ * is created and takes the memory of libssh2, the channel and SFTP handles,
+ * and their buffers from it, keeping every freed block for reuse. Once the
+ * channels and SFTP handles are created and the first transfers have sized
+ * the buffers, reads and writes do not allocate from the heap. Exhausting the
+ * arena fails the allocation, like running out of memory. The crypto library
+ * manages its own memory and is not covered.
+ */
+typedef enum _lv_libssh2_memory_modes {
+    LV_LIBSSH2_MEMORY_MODE_DEFAULT = 0,
+    LV_LIBSSH2_MEMORY_MODE_LOW = 1,
+    LV_LIBSSH2_MEMORY_MODE_REAL_TIME = 2,
+} lv_libssh2_memory_modes_t;
+
+/**
+ * Where a session created by lv_libssh2_session_create_ex() takes the memory
+ * of libssh2 and of its channel and SFTP handles from.
+ *
+ * The default is the allocator of the memory mode: the system allocator for
+ * the default mode, the pool for the low memory mode, and the arena for the
+ * real-time mode. The system allocator calls malloc() and free() for every
+ * block. The pool rounds blocks up to a power of two between 32 bytes and
+ * 64 KB and keeps freed blocks of each size for the session to reuse, which
+ * saves the system allocator calls when many packets of similar sizes are
+ * sent and received. The arena is the one of the real-time mode. Every
+ * allocator counts the memory it holds for the session.
+ */
+typedef enum _lv_libssh2_allocators {
+    LV_LIBSSH2_ALLOCATOR_DEFAULT = 0,
+    LV_LIBSSH2_ALLOCATOR_SYSTEM = 1,
+    LV_LIBSSH2_ALLOCATOR_POOL = 2,
+    LV_LIBSSH2_ALLOCATOR_ARENA = 3,
+} lv_libssh2_allocators_t;
+
+/**
+ * The configuration of a session for lv_libssh2_session_create_ex().
+ *
+ * The `memory_mode` is a ::lv_libssh2_memory_modes_t value. A window or packet
+ * size of zero uses the default of the memory mode for the channels of the
+ * session. The `arena_size` is the bytes of the arena, where zero uses 1 MB
+ * plus twice the most the adaptive window mode can grow the receive window of
+ * the channels to, and is ignored by the other allocators. The `allocator` is
+ * a ::lv_libssh2_allocators_t value. A non-zero `memory_limit` is the most
+ * bytes the allocator may hold for the session, beyond which allocations fail
+ * and libssh2 reports that it is out of memory.
+ */
+typedef struct _lv_libssh2_session_config {
+    int32_t memory_mode;
+    uint32_t window_size;
+    uint32_t packet_size;
+    uint32_t arena_size;
+    int32_t allocator;
+    uint32_t memory_limit;
+} lv_libssh2_session_config_t;
+
+/**
+ * The sizes of the fixed-size fields of ::lv_libssh2_session_info_t.
+ */
+typedef enum _lv_libssh2_session_info_sizes {
+    LV_LIBSSH2_SESSION_INFO_BANNER_SIZE = 256,
+    LV_LIBSSH2_SESSION_INFO_HOSTKEY_SIZE = 4096,
+    LV_LIBSSH2_SESSION_INFO_MD5_SIZE = 16,
+    LV_LIBSSH2_SESSION_INFO_SHA1_SIZE = 20,
+    LV_LIBSSH2_SESSION_INFO_METHOD_COUNT = LIBSSH2_METHOD_LANG_SC + 1,
+    LV_LIBSSH2_SESSION_INFO_METHOD_SIZE = 64,
+    LV_LIBSSH2_SESSION_INFO_AUTH_LIST_SIZE = 256,
+} lv_libssh2_session_info_sizes_t;
+
+/**
+ * A snapshot of a started session from lv_libssh2_session_info().
+ *
+ * The strings are NUL-terminated, and the methods are indexed by
+ * ::lv_libssh2_methods_t. A string longer than its field is truncated.
+ */
+typedef struct _lv_libssh2_session_info {
+    char banner[LV_LIBSSH2_SESSION_INFO_BANNER_SIZE];
+    uint32_t banner_len;
+    uint8_t hostkey[LV_LIBSSH2_SESSION_INFO_HOSTKEY_SIZE];
+    uint32_t hostkey_len;
+    int32_t hostkey_type;
+    uint8_t hostkey_md5[LV_LIBSSH2_SESSION_INFO_MD5_SIZE];
+    uint8_t hostkey_sha1[LV_LIBSSH2_SESSION_INFO_SHA1_SIZE];
+    char methods[LV_LIBSSH2_SESSION_INFO_METHOD_COUNT][LV_LIBSSH2_SESSION_INFO_METHOD_SIZE];
+    char auth_list[LV_LIBSSH2_SESSION_INFO_AUTH_LIST_SIZE];
+    uint32_t auth_list_len;
+    uint8_t authenticated;
+} lv_libssh2_session_info_t;
+
 /**
  * The known hosts
  */
@@ -339,6 +482,14 @@ typedef struct _lv_libssh2_knownhost lv_libssh2_knownhost_t;
  */
 typedef struct _lv_libssh2_channel lv_libssh2_channel_t;
 
+/**
+ * A contiguous region of memory to write as part of a larger stream.
+ */
+typedef struct _lv_libssh2_channel_segment {
+    const char* data;
+    size_t len;
+} lv_libssh2_channel_segment_t;
+
 /**
  * The File Information structure, or stat info.
  *
@@ -385,6 +536,76 @@ typedef struct _lv_libssh2_agent lv_libssh2_agent_t;
  */
 typedef struct _lv_libssh2_agent_identity lv_libssh2_agent_identity_t;
 
+/**
+ * A set of patterns to search for in the data received on a channel
+ */
+typedef struct _lv_libssh2_expect lv_libssh2_expect_t;
+
+/**
+ * A shell channel that runs many commands, one after another
+ */
+typedef struct _lv_libssh2_runner lv_libssh2_runner_t;
+
+/**
+ * A screen buffer that emulates a VT100 terminal
+ */
+typedef struct _lv_libssh2_terminal lv_libssh2_terminal_t;
+
+/**
+ * A set of channels opened ahead of time
+ */
+typedef struct _lv_libssh2_channel_pool lv_libssh2_channel_pool_t;
+
+/**
+ * A set of worker threads that drive non-blocking operations on many sessions
+ */
+typedef struct _lv_libssh2_reactor lv_libssh2_reactor_t;
+
+/**
+ * An operation submitted to a reactor
+ */
+typedef struct _lv_libssh2_reactor_job lv_libssh2_reactor_job_t;
+
+/**
+ * The sessions and results of connecting to many hosts at once
+ */
+typedef struct _lv_libssh2_fleet lv_libssh2_fleet_t;
+
+/**
+ * A host to connect to as part of a fleet, and the credentials to
+ * authenticate with.
+ *
+ * The password is used if it is not NULL. Otherwise, the private key file is
+ * used, with the public key file and passphrase if they are not NULL. A port
+ * of zero uses port 22.
+ */
+typedef struct _lv_libssh2_fleet_host {
+    const char* host;
+    uint16_t port;
+    const char* user;
+    const char* password;
+    const char* public_key_path;
+    const char* private_key_path;
+    const char* passphrase;
+} lv_libssh2_fleet_host_t;
+
+/**
+ * The result for one host of a fleet.
+ *
+ * The times are how long each step took in microseconds, and are zero for the
+ * steps that did not run. The output lengths are the lengths of the slices of
+ * the host in the packed outputs of the fleet.
+ */
+typedef struct _lv_libssh2_fleet_result {
+    int32_t status;
+    int32_t exit_status;
+    uint64_t connect_us;
+    uint64_t authenticate_us;
+    uint64_t exec_us;
+    uint64_t output_len;
+    uint64_t stderr_output_len;
+} lv_libssh2_fleet_result_t;
+
 /**
  * @defgroup agent Agent
  *
@@ -528,6 +749,82 @@ lv_libssh2_userauth_publickey_from_memory(
 /**
  * @}
  */
+/**
+ * @defgroup benchmark Benchmark
+ *
+ * Rank the key exchange, cipher, and MAC methods by their cost on this CPU.
+ *
+ * @{
+ */
+
+/**
+ * Measures the cryptographic primitives behind each key exchange, cipher, and
+ * MAC method supported by libssh2 and stores a preference string for each
+ * method type, cheapest first.
+ *
+ * Each primitive is run for the given duration in milliseconds, or 20
+ * milliseconds if zero. Ciphers and MACs are measured on 32 KB packets, which
+ * ranks them for bulk throughput, and key exchanges are measured per exchange,
+ * which ranks them for handshake latency. The cost of a cipher without
+ * built-in authentication includes the cheapest MAC. Legacy methods, such as
+ * CBC ciphers, SHA-1 key exchanges, and MD5 MACs, are not ranked and are kept
+ * at the end of the preference strings, so servers that only support them can
+ * still be connected. The host key methods are not reordered.
+ *
+ * The results are kept for the life of the process and replaced by each run.
+ * This takes about a second with the default duration.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_benchmark_run(
+    const uint32_t duration_ms
+);
+
+/**
+ * Gets the length of the benchmarked preference string for a method type.
+ *
+ * The benchmark is run with the default duration if it has not run yet. Only
+ * the key exchange, cipher, and MAC method types are supported.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_benchmark_method_pref_len(
+    const lv_libssh2_methods_t method,
+    size_t* len
+);
+
+/**
+ * Copies the benchmarked preference string for a method type into the
+ * buffer. The string is _not_ NULL terminated. Use
+ * lv_libssh2_benchmark_method_pref_len() to size the buffer.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_benchmark_method_pref(
+    const lv_libssh2_methods_t method,
+    uint8_t* buffer
+);
+
+/**
+ * Sets the benchmarked key exchange, cipher, and MAC preferences in both
+ * directions on a session, the same as calling
+ * lv_libssh2_session_set_method_pref() with each preference string.
+ *
+ * This must be called before the session connects.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_benchmark_apply(
+    lv_libssh2_session_t* session
+);
+
+/**
+ * Discards the benchmark results, so the next call that needs them runs the
+ * benchmark again. This is also done by lv_libssh2_shutdown().
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_benchmark_clear();
+
+/**
+ * @}
+ */
+
 /**
  * @defgroup channel Channel
  *
@@ -540,6 +837,27 @@ lv_libssh2_channel_create(
     lv_libssh2_channel_t** handle
 );
 
+/**
+ * Creates a channel with a specific receive window and maximum packet size.
+ *
+ * A value of zero for either size uses the default of the session, which is
+ * the libssh2 default, i.e. `LIBSSH2_CHANNEL_WINDOW_DEFAULT` and
+ * `LIBSSH2_CHANNEL_PACKET_DEFAULT`, unless the session was created with other
+ * sizes by lv_libssh2_session_create_ex(). The packet size cannot exceed
+ * `LIBSSH2_CHANNEL_PACKET_DEFAULT` because libssh2 rejects larger incoming
+ * packets, and a non-zero window size cannot be smaller than the packet size,
+ * since the peer could never send a full packet. The
+ * lv_libssh2_channel_create() function is the same as calling this function
+ * with zero for both sizes.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_create_ex(
+    lv_libssh2_session_t* session,
+    const uint32_t window_size,
+    const uint32_t packet_size,
+    lv_libssh2_channel_t** handle
+);
+
 LV_LIBSSH2_API lv_libssh2_status_t
 lv_libssh2_channel_destroy(
     lv_libssh2_channel_t* handle
@@ -561,6 +879,86 @@ lv_libssh2_channel_read_stderr(
     size_t* byte_count
 );
 
+/**
+ * Reads until the buffer is full.
+ *
+ * Unlike lv_libssh2_channel_read(), this does not return after a partial read.
+ * The session is put in non-blocking mode while reading, and the previous mode
+ * is restored before returning, so the timeout applies in either mode. A
+ * negative timeout waits forever. If the timeout expires first, the
+ * ::LV_LIBSSH2_STATUS_ERROR_TIMEOUT status is returned, and if the remote end
+ * sends EOF first, the ::LV_LIBSSH2_STATUS_ERROR_CHANNEL_CLOSED status is
+ * returned. In both cases, `byte_count` is the number of bytes that were read.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_read_exact(
+    lv_libssh2_channel_t* handle,
+    char* buffer,
+    const size_t buffer_len,
+    const int32_t timeout_ms,
+    size_t* byte_count
+);
+
+/**
+ * Reads until the remote end sends EOF and keeps the data in an output buffer
+ * owned by the channel.
+ *
+ * The output grows as needed up to `max_len` bytes, or without a limit if
+ * `max_len` is zero. If more data is received, the output is truncated to
+ * `max_len` and the ::LV_LIBSSH2_STATUS_ERROR_OUTPUT_LIMIT_EXCEEDED status is
+ * returned. The timeout works like lv_libssh2_channel_read_exact(). The output
+ * is copied with lv_libssh2_channel_output(), including any data read before
+ * an error, and is replaced by the next call.
+ *
+ * Stderr is read at the same time, with the same limit, so a command that
+ * writes a lot to stderr cannot stall the channel. It is copied with
+ * lv_libssh2_channel_stderr_output().
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_read_to_end(
+    lv_libssh2_channel_t* handle,
+    const size_t max_len,
+    const int32_t timeout_ms,
+    size_t* len
+);
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_output_len(
+    lv_libssh2_channel_t* handle,
+    size_t* len
+);
+
+/**
+ * Copies the output of the last lv_libssh2_channel_read_to_end(), or the
+ * stdout collected by lv_libssh2_channel_exec_with_input() or
+ * lv_libssh2_channel_exec_with_file().
+ *
+ * The buffer must be at least the length from lv_libssh2_channel_output_len().
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_output(
+    lv_libssh2_channel_t* handle,
+    uint8_t* buffer,
+    const size_t buffer_len
+);
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_stderr_output_len(
+    lv_libssh2_channel_t* handle,
+    size_t* len
+);
+
+/**
+ * Copies the stderr collected by lv_libssh2_channel_read_to_end(),
+ * lv_libssh2_channel_exec_with_input(), or lv_libssh2_channel_exec_with_file().
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_stderr_output(
+    lv_libssh2_channel_t* handle,
+    uint8_t* buffer,
+    const size_t buffer_len
+);
+
 LV_LIBSSH2_API lv_libssh2_status_t
 lv_libssh2_channel_close(
     lv_libssh2_channel_t* handle
@@ -582,11 +980,26 @@ lv_libssh2_channel_eof(
     int* eof
 );
 
+/**
+ * Sends any writes held back by coalescing, then discards any unread data in
+ * the stdout stream of the channel. Use lv_libssh2_channel_flush_writes() to
+ * only send the held writes.
+ */
 LV_LIBSSH2_API lv_libssh2_status_t
 lv_libssh2_channel_flush(
     lv_libssh2_channel_t* handle
 );
 
+/**
+ * Sends any writes held back by coalescing and leaves the data waiting to be
+ * read alone. In non-blocking mode, the unsent remainder stays held when
+ * ::LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN is returned.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_flush_writes(
+    lv_libssh2_channel_t* handle
+);
+
 LV_LIBSSH2_API lv_libssh2_status_t
 lv_libssh2_channel_forward_accept(
     lv_libssh2_session_t* session,
@@ -629,6 +1042,55 @@ lv_libssh2_channel_exec(
     const size_t command_len
 );
 
+/**
+ * Opens a channel, executes a command with the input as its stdin, and waits
+ * for the command to exit.
+ *
+ * The input is written in large chunks while stdout and stderr are collected,
+ * so a command that writes while it reads cannot deadlock, and EOF is sent
+ * after the last byte. Stdout and stderr are each limited to `max_output_len`
+ * bytes, or unlimited if zero, and are copied from the returned channel with
+ * lv_libssh2_channel_output() and lv_libssh2_channel_stderr_output(). The
+ * returned channel is already closed and only needs to be destroyed. The
+ * timeout applies to the whole operation in either session mode, and a
+ * negative timeout waits forever.
+ *
+ * If the output exceeds the limit or the timeout expires, the
+ * ::LV_LIBSSH2_STATUS_ERROR_OUTPUT_LIMIT_EXCEEDED or
+ * ::LV_LIBSSH2_STATUS_ERROR_TIMEOUT status is returned together with the
+ * channel, which holds the output collected so far, truncated to the limit.
+ * The command may still be running, the exit status is not set, and the
+ * channel must still be destroyed. On any other error, no channel is returned.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_exec_with_input(
+    lv_libssh2_session_t* session,
+    const char* command,
+    const size_t command_len,
+    const uint8_t* input,
+    const size_t input_len,
+    const size_t max_output_len,
+    const int32_t timeout_ms,
+    int32_t* exit_status,
+    lv_libssh2_channel_t** handle
+);
+
+/**
+ * Like lv_libssh2_channel_exec_with_input(), but streams the input from a
+ * local file, so the file does not need to fit in memory.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_exec_with_file(
+    lv_libssh2_session_t* session,
+    const char* command,
+    const size_t command_len,
+    const char* local_path,
+    const size_t max_output_len,
+    const int32_t timeout_ms,
+    int32_t* exit_status,
+    lv_libssh2_channel_t** handle
+);
+
 LV_LIBSSH2_API lv_libssh2_status_t
 lv_libssh2_channel_subsystem(
     lv_libssh2_channel_t* handle,
@@ -644,12 +1106,58 @@ lv_libssh2_channel_receive_window_adjust(
     uint32_t* window
 );
 
+/**
+ * Sets how the receive window is managed while reading from the channel.
+ *
+ * In the adaptive mode, the window is grown beyond the size used to create
+ * the channel, up to the `max_window_size`, whenever the remote end runs out
+ * of window between reads or the measured bandwidth-delay product exceeds the
+ * current window. The round trip time is measured when the channel is opened
+ * in blocking mode. A `max_window_size` of zero uses 16 times the creation
+ * window size, or 4 times in the low memory mode of the session.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_set_window_mode(
+    lv_libssh2_channel_t* handle,
+    const lv_libssh2_channel_window_modes_t mode,
+    const uint32_t max_window_size
+);
+
+/**
+ * Enables coalescing of small writes to the channel.
+ *
+ * While enabled, lv_libssh2_channel_write() accumulates writes smaller than
+ * the `threshold` and reports them as written, sending them as one packet
+ * once the `threshold` is reached or `delay_ms` has passed since the first
+ * held write. If the channel is not used before the delay passes, the held
+ * writes are sent by the background thread that also sends keepalives, so
+ * enabling coalescing makes every call on the session hold a per-session lock
+ * from then on, as lv_libssh2_session_set_keepalive() does. Call
+ * lv_libssh2_channel_flush_writes() to send held writes at once. Held writes
+ * are also sent before any other write, read, end of file, or close.
+ *
+ * If sending the held writes fails during a write, the error is returned and
+ * only the part of that write which was sent is counted as written. The
+ * `threshold` is limited to the packet size of the channel, and a `threshold`
+ * of zero sends any held writes and disables coalescing.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_set_coalescing(
+    lv_libssh2_channel_t* handle,
+    const size_t threshold,
+    const uint32_t delay_ms
+);
+
 LV_LIBSSH2_API lv_libssh2_status_t
 lv_libssh2_channel_request_pty(
     lv_libssh2_channel_t* handle,
     const char* terminal
 );
 
+/**
+ * Requests a new size for the pseudo-terminal. The screen buffer of a terminal
+ * attached with lv_libssh2_channel_set_terminal() is resized to match.
+ */
 LV_LIBSSH2_API lv_libssh2_status_t
 lv_libssh2_channel_request_pty_size(
     lv_libssh2_channel_t* handle,
@@ -657,6 +1165,19 @@ lv_libssh2_channel_request_pty_size(
     const int32_t height
 );
 
+/**
+ * Attaches a terminal that is fed everything read from the channel's stdout.
+ *
+ * This includes data read by the expect, message, and looping read functions.
+ * The terminal is not owned by the channel and must not be destroyed while it
+ * is attached. A NULL terminal detaches the current one.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_set_terminal(
+    lv_libssh2_channel_t* handle,
+    lv_libssh2_terminal_t* terminal
+);
+
 LV_LIBSSH2_API lv_libssh2_status_t
 lv_libssh2_channel_send_eof(
     lv_libssh2_channel_t* handle
@@ -705,56 +1226,453 @@ lv_libssh2_channel_write(
     size_t* byte_count
 );
 
+/**
+ * Writes the entire buffer.
+ *
+ * Unlike lv_libssh2_channel_write(), this does not return after a partial
+ * write. The timeout works like lv_libssh2_channel_read_exact(), and
+ * `byte_count` is the number of bytes that were written if an error occurs.
+ */
 LV_LIBSSH2_API lv_libssh2_status_t
-lv_libssh2_channel_write_stderr(
+lv_libssh2_channel_write_all(
     lv_libssh2_channel_t* handle,
     const char* buffer,
     const size_t buffer_len,
+    const int32_t timeout_ms,
     size_t* byte_count
 );
 
+/**
+ * Writes an array of segments to the channel as one logical stream.
+ *
+ * Small segments are gathered into packet-sized chunks before being handed to
+ * libssh2, so a header and payload do not need to be concatenated by the
+ * caller, and segments at least as large as the packet size are written
+ * directly. The `byte_count` is the number of bytes from the start of the
+ * stream that were sent. Like lv_libssh2_channel_write(), this can be less
+ * than the total length of the segments, in which case the remainder should
+ * be written in another call.
+ */
 LV_LIBSSH2_API lv_libssh2_status_t
-lv_libssh2_channel_request_x11(
+lv_libssh2_channel_writev(
     lv_libssh2_channel_t* handle,
-    const int32_t screen_number
+    const lv_libssh2_channel_segment_t* segments,
+    const size_t segment_count,
+    size_t* byte_count
 );
 
 /**
- * @}
- */
-
-/**
- * @defgroup file-info File Information
+ * Sends a message framed with a four byte, big-endian length prefix.
  *
- * @{
+ * The message is delivered whole to a peer reading with
+ * lv_libssh2_channel_recv_message() or any agent that reads the length and
+ * then the body. In non-blocking mode, a ::LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN
+ * status means the message was partially sent, and the call must be repeated
+ * with the same message to send the remainder.
+ *
+ * A message is at most 16 MiB (16,777,216 bytes). A longer message is not
+ * sent and the ::LV_LIBSSH2_STATUS_ERROR_INVALID_MESSAGE_LENGTH status is
+ * returned.
  */
-
 LV_LIBSSH2_API lv_libssh2_status_t
-lv_libssh2_fileinfo_create(
-    lv_libssh2_fileinfo_t** handle
+lv_libssh2_channel_send_message(
+    lv_libssh2_channel_t* handle,
+    const uint8_t* message,
+    const size_t message_len
 );
 
+/**
+ * Receives the next length-prefixed message.
+ *
+ * Data is read from the channel until a complete message has been reassembled,
+ * and the body, without the prefix, is copied to the buffer. If the buffer is
+ * too small, the ::LV_LIBSSH2_STATUS_ERROR_BUFFER_TOO_SMALL status is returned,
+ * the `message_len` is set to the required length, and the message is kept for
+ * the next call. Data read ahead of the next message is kept by the channel, so
+ * this should not be mixed with lv_libssh2_channel_read() on the same channel.
+ *
+ * A length prefix of more than 16 MiB (16,777,216 bytes), the most
+ * lv_libssh2_channel_send_message() sends, returns the
+ * ::LV_LIBSSH2_STATUS_ERROR_INVALID_MESSAGE_LENGTH status. The framing of the
+ * stream cannot be recovered after that, so the channel should be closed.
+ */
 LV_LIBSSH2_API lv_libssh2_status_t
-lv_libssh2_fileinfo_destroy(
-    lv_libssh2_fileinfo_t* handle
+lv_libssh2_channel_recv_message(
+    lv_libssh2_channel_t* handle,
+    uint8_t* buffer,
+    const size_t buffer_len,
+    size_t* message_len
 );
 
+/**
+ * Receives as many complete length-prefixed messages as are available.
+ *
+ * This waits for at least one message, like lv_libssh2_channel_recv_message(),
+ * and then copies every other message that has already been received, up to
+ * the maximum count and the buffer length. The message bodies are packed back
+ * to back in the buffer and the length of each is written to `message_lens`,
+ * which must have room for `max_message_count` elements. If the first message
+ * does not fit, the ::LV_LIBSSH2_STATUS_ERROR_BUFFER_TOO_SMALL status is
+ * returned with its length in the first element of `message_lens`. The
+ * 16 MiB limit of lv_libssh2_channel_recv_message() applies to every message.
+ */
 LV_LIBSSH2_API lv_libssh2_status_t
-lv_libssh2_fileinfo_size(
-    lv_libssh2_fileinfo_t* handle,
-    uint64_t* size
+lv_libssh2_channel_recv_messages(
+    lv_libssh2_channel_t* handle,
+    uint8_t* buffer,
+    const size_t buffer_len,
+    uint32_t* message_lens,
+    const size_t max_message_count,
+    size_t* message_count
 );
 
 LV_LIBSSH2_API lv_libssh2_status_t
-lv_libssh2_fileinfo_atime(
-    lv_libssh2_fileinfo_t* handle,
-    uint64_t* atime
+lv_libssh2_channel_write_stderr(
+    lv_libssh2_channel_t* handle,
+    const char* buffer,
+    const size_t buffer_len,
+    size_t* byte_count
 );
 
 LV_LIBSSH2_API lv_libssh2_status_t
-lv_libssh2_fileinfo_mtime(
-    lv_libssh2_fileinfo_t* handle,
-    uint64_t* mtime
+lv_libssh2_channel_request_x11(
+    lv_libssh2_channel_t* handle,
+    const int32_t screen_number
+);
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup channel_pool Channel Pool
+ *
+ * Hide the round trip of opening a channel by opening channels ahead of time.
+ *
+ * The pool keeps up to its capacity of channels that are open and ready for
+ * lv_libssh2_channel_exec() or a similar request. libssh2 only allows one
+ * channel open in progress per session, so the pool sends one open request at
+ * a time without blocking and completes it during a later pool call, which
+ * means the round trip overlaps the work done between pool calls. The pool
+ * does not use a thread. Calling lv_libssh2_channel_pool_refill() while idle
+ * keeps the pool full. Pooled channels use the default window and packet
+ * sizes. Any other channel open on the session, including SCP transfers and
+ * SFTP, first completes a pool open in progress and adds that channel to the
+ * pool, so it may wait for that round trip, or return the
+ * ::LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN status in non-blocking mode until
+ * the server answers. The pool must be destroyed before its session.
+ *
+ * @{
+ */
+
+/**
+ * Creates a pool and sends the first open request.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_pool_create(
+    lv_libssh2_session_t* session,
+    const size_t capacity,
+    lv_libssh2_channel_pool_t** handle
+);
+
+/**
+ * Destroys the pool and any channels it still holds, waiting for an open in
+ * progress to complete so the session is left in a consistent state.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_pool_destroy(
+    lv_libssh2_channel_pool_t* handle
+);
+
+/**
+ * Takes an open channel from the pool and sends the request for its
+ * replacement.
+ *
+ * If the pool is empty, a channel is opened in the current session mode, so in
+ * non-blocking mode the ::LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN status can be
+ * returned. The caller owns the channel and destroys it with
+ * lv_libssh2_channel_destroy().
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_pool_acquire(
+    lv_libssh2_channel_pool_t* handle,
+    lv_libssh2_channel_t** channel
+);
+
+/**
+ * Completes any opens that the server has answered without blocking and gets
+ * the number of channels that are ready.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_pool_refill(
+    lv_libssh2_channel_pool_t* handle,
+    size_t* available
+);
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup expect Expect
+ *
+ * Wait for one of several patterns, such as prompts or error messages, in the
+ * data received on an interactive shell channel.
+ *
+ * All of the patterns are matched simultaneously with an Aho-Corasick automaton
+ * that is built once, the first time the patterns are used, so the cost of
+ * matching is a single table lookup per received byte. If more than one
+ * pattern ends at the same byte, the pattern with the lowest index is matched.
+ *
+ * @{
+ */
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_expect_create(
+    lv_libssh2_expect_t** handle
+);
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_expect_destroy(
+    lv_libssh2_expect_t* handle
+);
+
+/**
+ * Adds a pattern and gets the index that is reported when it is matched.
+ *
+ * The automaton is rebuilt on the next use if a pattern is added after it has
+ * been used.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_expect_add_pattern(
+    lv_libssh2_expect_t* handle,
+    const uint8_t* pattern,
+    const size_t pattern_len,
+    int32_t* index
+);
+
+/**
+ * Searches data from a source other than a channel.
+ *
+ * The match index is -1 if none of the patterns has been matched yet. Any data
+ * after a match is kept and searched by the next call, which can have a
+ * `data_len` of zero.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_expect_feed(
+    lv_libssh2_expect_t* handle,
+    const uint8_t* data,
+    const size_t data_len,
+    int32_t* match_index
+);
+
+/**
+ * Discards any buffered data and restarts matching from the beginning.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_expect_reset(
+    lv_libssh2_expect_t* handle
+);
+
+/**
+ * Gets the length of the data received before the last match.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_expect_before_len(
+    lv_libssh2_expect_t* handle,
+    size_t* len
+);
+
+/**
+ * Copies the data received before the last match.
+ *
+ * The buffer must be at least the length from lv_libssh2_expect_before_len().
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_expect_before(
+    lv_libssh2_expect_t* handle,
+    uint8_t* buffer
+);
+
+/**
+ * Reads from the channel until one of the patterns is matched.
+ *
+ * If the channel reaches the end of file before a match, the match index is
+ * -1 and all of the remaining data is available as the data before the match.
+ * In non-blocking mode, a ::LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN status keeps
+ * all of the data received so far, and the search continues where it left off
+ * on the next call.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_channel_expect(
+    lv_libssh2_channel_t* channel,
+    lv_libssh2_expect_t* handle,
+    int32_t* match_index
+);
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup fleet Fleet
+ *
+ * Connect, authenticate, and run a command on many hosts at once.
+ *
+ * The hosts are worked through by a bounded number of threads, each of which
+ * takes the next host and connects with lv_libssh2_session_connect_host(),
+ * checks the host key against the known hosts, authenticates, and runs the
+ * command with lv_libssh2_channel_exec_with_input(). A failure only stops the
+ * host it happened on, and its status is reported in the result of the host.
+ * The sessions of the hosts that authenticated stay connected until they are
+ * taken with lv_libssh2_fleet_take_session() or the fleet is destroyed.
+ *
+ * @{
+ */
+
+/**
+ * Connects to every host and runs the command on each, returning when all of
+ * the hosts are done.
+ *
+ * A NULL `command` only connects and authenticates. The `concurrency` is the
+ * most hosts worked on at once, including by the calling thread, where zero
+ * uses 32 and no more than the number of hosts are used. The `knownhosts` are
+ * required, since the credentials would otherwise be sent to hosts that were
+ * never verified. The host key of each host is checked against them before
+ * authenticating, and hosts whose key is not found or does not match fail
+ * with ::LV_LIBSSH2_STATUS_ERROR_HOSTKEY_REJECTED; the known hosts must not
+ * be changed until this returns. The output of each command is collected
+ * up to `max_output_len` bytes each for stdout and stderr, or unlimited if
+ * zero. The timeout applies to each host separately and covers all of its
+ * steps, and a negative timeout waits forever.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_fleet_run(
+    const lv_libssh2_fleet_host_t* hosts,
+    const size_t host_count,
+    lv_libssh2_knownhosts_t* knownhosts,
+    const char* command,
+    const size_t command_len,
+    const size_t max_output_len,
+    const uint32_t concurrency,
+    const int32_t timeout_ms,
+    lv_libssh2_fleet_t** handle
+);
+
+/**
+ * Destroys the fleet. The sessions that were not taken with
+ * lv_libssh2_fleet_take_session() are torn down in the background with
+ * lv_libssh2_session_destroy_async().
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_fleet_destroy(
+    lv_libssh2_fleet_t* handle
+);
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_fleet_host_count(
+    lv_libssh2_fleet_t* handle,
+    size_t* count
+);
+
+/**
+ * Copies the result of every host, in the order of the hosts, to an array
+ * with room for lv_libssh2_fleet_host_count() results.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_fleet_results(
+    lv_libssh2_fleet_t* handle,
+    lv_libssh2_fleet_result_t* results
+);
+
+/**
+ * Gets the length of the stdout of all of the hosts packed together.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_fleet_output_len(
+    lv_libssh2_fleet_t* handle,
+    size_t* len
+);
+
+/**
+ * Copies the stdout of all of the hosts, one after another in the order of
+ * the hosts, to a buffer of lv_libssh2_fleet_output_len() bytes. The output of
+ * each host is the next `output_len` bytes of its result.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_fleet_output(
+    lv_libssh2_fleet_t* handle,
+    uint8_t* buffer
+);
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_fleet_stderr_output_len(
+    lv_libssh2_fleet_t* handle,
+    size_t* len
+);
+
+/**
+ * Copies the stderr of all of the hosts, packed like lv_libssh2_fleet_output().
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_fleet_stderr_output(
+    lv_libssh2_fleet_t* handle,
+    uint8_t* buffer
+);
+
+/**
+ * Takes the authenticated session of a host out of the fleet, so it is not
+ * destroyed with the fleet and belongs to the caller. The session is NULL if
+ * the host failed before authenticating or the session was already taken.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_fleet_take_session(
+    lv_libssh2_fleet_t* handle,
+    const size_t index,
+    lv_libssh2_session_t** session
+);
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup file-info File Information
+ *
+ * @{
+ */
+
+/**
+ * Creates a file information, which is a single allocation that can be
+ * reused for every call that fills one, so a loop should create it once
+ * beforehand.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_fileinfo_create(
+    lv_libssh2_fileinfo_t** handle
+);
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_fileinfo_destroy(
+    lv_libssh2_fileinfo_t* handle
+);
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_fileinfo_size(
+    lv_libssh2_fileinfo_t* handle,
+    uint64_t* size
+);
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_fileinfo_atime(
+    lv_libssh2_fileinfo_t* handle,
+    uint64_t* atime
+);
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_fileinfo_mtime(
+    lv_libssh2_fileinfo_t* handle,
+    uint64_t* mtime
 );
 
 LV_LIBSSH2_API lv_libssh2_status_t
@@ -776,7 +1694,7 @@ lv_libssh2_fileinfo_permissions(
  */
 
 /**
- * Initializes the libssh2 library.
+ * Initializes the libssh2 library, and Windows Sockets on Windows.
  *
  * This must be called before calling any other functions in the library.
  */
@@ -965,6 +1883,368 @@ lv_libssh2_knownhost_type_mask(
     int* type_mask
 );
 
+/**
+ * @}
+ */
+
+/**
+ * @defgroup profile Host Profile
+ *
+ * Learn the behavior of each host across sessions.
+ *
+ * Every session with a host, from lv_libssh2_session_connect_host() or
+ * lv_libssh2_session_set_host(), measures its channel and SFTP transfers: the
+ * payload bytes, the time spent moving them, and an estimate of their entropy
+ * from a small sample. When the session disconnects, sessions that moved at
+ * least 64 KB are folded into the profile of their host, separately for
+ * sessions that negotiated compression and sessions that did not.
+ *
+ * When a session authenticates, the profile also keeps the fingerprint of the
+ * host key, the key exchange, host key, cipher, and MAC methods that were
+ * negotiated, and the authentication method that succeeded. The next session
+ * with the host prefers the same methods, for the method types without
+ * preferences from lv_libssh2_session_set_method_pref() or
+ * lv_libssh2_benchmark_apply(), while still offering every other method.
+ * lv_libssh2_userauth_list() for the same user answers from the profile,
+ * with the method that succeeded first, instead of asking the server, and
+ * lv_libssh2_session_hostkey_check_profile() compares the host key without
+ * reading a known hosts file. This saves round trips when reconnecting after
+ * a network outage.
+ *
+ * The profiles are kept in memory for the life of the process.
+ *
+ * @{
+ */
+
+/**
+ * Discards all of the host profiles. This is also done by
+ * lv_libssh2_shutdown().
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_profile_clear();
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup reactor Reactor
+ *
+ * Run commands on thousands of sessions from a few threads.
+ *
+ * The reactor has a fixed number of worker threads, and every session is
+ * assigned to one of them for good, so a session is only ever driven by one
+ * thread and the threads share nothing but the completion queue. Each thread
+ * keeps its sessions in non-blocking mode while they have a job, waits on all
+ * of their sockets at once with epoll on Linux, or poll elsewhere, for the
+ * directions from lv_libssh2_session_block_directions(), and advances every
+ * job whose socket is ready.
+ *
+ * The jobs of a session run one after another in submission order. While a
+ * session has unfinished jobs, it must not be used or destroyed by the
+ * caller at all, even in thread safe mode or with keepalives enabled: the
+ * job keeps libssh2 in non-blocking mode between its steps, so a blocking
+ * call of the caller would return ::LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN,
+ * and a channel open of the caller would collide with the open of the job.
+ * Keepalives from lv_libssh2_session_set_keepalive() may stay enabled, since
+ * the background thread skips a session whose lock is taken.
+ *
+ * @{
+ */
+
+/**
+ * Creates a reactor and starts its worker threads.
+ *
+ * A `thread_count` of zero uses one thread per processor.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_reactor_create(
+    const uint32_t thread_count,
+    lv_libssh2_reactor_t** handle
+);
+
+/**
+ * Stops the worker threads and destroys the reactor.
+ *
+ * Unfinished jobs are canceled and their sessions are restored to the mode
+ * they were in. Jobs that have not been destroyed are destroyed with the
+ * reactor, so their handles are no longer valid.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_reactor_destroy(
+    lv_libssh2_reactor_t* handle
+);
+
+/**
+ * Submits a command to run on the session and returns without waiting.
+ *
+ * The job opens a channel, executes the command with the input as its stdin,
+ * collects stdout and stderr up to `max_output_len` bytes each, or unlimited
+ * if zero, and closes the channel, like
+ * lv_libssh2_channel_exec_with_input(). The command and input are copied.
+ * The timeout covers the time from submission to completion, including
+ * waiting behind earlier jobs of the same session, and a negative timeout
+ * waits forever.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_reactor_exec(
+    lv_libssh2_reactor_t* handle,
+    lv_libssh2_session_t* session,
+    const char* command,
+    const size_t command_len,
+    const uint8_t* input,
+    const size_t input_len,
+    const size_t max_output_len,
+    const int32_t timeout_ms,
+    lv_libssh2_reactor_job_t** job
+);
+
+/**
+ * Waits for the next job to complete, in completion order.
+ *
+ * Each completed job is returned once, unless it was already waited on with
+ * lv_libssh2_reactor_job_wait(). The ::LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN
+ * status is returned if no job completes within the timeout, and a negative
+ * timeout waits forever.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_reactor_wait(
+    lv_libssh2_reactor_t* handle,
+    const int32_t timeout_ms,
+    lv_libssh2_reactor_job_t** job
+);
+
+/**
+ * Waits for the job to complete and gets its result.
+ *
+ * The ::LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN status is returned if the job
+ * is still running after the timeout. Otherwise, the status of the job is
+ * returned, which is ::LV_LIBSSH2_STATUS_ERROR_CANCELED if the reactor was
+ * destroyed first. On success, the exit status is set, and the channel is the
+ * closed channel the command ran on, for lv_libssh2_channel_output() and
+ * lv_libssh2_channel_stderr_output(). The channel belongs to the job and is
+ * destroyed with it.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_reactor_job_wait(
+    lv_libssh2_reactor_job_t* handle,
+    const int32_t timeout_ms,
+    int32_t* exit_status,
+    lv_libssh2_channel_t** channel
+);
+
+/**
+ * Gets the session the job runs on.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_reactor_job_session(
+    lv_libssh2_reactor_job_t* handle,
+    lv_libssh2_session_t** session
+);
+
+/**
+ * Destroys the job and its channel.
+ *
+ * A job that is still running is not stopped, but it no longer reports its
+ * result and is freed by the reactor once it completes.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_reactor_job_destroy(
+    lv_libssh2_reactor_job_t* handle
+);
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup runner Runner
+ *
+ * Run many commands through a single shell channel.
+ *
+ * Each command is followed by a line that prints a sentinel, which is unique to
+ * the runner, with a sequence number and the exit status of the command, so the
+ * output and exit status of every command can be recovered from the stream
+ * without opening a channel and starting a process per command. The remote
+ * shell must be POSIX compatible. Commands are run in the same shell, so
+ * changes such as the current directory or exported variables persist between
+ * commands. The standard input of each command is `/dev/null` and the
+ * standard error is merged with the standard output.
+ *
+ * @{
+ */
+
+/**
+ * Opens a shell channel for running commands.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_runner_create(
+    lv_libssh2_session_t* session,
+    lv_libssh2_runner_t** handle
+);
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_runner_destroy(
+    lv_libssh2_runner_t* handle
+);
+
+/**
+ * Runs a command and waits for it to complete.
+ *
+ * In non-blocking mode, a ::LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN status means
+ * the command is still running, and the next call continues waiting for it
+ * instead of running the command again. If the shell exits before the command
+ * completes, the ::LV_LIBSSH2_STATUS_ERROR_CHANNEL_CLOSED status is returned
+ * and the runner must be destroyed.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_runner_run(
+    lv_libssh2_runner_t* handle,
+    const char* command,
+    const size_t command_len,
+    int32_t* exit_status
+);
+
+/**
+ * Gets the length of the output from the last command.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_runner_output_len(
+    lv_libssh2_runner_t* handle,
+    size_t* len
+);
+
+/**
+ * Copies the output from the last command.
+ *
+ * The buffer must be at least the length from lv_libssh2_runner_output_len().
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_runner_output(
+    lv_libssh2_runner_t* handle,
+    uint8_t* buffer
+);
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup terminal Terminal
+ *
+ * Keep the screen of a full-screen application running in a pseudo-terminal.
+ *
+ * The terminal interprets the VT100 and ANSI escape sequences used for cursor
+ * movement, erasing, inserting and deleting, and scrolling regions, and keeps
+ * the resulting screen as one byte per cell. Graphic renditions, such as
+ * colors, are ignored. Characters outside of ASCII are replaced by a `?`, one
+ * per UTF-8 encoded code point. Changes since the dirty region was last
+ * cleared are tracked as a bounding rectangle, so only the changed part of the
+ * screen needs to be read.
+ *
+ * @{
+ */
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_terminal_create(
+    const uint32_t columns,
+    const uint32_t rows,
+    lv_libssh2_terminal_t** handle
+);
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_terminal_destroy(
+    lv_libssh2_terminal_t* handle
+);
+
+/**
+ * Parses data from a source other than an attached channel.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_terminal_feed(
+    lv_libssh2_terminal_t* handle,
+    const uint8_t* data,
+    const size_t data_len
+);
+
+/**
+ * Resizes the screen, keeping the content in the top-left corner, and marks the
+ * whole screen as dirty.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_terminal_resize(
+    lv_libssh2_terminal_t* handle,
+    const uint32_t columns,
+    const uint32_t rows
+);
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_terminal_size(
+    lv_libssh2_terminal_t* handle,
+    uint32_t* columns,
+    uint32_t* rows
+);
+
+/**
+ * Gets the zero-based position of the cursor.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_terminal_cursor(
+    lv_libssh2_terminal_t* handle,
+    uint32_t* column,
+    uint32_t* row
+);
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_terminal_snapshot_len(
+    lv_libssh2_terminal_t* handle,
+    size_t* len
+);
+
+/**
+ * Copies the whole screen, with every row followed by a line feed.
+ *
+ * The buffer must be at least the length from
+ * lv_libssh2_terminal_snapshot_len().
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_terminal_snapshot(
+    lv_libssh2_terminal_t* handle,
+    uint8_t* buffer,
+    const size_t buffer_len
+);
+
+/**
+ * Copies one row of the screen. The buffer must be at least as long as the
+ * number of columns.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_terminal_row(
+    lv_libssh2_terminal_t* handle,
+    const uint32_t row,
+    uint8_t* buffer,
+    const size_t buffer_len
+);
+
+/**
+ * Gets the smallest rectangle, with inclusive zero-based bounds, that contains
+ * every cell changed since the dirty region was last cleared.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_terminal_dirty_region(
+    lv_libssh2_terminal_t* handle,
+    bool* dirty,
+    uint32_t* left,
+    uint32_t* top,
+    uint32_t* right,
+    uint32_t* bottom
+);
+
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_terminal_clear_dirty(
+    lv_libssh2_terminal_t* handle
+);
+
 /**
  * @}
  */
@@ -1013,6 +2293,20 @@ lv_libssh2_session_create(
     lv_libssh2_session_t** handle
 );
 
+/**
+ * Creates a session with a configuration, where a NULL `config` uses the
+ * defaults.
+ *
+ * Unlike lv_libssh2_session_create(), libssh2 allocates the memory of the
+ * session through the library, which counts it for
+ * lv_libssh2_session_memory_usage().
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_create_ex(
+    const lv_libssh2_session_config_t* config,
+    lv_libssh2_session_t** handle
+);
+
 /**
  * Destroys a session.
  *
@@ -1025,12 +2319,84 @@ lv_libssh2_session_destroy(
     lv_libssh2_session_t* handle
 );
 
+/**
+ * Disconnects and destroys a session on a background thread, returning
+ * immediately.
+ *
+ * The thread sends the disconnect message with the description in
+ * non-blocking mode, waiting at most a second for the socket, then shuts
+ * down the socket so freeing the session and its channels cannot block on an
+ * unreachable peer, and destroys the session. A NULL description skips the
+ * disconnect message. The socket is shut down even if it was passed in with
+ * lv_libssh2_session_connect(), so it is only good for closing afterwards.
+ *
+ * The session and everything created from it must not be used after this is
+ * called, so channels and other handles that belong to the caller should be
+ * destroyed first. Sessions that are still queued when lv_libssh2_shutdown()
+ * is called are finished before it returns.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_destroy_async(
+    lv_libssh2_session_t* handle,
+    const char* description
+);
+
 LV_LIBSSH2_API lv_libssh2_status_t
 lv_libssh2_session_connect(
     lv_libssh2_session_t* handle,
     const uintptr_t socket
 );
 
+/**
+ * Opens a TCP connection to the host and starts the session on it.
+ *
+ * This is an alternative to lv_libssh2_session_connect() for when a socket is
+ * not already available. IPv4 and IPv6 addresses of the host are tried in
+ * parallel, staggered by the attempt delay of the options, and the first
+ * connection to complete is used. Host name resolutions are cached for a
+ * minute. A NULL `options` enables `TCP_NODELAY` and TCP keepalive.
+ *
+ * The `timeout_ms` covers both the TCP connection and the SSH handshake, and
+ * a negative value waits indefinitely. The time spent by the system resolver
+ * is not bounded by the timeout. The socket belongs to the session and is
+ * closed when the session is destroyed, even if the handshake fails.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_connect_host(
+    lv_libssh2_session_t* handle,
+    const char* host,
+    const uint16_t port,
+    const int32_t timeout_ms,
+    const lv_libssh2_socket_options_t* options
+);
+
+/**
+ * Starts the session on a tunnel to the host through another session that is
+ * already authenticated, like the `ProxyJump` option of OpenSSH.
+ *
+ * A direct TCP/IP channel to the host is opened on the jump session, and its
+ * data is moved to and from a socket pair by a thread of the jump session, so
+ * the tunneled session uses the pair like a TCP connection. The thread is
+ * started on the first tunnel and serves every tunnel through the same jump
+ * session, and the jump session is switched to thread safe mode and stays in
+ * it, so it can still be used by the caller at the same time. Other calls on
+ * the jump session wait while the channel is being opened. The tunnel can
+ * itself be the jump session of another tunnel to chain several hops.
+ *
+ * The `timeout_ms` covers both the channel open and the SSH handshake, and a
+ * negative value waits indefinitely. The tunnel is closed when this session
+ * is destroyed. If the jump session is destroyed first, this session sees the
+ * end of the connection.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_connect_jump(
+    lv_libssh2_session_t* handle,
+    lv_libssh2_session_t* jump_session,
+    const char* host,
+    const uint16_t port,
+    const int32_t timeout_ms
+);
+
 LV_LIBSSH2_API lv_libssh2_status_t
 lv_libssh2_session_disconnect(
     lv_libssh2_session_t* handle,
@@ -1094,8 +2460,9 @@ lv_libssh2_session_set_banner(
 );
 
 LV_LIBSSH2_API lv_libssh2_status_t
-lv_libssh2_session_block_direction(
-    lv_libssh2_session_t* handle
+lv_libssh2_session_block_directions(
+    lv_libssh2_session_t* handle,
+    lv_libssh2_session_block_directions_t* directions
 );
 
 LV_LIBSSH2_API lv_libssh2_status_t
@@ -1168,6 +2535,234 @@ lv_libssh2_session_method(
     uint8_t* buffer
 );
 
+/**
+ * Gets the banner, host key, host key hashes, negotiated methods,
+ * authentication methods, and authenticated flag of a started session in one
+ * call, such as for an audit log after connecting.
+ *
+ * The authentication methods are the ones from the last call of
+ * lv_libssh2_userauth_list_len() or lv_libssh2_userauth_list() for the
+ * session, and are empty if it was never called, because listing them again
+ * would need the user name and may authenticate. The
+ * ::LV_LIBSSH2_STATUS_ERROR_SESSION_NOT_STARTED status is returned before the
+ * handshake, and the ::LV_LIBSSH2_STATUS_ERROR_OUT_OF_BOUNDARY status if the
+ * host key does not fit.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_info(
+    lv_libssh2_session_t* handle,
+    lv_libssh2_session_info_t* info
+);
+
+/**
+ * Gets the memory that the allocator of a session created by
+ * lv_libssh2_session_create_ex() currently holds, and the most it has held
+ * since the session was created, in bytes. Both include the bookkeeping of
+ * each allocation and the blocks pooled for reuse. Both are zero for a
+ * session created by lv_libssh2_session_create().
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_memory_usage(
+    lv_libssh2_session_t* handle,
+    uint64_t* current,
+    uint64_t* peak
+);
+
+/**
+ * Keeps an idle session alive by sending a keepalive request every
+ * `interval_s` seconds from a background thread owned by the library.
+ *
+ * The session must be connected. Intervals shorter than two seconds are
+ * raised to two seconds, and an interval of zero stops the keepalives. Once
+ * keepalives have been scheduled, every call on the session, its channels,
+ * and its SFTP handles holds a per-session lock, even after they are stopped,
+ * so the background thread never runs concurrently with the caller; a session
+ * that is busy is skipped until it is idle again.
+ *
+ * When three keepalive requests in a row go unanswered or fail to send, or
+ * the connection is reset, the session is reported as ::LV_LIBSSH2_SESSION_STATE_DEAD by
+ * lv_libssh2_session_state() and its socket is shut down, so blocked and
+ * future calls fail instead of waiting on a connection that is gone. A
+ * session stays scheduled while it is idle in the session pool.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_set_keepalive(
+    lv_libssh2_session_t* handle,
+    const uint32_t interval_s
+);
+
+/**
+ * Gets whether the connection of the session has been detected as dead.
+ *
+ * Detection only happens for sessions with keepalives enabled with
+ * lv_libssh2_session_set_keepalive(); other sessions always report
+ * ::LV_LIBSSH2_SESSION_STATE_ALIVE.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_state(
+    lv_libssh2_session_t* handle,
+    lv_libssh2_session_states_t* state
+);
+
+/**
+ * Names the host of the session for its host profile, as `host:port`.
+ *
+ * lv_libssh2_session_connect_host() does this itself, so this is only needed
+ * before lv_libssh2_session_connect() with a socket opened by the caller.
+ * Sessions without a host are not profiled.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_set_host(
+    lv_libssh2_session_t* handle,
+    const char* host,
+    const uint16_t port
+);
+
+/**
+ * Compares the host key of the connected session with the host key recorded
+ * in the profile of its host when the last session with the host
+ * authenticated.
+ *
+ * The result is ::LV_LIBSSH2_KNOWNHOSTS_CHECK_RESULT_MATCH if the keys are the
+ * same, ::LV_LIBSSH2_KNOWNHOSTS_CHECK_RESULT_MISMATCH if the key changed, and
+ * ::LV_LIBSSH2_KNOWNHOSTS_CHECK_RESULT_NOT_FOUND if no key is recorded. A host
+ * key is only recorded after authentication succeeds, so a match is only as
+ * trustworthy as the check done before that first authentication.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_hostkey_check_profile(
+    lv_libssh2_session_t* handle,
+    lv_libssh2_knownhosts_check_results_t* result
+);
+
+/**
+ * Sets whether compression is chosen by the caller or learned from the host
+ * profile. The default is ::LV_LIBSSH2_COMPRESSION_POLICY_MANUAL, where
+ * compression is only on if enabled with lv_libssh2_session_enable_option().
+ *
+ * With ::LV_LIBSSH2_COMPRESSION_POLICY_LEARNED, compression is enabled or
+ * disabled when the session connects, based on how compressible the earlier
+ * transfers with the host were and whether they were faster with or without
+ * compression. Data that looks already compressed turns compression off. A
+ * host without a profile keeps the option set by the caller. This must be set
+ * before the session connects.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_set_compression_policy(
+    lv_libssh2_session_t* handle,
+    const lv_libssh2_compression_policies_t policy
+);
+
+/**
+ * Sets whether the session may be used from several threads at once, such as
+ * parallel LabVIEW loops that each use their own channel of one session. The
+ * default is off, where a session and everything created from it must only be
+ * used by one thread at a time.
+ *
+ * In thread safe mode, every library call on the session, its channels, and
+ * its SFTP handles takes an internal lock of the session. Channel reads and
+ * writes, and SFTP file reads and writes, hold it only for one packet and
+ * release it while waiting for the socket, so a blocking read on one channel
+ * does not stall the other channels. Other calls, such as opening a channel
+ * or an SFTP request, hold it until they complete, because libssh2 can only
+ * have one of them in progress per session.
+ *
+ * Each thread should use its own channels and SFTP instance; a channel or SFTP
+ * instance used by two threads at once still needs locking by the caller. In
+ * non-blocking mode, the caller must also not start a second channel open or
+ * other setup call while one returned ::LV_LIBSSH2_STATUS_ERROR_EXECUTE_AGAIN.
+ * This must be changed while no other thread uses the session. A session that
+ * has been the jump session of lv_libssh2_session_connect_jump() stays in
+ * thread safe mode, and disabling it has no effect.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_set_thread_safe(
+    lv_libssh2_session_t* handle,
+    const bool enabled
+);
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup session_pool Session Pool
+ *
+ * Reuse connected and authenticated sessions across many short tasks.
+ *
+ * The pool is shared by the whole process and keeps idle sessions keyed by the
+ * host, port, user, and a credential identifier chosen by the caller, such as
+ * the path of a key file, so a session is only reused for the same identity.
+ * Sessions idle longer than the idle timeout are closed the next time the
+ * pool is used. The maximum per key bounds the sessions of a key that are idle
+ * in the pool or were acquired and not yet released or destroyed, so at most
+ * that many connections to a host exist for one identity. By default, up to
+ * 4 sessions per key are allowed and idle ones are kept for 5 minutes.
+ *
+ * @{
+ */
+
+/**
+ * Sets the maximum number of sessions per key, idle or in use, and how long
+ * idle sessions are kept. A maximum of zero disables pooling and the limit,
+ * and a negative `idle_timeout_ms` keeps sessions until the pool is cleared.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_pool_configure(
+    const size_t max_per_key,
+    const int32_t idle_timeout_ms
+);
+
+/**
+ * Takes an authenticated session for the key from the pool, or connects a new
+ * one.
+ *
+ * An idle session is checked with a keepalive request before it is returned,
+ * and sessions that fail the check are closed with
+ * lv_libssh2_session_destroy_async(). If the key is at its maximum and has no
+ * idle session, this waits for one to be released or destroyed, for up to
+ * `timeout_ms`, and returns ::LV_LIBSSH2_STATUS_ERROR_TIMEOUT if none is. The
+ * same timeout then applies to the connect. If `reused` is one, the session
+ * is already authenticated. Otherwise, a new session was connected with
+ * lv_libssh2_session_connect_host() and must be authenticated by the caller,
+ * and destroyed with lv_libssh2_session_destroy() if that fails. A NULL
+ * `credential_id` is the same as an empty one.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_pool_acquire(
+    const char* host,
+    const uint16_t port,
+    const char* user,
+    const char* credential_id,
+    const int32_t timeout_ms,
+    const lv_libssh2_socket_options_t* options,
+    lv_libssh2_session_t** handle,
+    uint8_t* reused
+);
+
+/**
+ * Returns an authenticated session to the pool.
+ *
+ * All of the channels, SFTP sessions, and other handles created from the
+ * session must be destroyed first. The caller must not use the session after
+ * it is released. A session that is not authenticated, was found dead by the
+ * keepalives, or would exceed the maximum for its key is closed with
+ * lv_libssh2_session_destroy_async() instead of kept, and a session that did
+ * not come from lv_libssh2_session_pool_acquire() is destroyed.
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_pool_release(
+    lv_libssh2_session_t* handle
+);
+
+/**
+ * Disconnects and destroys all of the idle sessions in the pool with
+ * lv_libssh2_session_destroy_async(). This is also done by
+ * lv_libssh2_shutdown().
+ */
+LV_LIBSSH2_API lv_libssh2_status_t
+lv_libssh2_session_pool_clear();
+
 /**
  * @}
  */
@@ -1349,6 +2944,11 @@ lv_libssh2_sftp_resolve_real_link(
  * @{
  */
 
+/**
+ * Creates SFTP attributes, which are a single allocation that can be reused
+ * for every call that fills or reads them, so a loop should create them once
+ * beforehand.
+ */
 LV_LIBSSH2_API lv_libssh2_status_t
 lv_libssh2_sftp_attributes_create(
     lv_libssh2_sftp_attributes_t** handle
@@ -0,0 +1,271 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "minunit.h"
+#include "lv-libssh2.h"
+#include "lv-libssh2-memory-private.h"
+#include "lv-libssh2-session-private.h"
+
+// The allocation callbacks find the allocator through the session in the
+// abstract pointer, so a zeroed session stands in for a real one.
+static lv_libssh2_session_t session;
+static void* abstract = &session;
+
+static void
+create_memory(
+    const bool pooled,
+    const size_t retain_limit,
+    const size_t arena_size,
+    const uint64_t limit
+) {
+    memset(&session, 0, sizeof(lv_libssh2_session_t));
+    lv_libssh2_memory_create(pooled, retain_limit, arena_size, limit, &session.memory);
+}
+
+static void
+teardown()
+{
+    if (session.memory != NULL) {
+        lv_libssh2_memory_destroy(session.memory);
+        session.memory = NULL;
+    }
+}
+
+static uint64_t
+current_usage()
+{
+    uint64_t current = 0;
+    uint64_t peak = 0;
+    lv_libssh2_memory_usage(session.memory, &current, &peak);
+    return current;
+}
+
+MU_TEST(test_system_allocator_counts_usage)
+{
+    create_memory(false, 0, 0, 0);
+    mu_check(session.memory != NULL);
+    void* block = lv_libssh2_memory_alloc(100, &abstract);
+    mu_check(block != NULL);
+    uint64_t held = current_usage();
+    mu_check(held >= 100);
+    lv_libssh2_memory_free(block, &abstract);
+    mu_check(current_usage() == 0);
+    uint64_t current = 0;
+    uint64_t peak = 0;
+    lv_libssh2_memory_usage(session.memory, &current, &peak);
+    mu_check(peak == held);
+}
+
+MU_TEST(test_pool_reuses_freed_block)
+{
+    create_memory(true, 4096, 0, 0);
+    void* block = lv_libssh2_memory_alloc(100, &abstract);
+    mu_check(block != NULL);
+    uint64_t held = current_usage();
+    lv_libssh2_memory_free(block, &abstract);
+    mu_assert(current_usage() == held, "Freed block was not kept for reuse");
+    void* reused = lv_libssh2_memory_alloc(90, &abstract);
+    mu_assert(reused == block, "Block of the same size class was not reused");
+    mu_check(current_usage() == held);
+    lv_libssh2_memory_free(reused, &abstract);
+}
+
+MU_TEST(test_pool_frees_beyond_retain_limit)
+{
+    create_memory(true, 0, 0, 0);
+    void* block = lv_libssh2_memory_alloc(100, &abstract);
+    mu_check(block != NULL);
+    lv_libssh2_memory_free(block, &abstract);
+    mu_check(current_usage() == 0);
+}
+
+MU_TEST(test_arena_fails_when_exhausted)
+{
+    create_memory(false, 0, 1024, 0);
+    void* blocks[16];
+    size_t count = 0;
+    while (count < 16) {
+        blocks[count] = lv_libssh2_memory_alloc(100, &abstract);
+        if (blocks[count] == NULL) {
+            break;
+        }
+        count++;
+    }
+    mu_check(count > 0);
+    mu_assert(count < 16, "Arena was not exhausted");
+    mu_check(current_usage() <= 1024);
+    lv_libssh2_memory_free(blocks[0], &abstract);
+    void* reused = lv_libssh2_memory_alloc(100, &abstract);
+    mu_assert(reused == blocks[0], "Freed arena block was not reused");
+    mu_check(lv_libssh2_memory_alloc(100, &abstract) == NULL);
+}
+
+MU_TEST(test_arena_reuses_large_blocks)
+{
+    create_memory(false, 0, 256 * 1024, 0);
+    void* block = lv_libssh2_memory_alloc(100 * 1024, &abstract);
+    mu_check(block != NULL);
+    lv_libssh2_memory_free(block, &abstract);
+    void* reused = lv_libssh2_memory_alloc(90 * 1024, &abstract);
+    mu_assert(reused == block, "Freed large arena block was not reused");
+}
+
+MU_TEST(test_limit_fails_allocation)
+{
+    create_memory(true, 4096, 0, 256);
+    void* first = lv_libssh2_memory_alloc(100, &abstract);
+    void* second = lv_libssh2_memory_alloc(100, &abstract);
+    mu_check(first != NULL);
+    mu_check(second != NULL);
+    mu_check(lv_libssh2_memory_alloc(100, &abstract) == NULL);
+    mu_check(current_usage() <= 256);
+    lv_libssh2_memory_free(first, &abstract);
+    lv_libssh2_memory_free(second, &abstract);
+    // The blocks kept for reuse are of the wrong size class, so they are
+    // released to make room.
+    void* larger = lv_libssh2_memory_alloc(200, &abstract);
+    mu_assert(larger != NULL, "Blocks kept for reuse were not released for the limit");
+    mu_check(current_usage() <= 256);
+    lv_libssh2_memory_free(larger, &abstract);
+}
+
+MU_TEST(test_realloc_keeps_contents)
+{
+    const char* data = "0123456789abcdef";
+    create_memory(true, 4096, 0, 0);
+    char* block = lv_libssh2_memory_alloc(16, &abstract);
+    mu_check(block != NULL);
+    memcpy(block, data, 16);
+    char* grown = lv_libssh2_memory_realloc(block, 1000, &abstract);
+    mu_check(grown != NULL);
+    mu_check(memcmp(grown, data, 16) == 0);
+    char* large = lv_libssh2_memory_realloc(grown, 100 * 1024, &abstract);
+    mu_check(large != NULL);
+    mu_check(memcmp(large, data, 16) == 0);
+    char* shrunk = lv_libssh2_memory_realloc(large, 8, &abstract);
+    mu_check(shrunk != NULL);
+    mu_check(memcmp(shrunk, data, 8) == 0);
+    lv_libssh2_memory_free(shrunk, &abstract);
+}
+
+MU_TEST(test_create_ex_rejects_bad_config)
+{
+    lv_libssh2_session_config_t config;
+    lv_libssh2_session_t* handle = NULL;
+    memset(&config, 0, sizeof(lv_libssh2_session_config_t));
+    config.memory_mode = 42;
+    mu_check(lv_libssh2_session_create_ex(&config, &handle) == LV_LIBSSH2_STATUS_ERROR_UNKNOWN_MEMORY_MODE);
+    mu_check(handle == NULL);
+    config.memory_mode = LV_LIBSSH2_MEMORY_MODE_DEFAULT;
+    config.packet_size = LIBSSH2_CHANNEL_PACKET_DEFAULT + 1;
+    mu_check(lv_libssh2_session_create_ex(&config, &handle) == LV_LIBSSH2_STATUS_ERROR_INVALID_PACKET_SIZE);
+    mu_check(handle == NULL);
+}
+
+MU_TEST(test_create_ex_counts_usage)
+{
+    const int32_t modes[] = {
+        LV_LIBSSH2_MEMORY_MODE_DEFAULT,
+        LV_LIBSSH2_MEMORY_MODE_LOW,
+        LV_LIBSSH2_MEMORY_MODE_REAL_TIME,
+    };
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        lv_libssh2_session_config_t config;
+        lv_libssh2_session_t* handle = NULL;
+        memset(&config, 0, sizeof(lv_libssh2_session_config_t));
+        config.memory_mode = modes[i];
+        mu_check(lv_libssh2_session_create_ex(&config, &handle) == LV_LIBSSH2_STATUS_OK);
+        uint64_t current = 0;
+        uint64_t peak = 0;
+        mu_check(lv_libssh2_session_memory_usage(handle, &current, &peak) == LV_LIBSSH2_STATUS_OK);
+        mu_check(current > 0);
+        mu_check(peak >= current);
+        mu_check(lv_libssh2_session_destroy(handle) == LV_LIBSSH2_STATUS_OK);
+    }
+}
+
+MU_TEST(test_create_ex_rejects_unknown_allocator)
+{
+    lv_libssh2_session_config_t config;
+    lv_libssh2_session_t* handle = NULL;
+    memset(&config, 0, sizeof(lv_libssh2_session_config_t));
+    config.allocator = 42;
+    mu_check(lv_libssh2_session_create_ex(&config, &handle) == LV_LIBSSH2_STATUS_ERROR_UNKNOWN_ALLOCATOR);
+    mu_check(handle == NULL);
+}
+
+MU_TEST(test_create_ex_enforces_limit)
+{
+    lv_libssh2_session_config_t config;
+    lv_libssh2_session_t* handle = NULL;
+    memset(&config, 0, sizeof(lv_libssh2_session_config_t));
+    config.memory_limit = 64;
+    mu_check(lv_libssh2_session_create_ex(&config, &handle) == LV_LIBSSH2_STATUS_ERROR_MALLOC);
+    mu_check(handle == NULL);
+}
+
+MU_TEST_SUITE(allocators)
+{
+    MU_SUITE_CONFIGURE(NULL, &teardown);
+    MU_RUN_TEST(test_system_allocator_counts_usage);
+    MU_RUN_TEST(test_pool_reuses_freed_block);
+    MU_RUN_TEST(test_pool_frees_beyond_retain_limit);
+    MU_RUN_TEST(test_arena_fails_when_exhausted);
+    MU_RUN_TEST(test_arena_reuses_large_blocks);
+    MU_RUN_TEST(test_limit_fails_allocation);
+    MU_RUN_TEST(test_realloc_keeps_contents);
+}
+
+MU_TEST_SUITE(sessions)
+{
+    MU_SUITE_CONFIGURE(NULL, NULL);
+    MU_RUN_TEST(test_create_ex_rejects_bad_config);
+    MU_RUN_TEST(test_create_ex_counts_usage);
+    MU_RUN_TEST(test_create_ex_rejects_unknown_allocator);
+    MU_RUN_TEST(test_create_ex_enforces_limit);
+}
+
+int
+main(int argc, char* argv[])
+{
+    lv_libssh2_initialize();
+    MU_RUN_SUITE(allocators);
+    MU_RUN_SUITE(sessions);
+    MU_REPORT();
+    lv_libssh2_shutdown();
+    return minunit_fail;
+}
@@ -0,0 +1,205 @@
+/*
+ * LV-LIBSSH2 - A LabVIEW-Friendly C library for libssh2
+ *
+ * Copyright (c) 2018 Field R&D Services, LLC. All Rights Reserved.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * withoutmodification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the Field R&D Services nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Field R&D Services, LLC ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Field R&D Services, LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Contributor(s):
+ *   Christopher R. Field <chris@fieldrndservices.com>
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/socket.h>
+#endif
+
+#include "minunit.h"
+#include "lv-libssh2.h"
+#include "lv-libssh2-session-private.h"
+#include "lv-libssh2-socket-private.h"
+#include "lv-libssh2-thread-private.h"
+#include "lv-libssh2-time-private.h"
+
+#define THREAD_COUNT 4
+#define INCREMENTS 100000
+#define WAIT_TIMEOUT_MS 5000
+#define SHORT_TIMEOUT_MS 50
+
+static lv_libssh2_session_t* session = NULL;
+static libssh2_socket_t pair[2] = { LIBSSH2_INVALID_SOCKET, LIBSSH2_INVALID_SOCKET };
+static uint64_t counter = 0;
+static lv_libssh2_status_t results[THREAD_COUNT];
+
+/**
+ * Creates a thread safe session whose socket is one end of a socket pair, so
+ * the test controls when data arrives without a server.
+ */
+static void
+setup()
+{
+    lv_libssh2_session_create(&session);
+    lv_libssh2_session_set_thread_safe(session, true);
+    lv_libssh2_socket_pair(pair);
+    session->socket = pair[0];
+}
+
+static void
+teardown()
+{
+    session->socket = LIBSSH2_INVALID_SOCKET;
+    lv_libssh2_session_destroy(session);
+    session = NULL;
+    lv_libssh2_socket_close(pair[0]);
+    lv_libssh2_socket_close(pair[1]);
+    pair[0] = LIBSSH2_INVALID_SOCKET;
+    pair[1] = LIBSSH2_INVALID_SOCKET;
+}
+
+static void
+sleep_ms(
+    const int32_t timeout_ms
+) {
+    static lv_libssh2_mutex_t mutex = LV_LIBSSH2_MUTEX_INITIALIZER;
+    static lv_libssh2_cond_t cond = LV_LIBSSH2_COND_INITIALIZER;
+    uint64_t deadline_us = lv_libssh2_time_deadline_us(timeout_ms);
+    lv_libssh2_mutex_lock(&mutex);
+    while (lv_libssh2_time_now_us() < deadline_us) {
+        lv_libssh2_cond_wait(&cond, &mutex, deadline_us);
+    }
+    lv_libssh2_mutex_unlock(&mutex);
+}
+
+static void
+increment(
+    void* arg
+) {
+    (void)arg;
+    for (uint32_t i = 0; i < INCREMENTS; i++) {
+        lv_libssh2_session_lock(session);
+        counter++;
+        lv_libssh2_session_unlock(session);
+    }
+}
+
+static void
+wait_for_data(
+    void* arg
+) {
+    lv_libssh2_status_t* result = arg;
+    *result = lv_libssh2_session_wait_socket(session, lv_libssh2_time_deadline_us(WAIT_TIMEOUT_MS));
+}
+
+MU_TEST(test_lock_excludes_other_threads)
+{
+    lv_libssh2_thread_t threads[THREAD_COUNT];
+    counter = 0;
+    for (size_t i = 0; i < THREAD_COUNT; i++) {
+        mu_check(lv_libssh2_thread_start(&threads[i], increment, NULL));
+    }
+    for (size_t i = 0; i < THREAD_COUNT; i++) {
+        lv_libssh2_thread_join(threads[i]);
+    }
+    mu_assert(counter == (uint64_t)THREAD_COUNT * INCREMENTS, "Lock did not exclude other threads");
+}
+
+MU_TEST(test_try_lock_fails_while_locked)
+{
+    lv_libssh2_session_lock(session);
+    bool taken = lv_libssh2_session_try_lock(session);
+    lv_libssh2_session_unlock(session);
+    mu_check(!taken);
+    mu_check(lv_libssh2_session_try_lock(session));
+    lv_libssh2_session_unlock(session);
+}
+
+MU_TEST(test_wait_times_out_without_data)
+{
+    uint64_t start_us = lv_libssh2_time_now_us();
+    lv_libssh2_status_t status = lv_libssh2_session_wait_socket(
+        session,
+        lv_libssh2_time_deadline_us(SHORT_TIMEOUT_MS)
+    );
+    mu_check(status == LV_LIBSSH2_STATUS_ERROR_TIMEOUT);
+    mu_check(lv_libssh2_time_now_us() - start_us >= SHORT_TIMEOUT_MS * 1000);
+}
+
+MU_TEST(test_wait_wakes_every_waiter)
+{
+    lv_libssh2_thread_t threads[THREAD_COUNT];
+    for (size_t i = 0; i < THREAD_COUNT; i++) {
+        results[i] = LV_LIBSSH2_STATUS_ERROR_GENERIC;
+        mu_check(lv_libssh2_thread_start(&threads[i], wait_for_data, &results[i]));
+    }
+    // Only one of the threads polls the socket, and the others wait for it.
+    sleep_ms(SHORT_TIMEOUT_MS);
+    uint64_t start_us = lv_libssh2_time_now_us();
+    char byte = 0;
+    mu_check(send(pair[1], &byte, 1, 0) == 1);
+    for (size_t i = 0; i < THREAD_COUNT; i++) {
+        lv_libssh2_thread_join(threads[i]);
+    }
+    mu_assert(
+        lv_libssh2_time_now_us() - start_us < WAIT_TIMEOUT_MS * 1000ULL,
+        "Waiters were not woken by the data"
+    );
+    for (size_t i = 0; i < THREAD_COUNT; i++) {
+        mu_check(results[i] == LV_LIBSSH2_STATUS_OK);
+    }
+}
+
+MU_TEST(test_wait_fails_without_socket)
+{
+    libssh2_socket_t socket = session->socket;
+    session->socket = LIBSSH2_INVALID_SOCKET;
+    lv_libssh2_status_t status = lv_libssh2_session_wait_socket(session, lv_libssh2_time_deadline_us(0));
+    session->socket = socket;
+    mu_check(status == LV_LIBSSH2_STATUS_ERROR_SOCKET_NONE);
+}
+
+MU_TEST_SUITE(thread_safe)
+{
+    MU_SUITE_CONFIGURE(&setup, &teardown);
+    MU_RUN_TEST(test_lock_excludes_other_threads);
+    MU_RUN_TEST(test_try_lock_fails_while_locked);
+    MU_RUN_TEST(test_wait_times_out_without_data);
+    MU_RUN_TEST(test_wait_wakes_every_waiter);
+    MU_RUN_TEST(test_wait_fails_without_socket);
+}
+
+int
+main(int argc, char* argv[])
+{
+    lv_libssh2_initialize();
+    MU_RUN_SUITE(thread_safe);
+    MU_REPORT();
+    lv_libssh2_shutdown();
+    return minunit_fail;
+}